@@ -0,0 +1,236 @@
+#include "Bench.h"
+#include <Progress.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cmath>
+
+namespace {
+
+std::atomic<size_t> allocationCount{0};
+
+}
+
+// Every allocation in the benchmark binary is counted, so that benchmarks
+// can check that steady-state paths do not touch the heap.
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace bench {
+
+namespace {
+
+struct Benchmark {
+    std::string name;
+    Function function;
+};
+
+std::vector<Benchmark>& registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Result {
+    std::string benchmark;
+    std::string label;
+    double value;
+    std::string unit;
+};
+
+std::vector<Result> results;
+std::string running;
+
+// Values that must match the baseline are given this unit.
+const std::string exact = "exact";
+
+void writeResults(const std::string &path) {
+    std::ofstream out{path};
+    out << std::setprecision(17) << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        out << "{\"benchmark\": \"" << result.benchmark << "\", \"label\": \"" << result.label
+            << "\", \"value\": " << result.value << ", \"unit\": \"" << result.unit << "\"}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+    if (!out) throw std::runtime_error("error: cannot write " + path);
+}
+
+// Extracts the string or number after "key": on a line written by
+// writeResults.
+std::string field(const std::string &line, const std::string &key) {
+    size_t start = line.find("\"" + key + "\": ");
+    if (start == std::string::npos) return "";
+    start += key.size() + 4;
+    if (line[start] == '"') {
+        return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+    }
+    return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+std::vector<Result> readResults(const std::string &path) {
+    std::ifstream in{path};
+    if (!in) throw std::runtime_error("error: cannot read " + path);
+    std::vector<Result> read;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.find('{') == std::string::npos) continue;
+        read.push_back({field(line, "benchmark"), field(line, "label"), std::stod(field(line, "value")), field(line, "unit")});
+    }
+    return read;
+}
+
+// Prints every result that regressed against the baseline and returns how
+// many did. Results missing from either run are skipped.
+int compareResults(const std::string &path, double threshold) {
+    std::map<std::pair<std::string, std::string>, Result> baseline;
+    for (const Result &result: readResults(path)) baseline[{result.benchmark, result.label}] = result;
+
+    int regressions = 0, compared = 0;
+    for (const Result &result: results) {
+        auto it = baseline.find({result.benchmark, result.label});
+        if (it == baseline.end() || it->second.unit != result.unit) continue;
+        const double before = it->second.value, after = result.value;
+        const std::string &unit = result.unit;
+        compared++;
+
+        bool regressed;
+        if (unit == exact) {
+            regressed = std::abs(after - before) > 1e-9 * std::max(1.0, std::abs(before));
+        } else if (unit == "ms") {
+            // Times of a few milliseconds jitter by more than any sensible
+            // threshold, so they must also slow down by a millisecond.
+            regressed = after > before * (1 + threshold) && after > before + 1;
+        } else if (unit == "ns") {
+            regressed = after > before * (1 + threshold);
+        } else if (unit.size() > 2 && unit.compare(unit.size() - 2, 2, "/s") == 0) {
+            regressed = after < before / (1 + threshold);
+        } else {
+            continue;
+        }
+        if (regressed) {
+            regressions++;
+            std::cout << "regression: " << result.benchmark << " " << result.label << ": "
+                      << before << " -> " << after << " " << unit << std::endl;
+        }
+    }
+    std::cout << "compared " << compared << " results with " << path << ", "
+              << regressions << " regressions" << std::endl;
+    return regressions;
+}
+
+}
+
+Registrar::Registrar(const std::string &name, Function function) {
+    registry().push_back({name, std::move(function)});
+}
+
+double measure(const std::string &label, int iterations, const Function &fn) {
+    using clock = std::chrono::steady_clock;
+    fn();
+
+    double best = std::numeric_limits<double>::infinity();
+    double total = 0;
+    for (int i = 0; i < iterations; i++) {
+        auto start = clock::now();
+        fn();
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        best = std::min(best, ms);
+        total += ms;
+    }
+
+    std::cout << std::left << std::setw(48) << label
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << best << " ms (min)"
+              << std::setw(12) << total / iterations << " ms (mean)" << std::endl;
+    results.push_back({running, label, best, "ms"});
+    return best;
+}
+
+void report(const std::string &label, double value, const std::string &unit) {
+    std::cout << std::left << std::setw(48) << label
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << value << " " << unit << std::endl;
+    results.push_back({running, label, value, unit});
+}
+
+void check(const std::string &label, double value) {
+    std::cout << std::left << std::setw(48) << label
+              << std::right << std::setprecision(9) << std::defaultfloat
+              << std::setw(20) << value << " (check)" << std::endl;
+    results.push_back({running, label, value, exact});
+}
+
+size_t allocations() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+const Geometry& model(const std::string &name) {
+    static std::map<std::string, std::unique_ptr<Geometry>> models;
+    auto &geometry = models[name];
+    if (!geometry) {
+        std::ifstream file{"test/models/" + name};
+        if (!file) {
+            throw std::runtime_error("error: missing model " + name);
+        }
+        geometry = std::make_unique<Geometry>(file);
+    }
+    return *geometry;
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+    std::string filter, jsonPath, baselinePath;
+    double threshold = 0.25;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::stod(argv[++i]);
+        } else {
+            filter = arg;
+        }
+    }
+
+    // Progress bars and loading messages would interleave with the results.
+    setQuiet(true);
+    for (auto &benchmark: bench::registry()) {
+        if (benchmark.name.find(filter) == std::string::npos) continue;
+        std::cout << "== " << benchmark.name << std::endl;
+        bench::running = benchmark.name;
+        benchmark.function();
+    }
+
+    try {
+        if (!jsonPath.empty()) bench::writeResults(jsonPath);
+        if (!baselinePath.empty() && bench::compareResults(baselinePath, threshold) > 0) return 1;
+    } catch (const std::exception &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
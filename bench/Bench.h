@@ -0,0 +1,69 @@
+/**
+ * \file Bench.h
+ * \brief Minimal benchmark harness
+ *
+ * Benchmarks are registered with the BENCHMARK macro and run by build/bench:
+ *
+ *     build/bench [filter] [--json results.json] [--baseline baseline.json]
+ *                 [--threshold 0.25]
+ *
+ * A filter restricts the run to benchmarks whose names contain it. Every
+ * timing and reported value is also kept, and --json writes them out, one
+ * object per line. Given a baseline written that way, the run is compared
+ * against it, result by result, and any regression makes it exit with
+ * status 1. A regression is:
+ *
+ *   - a value passed to check ("exact") that changed by more than 1e-9
+ *     relative to its baseline;
+ *   - a time in "ms" more than (1 + threshold) times its baseline and also
+ *     more than a millisecond over it;
+ *   - a time in "ns" more than (1 + threshold) times its baseline;
+ *   - a rate (a unit ending in "/s") below its baseline divided by
+ *     (1 + threshold).
+ *
+ * Results in any other unit, or missing from the baseline, are not
+ * compared.
+ * bench/baseline.json is the baseline of the full suite.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+#include <functional>
+#include <Mesh.h>
+
+namespace bench {
+
+using Function = std::function<void()>;
+
+struct Registrar {
+    Registrar(const std::string &name, Function function);
+};
+
+// Runs fn once to warm caches, then `iterations` more times, and reports the
+// fastest and mean wall time under the given label.
+double measure(const std::string &label, int iterations, const Function &fn);
+
+// Reports an additional named value alongside the timings.
+void report(const std::string &label, double value, const std::string &unit);
+
+// Reports a value that optimizations must not change, such as a contour
+// count or an area, to be compared with the baseline to 1e-9.
+void check(const std::string &label, double value);
+
+// Returns the number of heap allocations made by the process so far, counted
+// by the global operator new.
+size_t allocations();
+
+// Loads one of the models bundled in test/models.
+const Geometry& model(const std::string &name);
+
+}
+
+#define BENCHMARK(name) \
+    static void name(); \
+    static bench::Registrar name##_registrar{#name, name}; \
+    static void name()
+
+#endif /* BENCH_H */
@@ -0,0 +1,98 @@
+#include "Bench.h"
+#include <Bvh.h>
+#include <random>
+
+namespace {
+
+using Point = Geometry::Point;
+
+void bounds(const Geometry &geometry, Point &lo, Point &hi) {
+    lo = hi = geometry.positions()[0];
+    for (const Point &p: geometry.positions()) {
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a], p[a]);
+            hi[a] = std::max(hi[a], p[a]);
+        }
+    }
+}
+
+// A 512x512 grid of parallel rays along -z, in scanline order, so that
+// neighbouring rays visit the same nodes.
+std::vector<Ray> coherentRays(const Geometry &geometry) {
+    Point lo, hi;
+    bounds(geometry, lo, hi);
+    const int n = 512;
+    std::vector<Ray> rays(n * n);
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            Ray &ray = rays[j * n + i];
+            ray.origin = {lo[0] + (hi[0] - lo[0]) * (i + 0.5) / n, lo[1] + (hi[1] - lo[1]) * (j + 0.5) / n, hi[2] + 1};
+            ray.direction = {0, 0, -1};
+        }
+    }
+    return rays;
+}
+
+// Rays between random points of the bounding box, in any direction.
+std::vector<Ray> incoherentRays(const Geometry &geometry) {
+    Point lo, hi;
+    bounds(geometry, lo, hi);
+    std::mt19937 random{7};
+    std::uniform_real_distribution<double> unit{0, 1};
+    auto inBox = [&]() -> Point {
+        return {lo[0] + (hi[0] - lo[0]) * unit(random), lo[1] + (hi[1] - lo[1]) * unit(random),
+                lo[2] + (hi[2] - lo[2]) * unit(random)};
+    };
+    std::vector<Ray> rays(1 << 18);
+    for (Ray &ray: rays) {
+        ray.origin = inBox();
+        Point to = inBox();
+        ray.direction = {to[0] - ray.origin[0], to[1] - ray.origin[1], to[2] - ray.origin[2]};
+    }
+    return rays;
+}
+
+}
+
+// Builds the hierarchy on one thread and on every thread.
+BENCHMARK(BvhBuild) {
+    for (const char *name: {"bunny.obj", "sphere.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        bench::measure(std::string(name) + "-1", 5, [&]() { Bvh bvh{geometry, 1}; });
+        bench::measure(std::string(name) + "-all", 5, [&]() { Bvh bvh{geometry, 0}; });
+    }
+}
+
+// Casts coherent and incoherent rays one at a time and in packets.
+BENCHMARK(BvhRays) {
+    for (const char *name: {"bunny.obj", "sphere.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        Bvh bvh{geometry, 0};
+        for (bool coherent: {true, false}) {
+            std::vector<Ray> rays = coherent ? coherentRays(geometry) : incoherentRays(geometry);
+            std::vector<RayHit> hits(rays.size());
+            std::string label = std::string(name) + (coherent ? "/coherent" : "/incoherent");
+
+            double single = bench::measure(label + "-single", 3, [&]() {
+                for (size_t i = 0; i < rays.size(); i++) bvh.intersect(rays[i], hits[i]);
+            });
+            bench::report(label + "-single", rays.size() / single / 1e3, "Mrays/s");
+            double packed = bench::measure(label + "-packet", 3, [&]() {
+                bvh.intersect(rays.data(), hits.data(), rays.size(), 1);
+            });
+            bench::report(label + "-packet", rays.size() / packed / 1e3, "Mrays/s");
+        }
+    }
+}
+
+// Finds the nearest surface point to random points of the bounding box.
+BENCHMARK(BvhClosest) {
+    const Geometry &geometry = bench::model("bunny.obj");
+    Bvh bvh{geometry, 0};
+    std::vector<Ray> rays = incoherentRays(geometry);
+    rays.resize(1 << 16);
+    double ms = bench::measure("bunny.obj", 3, [&]() {
+        for (const Ray &ray: rays) bvh.closest(ray.origin);
+    });
+    bench::report("bunny.obj", rays.size() / ms / 1e3, "Mqueries/s");
+}
@@ -0,0 +1,119 @@
+/**
+ * \file Generators.h
+ * \brief Procedurally generated meshes of arbitrary size
+ */
+
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <vector>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+
+namespace bench {
+
+struct TriangleMesh {
+    std::vector<std::array<double, 3>> positions;
+    std::vector<std::array<int, 3>> faces;
+};
+
+// A closed torus standing on its rim, with its axis along y, tessellated
+// into a grid of `rings` by `segments` quads, each split into two
+// triangles that face outward.
+inline TriangleMesh torus(int rings, int segments, double R = 2.0, double r = 1.0) {
+    TriangleMesh mesh;
+    mesh.positions.reserve(rings * segments);
+    mesh.faces.reserve(2 * rings * segments);
+
+    for (int i = 0; i < rings; i++) {
+        double u = 2 * M_PI * i / rings;
+        for (int j = 0; j < segments; j++) {
+            double v = 2 * M_PI * j / segments;
+            mesh.positions.push_back({
+                (R + r * std::cos(v)) * std::cos(u),
+                r * std::sin(v),
+                (R + r * std::cos(v)) * std::sin(u),
+            });
+        }
+    }
+
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < segments; j++) {
+            int a = i * segments + j;
+            int b = ((i + 1) % rings) * segments + j;
+            int c = ((i + 1) % rings) * segments + (j + 1) % segments;
+            int d = i * segments + (j + 1) % segments;
+            mesh.faces.push_back({a, c, b});
+            mesh.faces.push_back({a, d, c});
+        }
+    }
+    return mesh;
+}
+
+// A closed unit icosphere centered on the origin: an icosahedron whose
+// faces are split into four, with the new vertices pushed out onto the
+// sphere, `subdivisions` times over. It has 20 * 4^subdivisions faces, so
+// 7 gives about 330 thousand and 8 about 1.3 million.
+inline TriangleMesh sphere(int subdivisions, double radius = 1.0) {
+    const double t = (1 + std::sqrt(5.0)) / 2;
+    TriangleMesh mesh;
+    mesh.positions = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                      {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+    mesh.faces = {{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11}, {1, 5, 9}, {5, 11, 4},
+                  {11, 10, 2}, {10, 7, 6}, {7, 1, 8}, {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8},
+                  {3, 8, 9}, {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+    auto project = [&](std::array<double, 3> p) -> std::array<double, 3> {
+        double length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        return {p[0] / length * radius, p[1] / length * radius, p[2] / length * radius};
+    };
+    for (auto &p: mesh.positions) p = project(p);
+
+    for (int level = 0; level < subdivisions; level++) {
+        // Each edge is split once, by whichever of its faces comes first.
+        std::unordered_map<uint64_t, int> midpoints;
+        midpoints.reserve(mesh.faces.size() * 3 / 2);
+        auto midpoint = [&](int a, int b) {
+            uint64_t key = uint64_t(std::min(a, b)) << 32 | uint32_t(std::max(a, b));
+            auto [it, inserted] = midpoints.emplace(key, mesh.positions.size());
+            if (inserted) {
+                const auto &p = mesh.positions[a], &q = mesh.positions[b];
+                mesh.positions.push_back(project({(p[0] + q[0]) / 2, (p[1] + q[1]) / 2, (p[2] + q[2]) / 2}));
+            }
+            return it->second;
+        };
+
+        std::vector<std::array<int, 3>> faces;
+        faces.reserve(mesh.faces.size() * 4);
+        for (const auto &f: mesh.faces) {
+            int ab = midpoint(f[0], f[1]), bc = midpoint(f[1], f[2]), ca = midpoint(f[2], f[0]);
+            faces.push_back({f[0], ab, ca});
+            faces.push_back({f[1], bc, ab});
+            faces.push_back({f[2], ca, bc});
+            faces.push_back({ab, bc, ca});
+        }
+        mesh.faces.swap(faces);
+    }
+    return mesh;
+}
+
+// The mesh as the text of an OBJ file.
+inline std::string objText(const TriangleMesh &mesh) {
+    std::string text;
+    char line[128];
+    for (const auto &p: mesh.positions) {
+        text.append(line, std::snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", p[0], p[1], p[2]));
+    }
+    for (const auto &f: mesh.faces) {
+        text.append(line, std::snprintf(line, sizeof(line), "f %d %d %d\n", f[0] + 1, f[1] + 1, f[2] + 1));
+    }
+    return text;
+}
+
+}
+
+#endif /* GENERATORS_H */
@@ -0,0 +1,29 @@
+#include "Bench.h"
+#include <Infill.h>
+
+// Infill of every layer of a sliced model for each pattern, on one worker
+// and on all of them.
+BENCHMARK(InfillLayers) {
+    for (const char *name: {"bunny.obj", "sphere.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        std::vector<Slicer::Polygons> layers;
+        Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.002), [&](int, double, const Slicer::Polygons &polygons) {
+            layers.push_back(polygons);
+        });
+
+        for (InfillPattern pattern: {InfillPattern::Lines, InfillPattern::Grid, InfillPattern::Triangles}) {
+            InfillSettings settings;
+            settings.pattern = pattern;
+            settings.lineWidth = 0.0001;
+            const char *patternName = pattern == InfillPattern::Lines ? "lines" : pattern == InfillPattern::Grid ? "grid" : "triangles";
+
+            size_t segments = 0;
+            for (const InfillPath &path: infillLayers(layers, settings)) segments += path.size();
+            for (unsigned threads: {1u, 0u}) {
+                std::string label = std::string(name) + "/" + patternName + (threads ? "-1" : "-all");
+                double ms = bench::measure(label, 5, [&]() { infillLayers(layers, settings, threads); });
+                bench::report(label + "-rate", segments / ms / 1e3, "Msegments/s");
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#include "Bench.h"
+#include <LayerStack.h>
+#include <filesystem>
+#include <cstdio>
+
+// Writes the 201 layers of sphere.obj at 0.01 spacing to a layer stack,
+// with contours only and with 1-bit masks, and reads every layer back.
+BENCHMARK(LayerStackIO) {
+    const Geometry &geometry = bench::model("sphere.obj");
+    std::vector<double> zs;
+    std::vector<Slicer::Polygons> layers;
+    Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.01), [&](int, double z, const Slicer::Polygons &polygons) {
+        zs.push_back(z);
+        layers.push_back(polygons);
+    });
+
+    LayerStackSettings settings;
+    settings.raster.pitch = 0.002;
+    std::vector<Mask> masks(layers.size());
+    for (size_t i = 0; i < layers.size(); i++) rasterize(layers[i], settings.raster, masks[i]);
+
+    const std::string path = "/tmp/halfedge-bench.hels";
+    for (bool withMasks: {false, true}) {
+        settings.masks = withMasks;
+        std::string label = withMasks ? "sphere.obj/masks" : "sphere.obj/contours";
+        double ms = bench::measure(label + "-write", 3, [&]() {
+            LayerStackWriter writer{path, settings};
+            for (size_t i = 0; i < layers.size(); i++) {
+                writer.write(zs[i], layers[i], withMasks ? &masks[i] : nullptr);
+            }
+            writer.finish();
+        });
+        bench::report(label + "-write-rate", layers.size() / ms * 1000, "layers/s");
+        bench::report(label + "-bytes-per-layer", std::filesystem::file_size(path) / layers.size(), "B");
+
+        LayerStackReader reader{path};
+        Mask mask;
+        ms = bench::measure(label + "-read", 3, [&]() {
+            for (size_t i = 0; i < reader.layers(); i++) {
+                reader.contours(i);
+                if (withMasks) reader.mask(i, mask);
+            }
+        });
+        bench::report(label + "-read-rate", layers.size() / ms * 1000, "layers/s");
+    }
+    std::remove(path.c_str());
+}
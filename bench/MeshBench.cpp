@@ -0,0 +1,87 @@
+#include "Bench.h"
+#include "Generators.h"
+#include <IndexedMesh.h>
+#include <Connectivity.h>
+#include <map>
+#include <algorithm>
+
+// Compares the memory footprint of the two half-edge layouts and the cost of
+// walking every vertex fan and every twin/next hop through them.
+static void compareLayouts(const std::string &name) {
+    const Mesh &mesh = bench::model(name).mesh();
+    IndexedMesh indexed{mesh};
+
+    bench::report(name + "/pointer-bytes", mesh.memoryUsage(), "bytes");
+    bench::report(name + "/indexed-bytes", indexed.memoryUsage(), "bytes");
+    bench::report(name + "/bytes-ratio", (double) mesh.memoryUsage() / indexed.memoryUsage(), "x");
+
+    size_t sum = 0;
+    bench::measure(name + "/pointer-traversal", 10, [&]() {
+        for (auto &v: mesh.vertices()) {
+            const HalfEdge *h = v.halfedge;
+            do {
+                sum += h->face->index;
+                h = h->prev->twin;
+            } while (h && h != v.halfedge);
+        }
+        for (auto &h: mesh.halfedges()) {
+            if (!h.onBoundary) sum += h.twin->next->vertex->index;
+        }
+    });
+
+    bench::measure(name + "/indexed-traversal", 10, [&]() {
+        for (IndexedMesh::Index v = 0; v < indexed.vertexCount(); v++) {
+            indexed.vertexFaces(v, [&](auto f) { sum += f; });
+        }
+        for (IndexedMesh::Index h = 0; h < indexed.halfedgeCount(); h++) {
+            if (!indexed.onBoundary(h)) sum += indexed.vertex(indexed.next(indexed.twin(h)));
+        }
+    });
+    bench::report(name + "/checksum", sum % 1000, "");
+}
+
+BENCHMARK(HalfEdgeLayouts) {
+    compareLayouts("bunny.obj");
+    compareLayouts("sphere.obj");
+}
+
+// The twin matching that Mesh::Mesh used before it moved to a radix sort,
+// kept as a reference point for the connectivity benchmark.
+static size_t mapConnectivity(const std::vector<std::array<int, 3>> &faces) {
+    std::map<std::pair<int, int>, std::pair<int, bool>> edges;
+    for (int i = 0; i < faces.size(); i++) {
+        for (int j = 0; j < 3; j++) {
+            auto key = std::minmax(faces[i][j], faces[i][(j + 1) % 3]);
+            auto it = edges.find(key);
+            if (it == edges.end()) {
+                edges.emplace(key, std::make_pair(3 * i + j, false));
+            } else {
+                it->second.second = true;
+            }
+        }
+    }
+    return edges.size();
+}
+
+// Connectivity construction time as the face count grows.
+BENCHMARK(ConnectivityScaling) {
+    for (int n: {64, 256, 1024}) {
+        auto mesh = bench::torus(n, n / 2);
+        std::string label = "torus-" + std::to_string(mesh.faces.size());
+        int iterations = n < 1024 ? 5 : 1;
+
+        bench::measure(label + "/map", iterations, [&]() {
+            mapConnectivity(mesh.faces);
+        });
+        bench::measure(label + "/radix-1-thread", iterations, [&]() {
+            computeConnectivity(mesh.positions.size(), mesh.faces, 1);
+        });
+        double ms = bench::measure(label + "/radix-all-threads", iterations, [&]() {
+            computeConnectivity(mesh.positions.size(), mesh.faces, 0);
+        });
+        bench::report(label + "/faces-per-second", mesh.faces.size() / ms * 1000, "faces/s");
+        bench::measure(label + "/mesh", iterations, [&]() {
+            Mesh{(int) mesh.positions.size(), mesh.faces};
+        });
+    }
+}
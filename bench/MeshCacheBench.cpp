@@ -0,0 +1,39 @@
+#include "Bench.h"
+#include "Generators.h"
+#include <MeshCache.h>
+#include <ObjReader.h>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+
+// Compares building a Geometry from an OBJ file, which parses the text and
+// matches twins, against loading the same Geometry from its cache file.
+static void compareLoading(const std::string &name, const std::string &path) {
+    std::string cache = "/tmp/halfedge-bench.hemc";
+    MeshData data = readOBJ(path);
+    writeMeshCache(cache, Geometry{std::move(data.positions), data.faces}, path);
+    bench::report(name + "/cache-bytes", std::filesystem::file_size(cache), "bytes");
+
+    bench::measure(name + "/obj-build", 5, [&]() {
+        MeshData data = readOBJ(path, 1);
+        Geometry geometry{std::move(data.positions), data.faces, 1};
+    });
+    bench::measure(name + "/cache-load", 5, [&]() {
+        readMeshCache(cache, path, 1);
+    });
+    std::remove(cache.c_str());
+}
+
+BENCHMARK(CacheLoading) {
+    compareLoading("bunny.obj", "test/models/bunny.obj");
+
+    bench::TriangleMesh torus = bench::torus(1000, 1000);
+    std::string path = "/tmp/halfedge-bench-torus.obj";
+    {
+        std::ofstream out{path};
+        for (auto &p: torus.positions) out << "v " << p[0] << " " << p[1] << " " << p[2] << "\n";
+        for (auto &f: torus.faces) out << "f " << f[0] + 1 << " " << f[1] + 1 << " " << f[2] + 1 << "\n";
+    }
+    compareLoading("torus-2M", path);
+    std::remove(path.c_str());
+}
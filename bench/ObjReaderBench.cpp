@@ -0,0 +1,54 @@
+#include "Bench.h"
+#include "Generators.h"
+#include <ObjReader.h>
+#include <Parallel.h>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+// The istream reader that Geometry used before the mapped reader, reduced to
+// its tokenizing, kept as a reference point.
+static size_t streamRead(const std::string &path) {
+    std::ifstream f{path};
+    std::string first;
+    double r[3];
+    size_t count = 0;
+    while (!(f >> first).eof()) {
+        if (first == "v") {
+            f >> r[0] >> r[1] >> r[2];
+        } else if (first == "f") {
+            std::string line, word;
+            std::getline(f, line);
+            std::stringstream ss{line};
+            while (ss >> word) count += std::stoi(word);
+        } else {
+            f.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+    }
+    return count;
+}
+
+// Parse throughput on a generated OBJ file of about 60 MB.
+BENCHMARK(ObjParsing) {
+    auto mesh = bench::torus(1024, 512);
+    std::string path = "/tmp/halfedge-bench.obj";
+    {
+        std::ofstream out{path};
+        out.precision(9);
+        for (auto &p: mesh.positions) out << "v " << p[0] << " " << p[1] << " " << p[2] << "\n";
+        for (auto &f: mesh.faces) out << "f " << f[0] + 1 << " " << f[1] + 1 << " " << f[2] + 1 << "\n";
+    }
+    double megabytes = std::ifstream{path, std::ios::ate}.tellg() / 1e6;
+    bench::report("torus-obj/size", megabytes, "MB");
+
+    double ms = bench::measure("torus-obj/istream", 1, [&]() { streamRead(path); });
+    bench::report("torus-obj/istream-throughput", megabytes / ms * 1000, "MB/s");
+
+    ms = bench::measure("torus-obj/mapped-1-thread", 3, [&]() { readOBJ(path, 1); });
+    bench::report("torus-obj/mapped-1-thread-throughput", megabytes / ms * 1000, "MB/s");
+
+    ms = bench::measure("torus-obj/mapped-all-threads", 3, [&]() { readOBJ(path, hardwareThreads()); });
+    bench::report("torus-obj/mapped-all-threads-throughput", megabytes / ms * 1000, "MB/s");
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,107 @@
+#include "Bench.h"
+#include "Generators.h"
+#include <ObjReader.h>
+#include <LayerStack.h>
+#include <Trace.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+
+namespace {
+
+double signedArea(const Slicer::Polygons &polygons) {
+    double area = 0;
+    for (const auto &polygon: polygons) {
+        for (size_t i = 0; i + 1 < polygon.size(); i++) {
+            area += polygon[i][0] * polygon[i + 1][1] - polygon[i + 1][0] * polygon[i][1];
+        }
+    }
+    return area / 2;
+}
+
+// Runs every stage of slicing an OBJ document into a layer stack of 200
+// layers on one thread, timing each stage, and checks what comes out.
+void pipeline(const std::string &name, const std::string &text, int iterations) {
+    MeshData data;
+    bench::measure(name + "/parse", iterations, [&]() { data = parseOBJ(text, 1); });
+    bench::report(name + "/faces", data.faces.size(), "faces");
+    bench::measure(name + "/mesh", iterations, [&]() { Geometry{data.positions, data.faces, 1}; });
+    Geometry geometry{std::move(data.positions), data.faces, 1};
+
+    double lo[3], hi[3];
+    for (int k = 0; k < 3; k++) {
+        auto [min, max] = std::minmax_element(geometry.positions().begin(), geometry.positions().end(),
+                                              [&](auto &a, auto &b) { return a[k] < b[k]; });
+        lo[k] = (*min)[k];
+        hi[k] = (*max)[k];
+    }
+    const auto zs = Slicer::uniformLayers(lo[2], hi[2], (hi[2] - lo[2]) / 200);
+
+    // The intersect and contour stages interleave layer by layer, so they
+    // are timed by their trace spans.
+    std::vector<Slicer::Polygons> layers;
+    double intersect = std::numeric_limits<double>::infinity(), contour = intersect;
+    trace::enable(true);
+    for (int i = 0; i <= iterations; i++) {
+        trace::reset();
+        layers.clear();
+        Slicer::sliceLayers(geometry, zs, [&](int, double, const Slicer::Polygons &polygons) {
+            layers.push_back(polygons);
+        });
+        for (const auto &stage: trace::summarize().stages) {
+            if (stage.name == "intersect") intersect = std::min(intersect, stage.totalMs);
+            if (stage.name == "contour") contour = std::min(contour, stage.totalMs);
+        }
+    }
+    trace::enable(false);
+    trace::reset();
+    bench::report(name + "/intersect", intersect, "ms");
+    bench::report(name + "/contour", contour, "ms");
+
+    RasterSettings raster;
+    raster.width = raster.height = 1024;
+    raster.pitch = std::max(hi[0] - lo[0], hi[1] - lo[1]) / 1000;
+    raster.centerX = (lo[0] + hi[0]) / 2;
+    raster.centerY = (lo[1] + hi[1]) / 2;
+    const std::string path = "/tmp/halfedge-pipeline.hels";
+    bench::measure(name + "/export", iterations, [&]() {
+        LayerStackWriter stack{path, LayerStackSettings{1e5, true, raster}};
+        Mask mask;
+        for (size_t i = 0; i < layers.size(); i++) {
+            rasterize(layers[i], raster, mask);
+            stack.write(zs[i], layers[i], &mask);
+        }
+        stack.finish();
+    });
+    std::remove(path.c_str());
+
+    size_t contours = 0, points = 0;
+    double area = 0;
+    for (const auto &layer: layers) {
+        contours += layer.size();
+        for (const auto &polygon: layer) points += polygon.size();
+        area += signedArea(layer);
+    }
+    bench::check(name + "/euler-characteristic", geometry.mesh().eulerCharacteristic());
+    bench::check(name + "/contours", contours);
+    bench::check(name + "/points", points);
+    bench::check(name + "/area", area);
+}
+
+}
+
+// The whole pipeline on the bundled models and on generated meshes of
+// millions of faces.
+BENCHMARK(Pipeline) {
+    for (const char *model: {"torus.obj", "bunny.obj", "sphere.obj"}) {
+        std::ifstream file{std::string{"test/models/"} + model};
+        std::stringstream text;
+        text << file.rdbuf();
+        pipeline(model, text.str(), 3);
+    }
+    pipeline("icosphere-7", bench::objText(bench::sphere(7)), 3);
+    pipeline("icosphere-8", bench::objText(bench::sphere(8)), 1);
+    pipeline("torus-1024x1024", bench::objText(bench::torus(1024, 1024)), 1);
+}
@@ -0,0 +1,61 @@
+#include "Bench.h"
+#include <PolygonClipper.h>
+#include <cmath>
+
+namespace {
+
+// A layer of n by n rings, each a 48-gon with a hole, as sliced from a
+// plate of hollow pins: 2 * n * n contours.
+Slicer::Polygons pins(int n, double offset = 0) {
+    Slicer::Polygons polygons;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            for (double r: {0.9, -0.5}) {
+                Slicer::Polygon polygon;
+                for (int k = 0; k <= 48; k++) {
+                    double a = 2 * M_PI * k / 48 * (r > 0 ? 1 : -1);
+                    polygon.push_back({2.0 * i + offset + std::abs(r) * std::cos(a), 2.0 * j + offset + std::abs(r) * std::sin(a)});
+                }
+                polygons.push_back(polygon);
+            }
+        }
+    }
+    return polygons;
+}
+
+}
+
+// Booleans and offsets of single layers with thousands of contours.
+BENCHMARK(PolygonClipping) {
+    for (int n: {32, 64}) {
+        const Slicer::Polygons layer = pins(n), shifted = pins(n, 0.7);
+        const std::string label = std::to_string(2 * n * n) + "-contours";
+        bench::measure(label + "/union", 3, [&]() { clipPolygons(ClipType::Union, layer, shifted); });
+        bench::measure(label + "/difference", 3, [&]() { clipPolygons(ClipType::Difference, layer, shifted); });
+        bench::measure(label + "/offset-miter", 3, [&]() { offsetPolygons(layer, -0.1); });
+        OffsetSettings round;
+        round.join = JoinType::Round;
+        bench::measure(label + "/offset-round", 3, [&]() { offsetPolygons(layer, 0.1, round); });
+        bench::measure(label + "/perimeters-3", 3, [&]() { perimeters(layer, 3, 0.1); });
+    }
+}
+
+// Offsets every layer of a model on one worker and on all of them.
+BENCHMARK(PolygonOffsetLayers) {
+    for (const char *name: {"bunny.obj", "sphere.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        std::vector<Slicer::Polygons> layers;
+        Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.002), [&](int, double, const Slicer::Polygons &polygons) {
+            layers.push_back(polygons);
+        });
+        size_t edges = 0;
+        for (const auto &layer: layers) {
+            for (const auto &polygon: layer) edges += polygon.size();
+        }
+        for (unsigned threads: {1u, 0u}) {
+            std::string label = std::string(name) + (threads ? "-1" : "-all");
+            double ms = bench::measure(label, 3, [&]() { offsetLayers(layers, -0.004, {}, threads); });
+            bench::report(label + "-rate", edges / ms / 1e3, "Medges/s");
+        }
+    }
+}
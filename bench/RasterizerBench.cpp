@@ -0,0 +1,52 @@
+#include "Bench.h"
+#include <Slicer.h>
+#include <Rasterizer.h>
+#include <cstdio>
+
+// Rasterizes 200 layers of sphere.obj at 1920x1080, with the sphere filling
+// most of the image, as a bitmask, in grayscale and with 4x4 supersampling.
+BENCHMARK(Rasterization) {
+    const Geometry &geometry = bench::model("sphere.obj");
+    std::vector<Slicer::Polygons> layers;
+    Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.01), [&](int, double, const Slicer::Polygons &polygons) {
+        layers.push_back(polygons);
+    });
+
+    RasterSettings settings;
+    settings.pitch = 0.002;
+    Mask mask;
+    for (auto [bits, supersample]: {std::pair{1, 1}, std::pair{8, 1}, std::pair{8, 4}}) {
+        settings.bits = bits;
+        settings.supersample = supersample;
+        std::string label = "sphere.obj/" + std::to_string(bits) + "bit-aa" + std::to_string(supersample);
+        double ms = bench::measure(label, 3, [&]() {
+            for (const auto &polygons: layers) rasterize(polygons, settings, mask);
+        });
+        bench::report(label + "-rate", layers.size() / ms * 1000, "layers/s");
+    }
+
+    // Encoding and writing on the calling thread, against the same layers
+    // handed to the background writer.
+    settings.bits = 1;
+    settings.supersample = 1;
+    const std::string path = "/tmp/halfedge-bench-layer.png";
+    double ms = bench::measure("sphere.obj/png-inline", 1, [&]() {
+        for (const auto &polygons: layers) {
+            rasterize(polygons, settings, mask);
+            writePNG(mask, path);
+        }
+    });
+    bench::report("sphere.obj/png-inline-rate", layers.size() / ms * 1000, "layers/s");
+
+    ms = bench::measure("sphere.obj/png-writer", 1, [&]() {
+        MaskWriter writer;
+        for (const auto &polygons: layers) {
+            Mask layer;
+            rasterize(polygons, settings, layer);
+            writer.write(std::move(layer), path);
+        }
+        writer.finish();
+    });
+    bench::report("sphere.obj/png-writer-rate", layers.size() / ms * 1000, "layers/s");
+    std::remove(path.c_str());
+}
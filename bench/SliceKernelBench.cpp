@@ -0,0 +1,40 @@
+#include "Bench.h"
+#include "Generators.h"
+#include <SliceKernel.h>
+#include <Slicer.h>
+
+// Reports triangles/second of the intersection kernel for every instruction
+// set the processor supports, in single and double precision, against one
+// plane and against eight planes per pass over the triangles.
+template <typename T>
+static void measureKernel(const std::string &name, const Geometry &geometry) {
+    SoaMesh<T> mesh{geometry};
+    std::vector<T> zs;
+    for (double z: Slicer::uniformLayers(geometry, 0.2)) zs.push_back(z);
+    std::string precision = sizeof(T) == 4 ? "float" : "double";
+
+    std::vector<Segment<T>> segments;
+    segments.reserve(mesh.faceCount());
+    for (SimdLevel level: {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > supportedSimd()) continue;
+
+        for (size_t planes: {size_t(1), size_t(8)}) {
+            std::string label = name + "/" + precision + "-" + simdName(level) + "-planes-" + std::to_string(planes);
+            double ms = bench::measure(label, 5, [&]() {
+                for (size_t p = 0; p + planes <= zs.size(); p += planes) {
+                    segments.clear();
+                    intersectTriangles(mesh, 0, mesh.faceCount(), &zs[p], planes, segments, level);
+                }
+            });
+            double tests = (double) mesh.faceCount() * (zs.size() / planes * planes);
+            bench::report(label + "-rate", tests / ms * 1000, "triangles/s");
+        }
+    }
+}
+
+BENCHMARK(SliceKernel) {
+    bench::TriangleMesh torus = bench::torus(500, 500);
+    Geometry geometry{std::move(torus.positions), torus.faces};
+    measureKernel<double>("torus-500k", geometry);
+    measureKernel<float>("torus-500k", geometry);
+}
@@ -0,0 +1,62 @@
+#include "Bench.h"
+#include <SliceServer.h>
+#include <Parallel.h>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+
+// Jobs of 200 contour-only layers sent to a server over its socket: the
+// first job on a part, which loads it, a repeat job on the cached part,
+// and the throughput of many clients sending jobs at once.
+BENCHMARK(ServerJobs) {
+    ServerSettings settings;
+    settings.socketPath = "/tmp/halfedge-bench.sock";
+    settings.workers = hardwareThreads();
+    settings.queue = 16;
+    settings.useCacheFiles = false;
+    const std::string cwd = std::filesystem::current_path();
+
+    for (const char *name: {"bunny.obj", "sphere.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        SliceSession session{geometry};
+        const std::string height = std::to_string((session.maxZ() - session.minZ()) / 200);
+        const std::string label = name;
+        const std::vector<std::string> job{
+            "slice", cwd, "--contours-only", "--layer-height", height, "--stack", "/tmp/halfedge-bench.hels",
+            "test/models/" + label
+        };
+
+        bench::measure(label + "/first-job", 3, [&]() {
+            SliceServer server{settings};
+            std::thread serving{[&]() { server.run(); }};
+            serverRequest(settings.socketPath, job);
+            server.stop();
+            serving.join();
+        });
+
+        SliceServer server{settings};
+        std::thread serving{[&]() { server.run(); }};
+        bench::measure(label + "/repeat-job", 10, [&]() { serverRequest(settings.socketPath, job); });
+
+        const int clients = 32, jobs = 4;
+        double ms = bench::measure(label + "/32-clients", 3, [&]() {
+            std::vector<std::thread> threads;
+            for (int c = 0; c < clients; c++) {
+                threads.emplace_back([&, c]() {
+                    auto request = job;
+                    request[6] = "/tmp/halfedge-bench-" + std::to_string(c) + ".hels";
+                    for (int j = 0; j < jobs; j++) serverRequest(settings.socketPath, request);
+                });
+            }
+            for (auto &thread: threads) thread.join();
+        });
+        bench::report(label + "/throughput", clients * jobs / (ms / 1e3), "jobs/s");
+        server.stop();
+        serving.join();
+
+        std::filesystem::remove("/tmp/halfedge-bench.hels");
+        for (int c = 0; c < clients; c++) {
+            std::filesystem::remove("/tmp/halfedge-bench-" + std::to_string(c) + ".hels");
+        }
+    }
+}
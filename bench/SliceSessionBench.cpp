@@ -0,0 +1,35 @@
+#include "Bench.h"
+#include <SliceSession.h>
+
+// A job of 200 layers on a fresh session, which builds its interval tree,
+// sweep and schedule first, against the same job repeated on a session
+// that kept them, with the layers kept in memory.
+BENCHMARK(SessionJobs) {
+    for (const char *name: {"bunny.obj", "sphere.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        const std::string label = name;
+
+        for (unsigned threads: {1u, 4u}) {
+            SliceSettings settings;
+            settings.threads = threads;
+            settings.masks = false;
+            SliceSession session{geometry};
+            settings.layers.height = (session.maxZ() - session.minZ()) / 200;
+            const std::string suffix = "-" + std::to_string(threads);
+
+            MemorySink sink;
+            bench::measure(label + "/first-job" + suffix, 5, [&]() {
+                SliceSession fresh{geometry};
+                fresh.slice(settings, sink);
+            });
+            bench::measure(label + "/repeat-job" + suffix, 5, [&]() { session.slice(settings, sink); });
+        }
+
+        SliceSession session{geometry};
+        const double z = (session.minZ() + session.maxZ()) / 2;
+        double ms = bench::measure(label + "/slice-at", 5, [&]() {
+            for (int i = 0; i < 100; i++) session.sliceAt(z + i * 1e-6);
+        });
+        bench::report(label + "/slice-at-layer", ms * 1e3 / 100, "us");
+    }
+}
@@ -0,0 +1,313 @@
+#include "Bench.h"
+#include <Slicer.h>
+#include <Parallel.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <variant>
+#include <functional>
+
+namespace reference {
+
+// The original intersection stage, kept to measure the flat arrays against:
+// intersections keyed by edge or vertex pointer in ordered maps, a set per
+// face and a recursive chain walk.
+using Intersection = std::variant<const Edge*, const Vertex*>;
+using Edges = std::multimap<Intersection, Intersection>;
+using Points = std::map<Intersection, Slicer::Point>;
+
+void sliceFace(const Geometry &geometry, const Face &face, double z, Points &points, Edges &edges) {
+    std::set<Intersection> intersections;
+    for (const HalfEdge *halfedge: face.adjacentHalfEdges()) {
+        Vertex *v1 = halfedge->vertex;
+        Vertex *v2 = halfedge->next->vertex;
+        const auto &p1 = geometry.positions().at(v1->index);
+        const auto &p2 = geometry.positions().at(v2->index);
+        auto [eminz, emaxz] = std::minmax(p1, p2, [](auto &a, auto &b) { return a[2] < b[2]; });
+
+        if (eminz[2] == z && z == emaxz[2]) {
+            continue;
+        } else if (p1[2] == z) {
+            points.emplace(v1, Slicer::Point{p1[0], p1[1]});
+            intersections.insert(v1);
+        } else if (p2[2] == z) {
+            points.emplace(v2, Slicer::Point{p2[0], p2[1]});
+            intersections.insert(v2);
+        } else if (eminz[2] < z && z < emaxz[2]) {
+            double s = (z - eminz[2]) / (emaxz[2] - eminz[2]);
+            points.emplace(halfedge->edge, Slicer::Point{
+                eminz[0] + s * (emaxz[0] - eminz[0]),
+                eminz[1] + s * (emaxz[1] - eminz[1]),
+            });
+            intersections.insert(halfedge->edge);
+        }
+    }
+    if (intersections.size() == 2) {
+        std::vector<Intersection> entities{intersections.begin(), intersections.end()};
+        edges.emplace(entities[0], entities[1]);
+        edges.emplace(entities[1], entities[0]);
+    }
+}
+
+Slicer::Polygons computeContours(const Points &points, Edges edges) {
+    Slicer::Polygons polygons;
+    while (edges.size() > 0) {
+        Intersection first = edges.begin()->first;
+        Slicer::Polygon polygon;
+
+        std::function<void(Intersection)> build;
+        build = [&](Intersection e) {
+            auto [begin, end] = edges.equal_range(e);
+            std::set<Intersection> nextSet;
+            for (; begin != end; begin++) nextSet.insert(begin->second);
+            std::vector<Intersection> next{nextSet.begin(), nextSet.end()};
+            if (next.empty()) return;
+            auto n1 = next[0];
+            auto n2 = next.size() > 1 ? next[1] : next[0];
+            edges.erase(e);
+            if (edges.find(n1) != edges.end()) {
+                polygon.push_back(points.find(n1)->second);
+                build(n1);
+            } else if (edges.find(n2) != edges.end()) {
+                polygon.push_back(points.find(n2)->second);
+                build(n2);
+            }
+        };
+
+        polygon.push_back(points.find(first)->second);
+        build(first);
+        polygon.push_back(points.find(first)->second);
+        polygons.push_back(polygon);
+    }
+    return polygons;
+}
+
+Slicer::Polygons sliceLayer(const Geometry &geometry, const std::vector<const Face*> &faces, double z) {
+    Points points;
+    Edges edges;
+    for (const Face *face: faces) sliceFace(geometry, *face, z, points, edges);
+    return computeContours(points, std::move(edges));
+}
+
+}
+
+// Compares the original per-layer scan over every face against incremental
+// slicing, slicing each model into the same 500 evenly spaced layers.
+static void compareSweep(const std::string &name) {
+    const Geometry &geometry = bench::model(name);
+    auto [min, max] = std::minmax_element(
+        geometry.positions().begin(),
+        geometry.positions().end(),
+        [](auto &a, auto &b) { return a[2] < b[2]; }
+    );
+    const auto layers = Slicer::uniformLayers(geometry, ((*max)[2] - (*min)[2]) / 500);
+
+    size_t segments = 0;
+    Slicer::Section section{geometry};
+    bench::measure(name + "/full-scan", 3, [&]() {
+        segments = 0;
+        for (double z: layers) {
+            Slicer::sliceTriangles(geometry, z, section);
+            segments += section.segments();
+            Slicer::computeContours(section);
+        }
+    });
+
+    bench::measure(name + "/incremental", 3, [&]() {
+        Slicer::sliceLayers(geometry, layers, [](int, double, const Slicer::Polygons &) {});
+    });
+    bench::report(name + "/segments", segments, "segments");
+}
+
+BENCHMARK(SweepSlicing) {
+    compareSweep("bunny.obj");
+    compareSweep("sphere.obj");
+}
+
+// Re-slices individual layers in random order, as a layer preview would
+// after a settings change, with and without the face interval tree.
+BENCHMARK(RandomAccessLayers) {
+    const Geometry &geometry = bench::model("sphere.obj");
+    std::vector<double> zs;
+    for (int i = 0; i < 50; i++) {
+        zs.push_back(-1.0 + 2.0 * ((i * 37) % 50) / 50);
+    }
+
+    bench::measure("sphere.obj/tree-build", 3, [&]() {
+        Slicer::faceTree(geometry);
+    });
+
+    Slicer::Section section{geometry};
+    bench::measure("sphere.obj/layers-full-scan", 3, [&]() {
+        for (double z: zs) {
+            Slicer::sliceTriangles(geometry, z, section);
+            Slicer::computeContours(section);
+        }
+    });
+
+    IntervalTree tree = Slicer::faceTree(geometry);
+    bench::measure("sphere.obj/layers-interval-tree", 3, [&]() {
+        for (double z: zs) {
+            Slicer::sliceLayer(geometry, tree, z, section);
+        }
+    });
+}
+
+// Slices the same 500 layers of sphere.obj with 1 to N workers.
+BENCHMARK(ParallelScaling) {
+    const Geometry &geometry = bench::model("sphere.obj");
+    const auto layers = Slicer::uniformLayers(geometry, 2.0 / 500);
+
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < hardwareThreads(); threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(hardwareThreads());
+
+    double serial = 0;
+    for (unsigned threads: counts) {
+        double ms = bench::measure("sphere.obj/threads-" + std::to_string(threads), 3, [&]() {
+            Slicer::sliceLayers(geometry, layers, [](int, double, const Slicer::Polygons &) {}, threads);
+        });
+        if (threads == 1) serial = ms;
+        bench::report("sphere.obj/speedup-" + std::to_string(threads), serial / ms, "x");
+    }
+}
+
+// Counts heap allocations per layer in the steady state, after one warm-up
+// pass has grown every buffer, and times the flat intersection arrays
+// against the original map-based intersection stage on the same layers.
+static void compareIntersection(const std::string &name) {
+    const Geometry &geometry = bench::model(name);
+    const auto layers = Slicer::uniformLayers(geometry, 0.01);
+    IntervalTree tree = Slicer::faceTree(geometry);
+
+    std::vector<std::vector<const Face*>> spanning(layers.size());
+    for (size_t i = 0; i < layers.size(); i++) {
+        tree.stab(layers[i], [&](int f) { spanning[i].push_back(&geometry.mesh().faces()[f]); });
+    }
+
+    auto perLayer = [&](const std::string &label, const bench::Function &fn) {
+        fn();
+        size_t before = bench::allocations();
+        fn();
+        double count = bench::allocations() - before;
+        bench::report(name + "/" + label, count / layers.size(), "allocations/layer");
+    };
+
+    Slicer::Section section{geometry};
+    auto flat = [&]() {
+        for (size_t i = 0; i < layers.size(); i++) {
+            Slicer::sliceTriangles(geometry, layers[i], spanning[i], section);
+            Slicer::computeContours(section);
+        }
+    };
+    auto maps = [&]() {
+        for (size_t i = 0; i < layers.size(); i++) {
+            reference::sliceLayer(geometry, spanning[i], layers[i]);
+        }
+    };
+
+    perLayer("maps-allocations", maps);
+    perLayer("flat-allocations", flat);
+    perLayer("tree-layer-allocations", [&]() {
+        for (double z: layers) Slicer::sliceLayer(geometry, tree, z, section);
+    });
+    bench::measure(name + "/maps", 3, maps);
+    bench::measure(name + "/flat", 3, flat);
+}
+
+BENCHMARK(LayerAllocations) {
+    compareIntersection("bunny.obj");
+    compareIntersection("sphere.obj");
+}
+
+// Slices sphere.obj, two units tall, into 4000 layers, the density of 0.01 mm
+// layers through a 40 mm part. Every layer is first sliced independently from
+// the faces that span it, then incrementally from the layer below.
+BENCHMARK(FineLayers) {
+    const Geometry &geometry = bench::model("sphere.obj");
+    const auto layers = Slicer::uniformLayers(geometry, 2.0 / 4000);
+    bench::report("sphere.obj/layers", layers.size(), "layers");
+
+    bench::measure("sphere.obj/independent", 3, [&]() {
+        FaceSweep sweep{geometry};
+        Slicer::Section section{geometry};
+        for (double z: layers) {
+            Slicer::sliceTriangles(geometry, z, sweep.advance(z), section);
+            Slicer::computeContours(section);
+        }
+    });
+
+    size_t updated = 0;
+    bench::measure("sphere.obj/incremental", 3, [&]() {
+        IncrementalSlicer slicer{geometry};
+        updated = 0;
+        for (double z: layers) {
+            slicer.advance(z);
+            updated += slicer.updatedFaces();
+        }
+    });
+    bench::report("sphere.obj/updated-faces-per-layer", (double) updated / layers.size(), "faces");
+}
+
+BENCHMARK(BatchSlicing) {
+    // Face-major batch slicing against the layer-major sweeps, over the same
+    // layers. Every contour is emitted, so each method pays for the same
+    // callback.
+    for (const char *name: {"sphere.obj", "bunny.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        const auto layers = Slicer::uniformLayers(geometry, (name == std::string{"sphere.obj"}) ? 2.0 / 4000 : 0.0005);
+        const std::string label = name;
+        bench::report(label + "/layers", layers.size(), "layers");
+
+        size_t points = 0;
+        auto count = [&](int, double, const Slicer::Polygons &polygons) {
+            for (auto &polygon: polygons) points += polygon.size();
+        };
+
+        bench::measure(label + "/independent", 3, [&]() {
+            IntervalTree tree = Slicer::faceTree(geometry);
+            Slicer::Section section{geometry};
+            for (size_t i = 0; i < layers.size(); i++) {
+                count(i, layers[i], Slicer::sliceLayer(geometry, tree, layers[i], section));
+            }
+        });
+        bench::measure(label + "/incremental", 3, [&]() {
+            Slicer::sliceLayers(geometry, layers, count);
+        });
+        bench::measure(label + "/batch", 3, [&]() {
+            Slicer::sliceBatch(geometry, layers, count);
+        });
+        bench::measure(label + "/batch-" + std::to_string(hardwareThreads()) + "-threads", 3, [&]() {
+            Slicer::sliceBatch(geometry, layers, count, hardwareThreads());
+        });
+    }
+}
+
+// Adaptive layer schedules against uniform layers at the minimum height:
+// the cost of building the schedule, and of slicing at it.
+BENCHMARK(AdaptiveLayers) {
+    for (const char *name: {"sphere.obj", "bunny.obj"}) {
+        const Geometry &geometry = bench::model(name);
+        auto [lo, hi] = std::minmax_element(geometry.positions().begin(), geometry.positions().end(),
+                                            [](auto &a, auto &b) { return a[2] < b[2]; });
+        const double extent = (*hi)[2] - (*lo)[2];
+        LayerSettings settings;
+        settings.adaptive = true;
+        settings.height = extent / 50;
+        settings.minHeight = extent / 2000;
+        settings.tolerance = extent / 1000;
+        const std::string label = name;
+
+        std::vector<double> zs;
+        bench::measure(label + "/schedule", 5, [&]() { zs = Slicer::layerSchedule(geometry, settings); });
+        const auto fine = Slicer::uniformLayers(geometry, settings.minHeight);
+        bench::report(label + "/adaptive-layers", zs.size(), "layers");
+        bench::report(label + "/uniform-layers", fine.size(), "layers");
+
+        auto ignore = [](int, double, const Slicer::Polygons &) {};
+        bench::measure(label + "/slice-adaptive", 3, [&]() { Slicer::sliceLayers(geometry, zs, ignore); });
+        bench::measure(label + "/slice-uniform", 3, [&]() { Slicer::sliceLayers(geometry, fine, ignore); });
+    }
+}
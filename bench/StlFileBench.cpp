@@ -0,0 +1,22 @@
+#include "Bench.h"
+#include <StlFile.h>
+#include <ObjReader.h>
+#include <cstdio>
+
+// Loads each model from its OBJ file and from a binary STL copy, including
+// the vertex welding that STL needs to recover shared vertices.
+static void compareFormats(const std::string &name) {
+    std::string obj = "test/models/" + name;
+    std::string stl = "/tmp/halfedge-bench.stl";
+    writeSTL(stl, bench::model(name));
+
+    bench::measure(name + "/obj-read", 10, [&]() { readOBJ(obj, 1); });
+    bench::measure(name + "/stl-read-weld", 10, [&]() { readSTL(stl); });
+    bench::measure(name + "/stl-read-exact-weld", 10, [&]() { readSTL(stl, 0); });
+    std::remove(stl.c_str());
+}
+
+BENCHMARK(StlLoading) {
+    compareFormats("bunny.obj");
+    compareFormats("sphere.obj");
+}
@@ -0,0 +1,29 @@
+#include "Bench.h"
+#include <Trace.h>
+#include <Slicer.h>
+
+// The cost of a span and a counter on their own, and of tracing a whole
+// sweep of fine layers, with tracing off and on.
+BENCHMARK(TraceOverhead) {
+    const int spans = 1000000;
+    for (bool enabled: {false, true}) {
+        trace::enable(enabled);
+        const std::string label = enabled ? "enabled" : "disabled";
+        double ms = bench::measure(label + "/span", 3, [&]() {
+            for (int i = 0; i < spans; i++) {
+                trace::Scope scope{"span"};
+                trace::count("spans");
+            }
+            trace::reset();
+        });
+        bench::report(label + "/span-cost", ms * 1e6 / spans, "ns");
+
+        const Geometry &geometry = bench::model("sphere.obj");
+        const auto zs = Slicer::uniformLayers(geometry, 2.0 / 4000);
+        bench::measure(label + "/sphere-incremental", 3, [&]() {
+            Slicer::sliceLayers(geometry, zs, [](int, double, const Slicer::Polygons &) {});
+            trace::reset();
+        });
+    }
+    trace::enable(false);
+}
@@ -0,0 +1,20 @@
+#include "Bench.h"
+#include <Voxelizer.h>
+
+// Voxelizes bunny.obj at increasing resolutions, solid and shell separately.
+BENCHMARK(Voxelization) {
+    const Geometry &geometry = bench::model("bunny.obj");
+    for (int resolution: {128, 256, 512}) {
+        VoxelSettings settings;
+        settings.resolution = resolution;
+        settings.threads = 0;
+        std::string label = "bunny.obj/" + std::to_string(resolution);
+        bench::report(label + "-memory", voxelLayout(geometry, settings).bytes() / double(1 << 20), "MiB");
+
+        settings.shell = false;
+        bench::measure(label + "-solid", 3, [&]() { voxelize(geometry, settings); });
+        settings.shell = true;
+        settings.solid = false;
+        bench::measure(label + "-shell", 3, [&]() { voxelize(geometry, settings); });
+    }
+}
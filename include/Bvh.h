@@ -0,0 +1,165 @@
+/**
+ * \file Bvh.h
+ * \author Thomas Barrett
+ * \brief Bounding volume hierarchy over the faces of a mesh
+ *
+ * The hierarchy is built top-down with the surface area heuristic over
+ * binned face centroids and flattened in depth-first order into 32-byte
+ * nodes: the first child of an interior node follows it, and the node
+ * stores the index of the second. Node bounds are single precision,
+ * rounded outward, while triangles and queries stay in double precision,
+ * so a query reports the same faces as a brute-force scan.
+ *
+ * The upper levels are split on the calling thread until the remaining
+ * subtrees are small; the subtrees are then built in parallel and spliced
+ * into place. The split decisions do not depend on the thread count, so
+ * the tree is the same for every thread count.
+ */
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <Mesh.h>
+#include <Voxelizer.h>
+
+#ifndef BVH_H
+#define BVH_H
+
+struct BvhNode {
+    float lo[3];
+    float hi[3];
+    // The second child of an interior node, or the first triangle of a
+    // leaf.
+    uint32_t index;
+    // The number of triangles in a leaf, or 0 for an interior node.
+    uint16_t count;
+    // The axis an interior node was split along.
+    uint8_t axis;
+    uint8_t pad;
+};
+
+static_assert(sizeof(BvhNode) == 32, "BVH nodes should fill half a cache line");
+
+struct Ray {
+    Geometry::Point origin{};
+    Geometry::Point direction{};
+    double tmin = 0;
+    double tmax = std::numeric_limits<double>::infinity();
+};
+
+// The nearest intersection of a ray, at origin + t * direction, with
+// barycentric coordinates (u, v) in its face. Of two faces hit at the
+// same t, the one with the lower index is reported. face is -1 on a miss.
+struct RayHit {
+    double t = std::numeric_limits<double>::infinity();
+    int face = -1;
+    double u = 0;
+    double v = 0;
+};
+
+// The nearest point on the mesh to a query point.
+struct ClosestPoint {
+    Geometry::Point point{};
+    double distance = std::numeric_limits<double>::infinity();
+    int face = -1;
+};
+
+struct BvhBox {
+    Geometry::Point lo;
+    Geometry::Point hi;
+};
+
+class Bvh {
+public:
+    Bvh() = default;
+
+    // Builds the hierarchy over every face of g with `threads` workers; 0
+    // selects one per hardware thread.
+    explicit Bvh(const Geometry &g, unsigned threads = 1);
+
+    const std::vector<BvhNode>& nodes() const { return nodes_; }
+    size_t faces() const { return faces_.size(); }
+
+    // Finds the nearest hit of ray in [tmin, tmax]. Returns whether there
+    // was one.
+    bool intersect(const Ray &ray, RayHit &hit) const;
+
+    // Intersects count rays in packets of 8 that traverse the tree
+    // together, testing each node against the whole packet at once, on
+    // `threads` workers. Gives the same hits as intersecting one at a time.
+    void intersect(const Ray *rays, RayHit *hits, size_t count, unsigned threads = 1) const;
+
+    // Finds the point of the mesh nearest to p within maxDistance.
+    ClosestPoint closest(const Geometry::Point &p,
+                         double maxDistance = std::numeric_limits<double>::infinity()) const;
+
+    // Calls visit(face) for every face whose triangle overlaps the box.
+    template <typename F>
+    void overlapping(const BvhBox &box, F &&visit) const {
+        if (nodes_.empty()) return;
+        const Geometry::Point center{
+            (box.lo[0] + box.hi[0]) / 2, (box.lo[1] + box.hi[1]) / 2, (box.lo[2] + box.hi[2]) / 2,
+        };
+        const Geometry::Point half{
+            (box.hi[0] - box.lo[0]) / 2, (box.hi[1] - box.lo[1]) / 2, (box.hi[2] - box.lo[2]) / 2,
+        };
+
+        std::array<uint32_t, stackSize> stack;
+        size_t top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const BvhNode &node = nodes_[stack[--top]];
+            bool disjoint = false;
+            for (int axis = 0; axis < 3; axis++) {
+                disjoint |= box.lo[axis] > node.hi[axis] || box.hi[axis] < node.lo[axis];
+            }
+            if (disjoint) continue;
+
+            if (node.count > 0) {
+                for (uint32_t i = node.index; i < node.index + node.count; i++) {
+                    if (triangleOverlapsBox(center, half, triangles_[i])) visit(faces_[i]);
+                }
+            } else {
+                stack[top++] = node.index;
+                stack[top++] = &node - nodes_.data() + 1;
+            }
+        }
+    }
+
+    std::vector<int> overlapping(const BvhBox &box) const {
+        std::vector<int> result;
+        overlapping(box, [&](int face) { result.push_back(face); });
+        return result;
+    }
+
+private:
+    struct Reference {
+        Geometry::Point lo, hi, centroid;
+        uint32_t face;
+    };
+    struct Subtree {
+        uint32_t node;
+        uint32_t begin, end;
+        int depth;
+    };
+
+    // Splits below a depth of 40 fall back to the median, so no path is
+    // longer than 72 nodes and a traversal stack of 96 cannot overflow.
+    static constexpr int stackSize = 96;
+
+    uint32_t buildTop(Reference *refs, uint32_t begin, uint32_t end, int depth, std::vector<Subtree> &subtrees);
+    void build(Reference *refs, uint32_t begin, uint32_t end, int depth, std::vector<BvhNode> &nodes) const;
+    bool split(Reference *refs, uint32_t begin, uint32_t end, int depth, BvhNode &node, uint32_t &middle) const;
+    void packet(const Ray *rays, RayHit *hits, size_t count) const;
+
+    std::vector<BvhNode> nodes_;
+    // The triangles in leaf order, and the face each came from.
+    std::vector<std::array<Geometry::Point, 3>> triangles_;
+    std::vector<int> faces_;
+    // The padding added to node bounds, which covers the rounding of a
+    // ray's origin to single precision.
+    float pad_ = 0;
+};
+
+#endif /* BVH_H */
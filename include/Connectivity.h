@@ -0,0 +1,40 @@
+/**
+ * \file Connectivity.h
+ * \author Thomas Barrett
+ * \brief Twin matching for indexed triangle lists
+ */
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+/**
+ * The half-edge connectivity of an indexed triangle list. Half-edge 3f + j
+ * runs from faces[f][j] to faces[f][(j + 1) % 3].
+ */
+struct Connectivity {
+    static constexpr uint32_t invalid = std::numeric_limits<uint32_t>::max();
+
+    // Per half-edge: the opposite half-edge, or invalid on the boundary.
+    std::vector<uint32_t> twins;
+
+    // Per half-edge: the index of its edge. Edges are numbered in the order
+    // in which their first half-edge appears.
+    std::vector<uint32_t> edges;
+
+    // Per edge: the lower-numbered of its half-edges.
+    std::vector<uint32_t> edgeHalfedges;
+};
+
+// Pairs every half-edge with its twin by radix sorting the half-edges on
+// their sorted vertex indices and then pairing equal neighbours in a linear
+// pass. Both steps run on `threads` workers; 0 selects one per hardware
+// thread. Throws std::runtime_error if more than two half-edges share an
+// edge.
+Connectivity computeConnectivity(int vertexCount, const std::vector<std::array<int, 3>> &faces, unsigned threads = 1);
+
+#endif /* CONNECTIVITY_H */
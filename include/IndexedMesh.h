@@ -0,0 +1,106 @@
+/**
+ * \file IndexedMesh.h
+ * \author Thomas Barrett
+ * \brief Index-based half-edge mesh
+ */
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <Mesh.h>
+
+#ifndef INDEXED_MESH_H
+#define INDEXED_MESH_H
+
+/**
+ * A triangle mesh with the same connectivity as Mesh, stored as flat arrays
+ * of 32-bit indices instead of linked structs.
+ *
+ * The three half-edges of face f are 3f, 3f + 1 and 3f + 2, so next, prev,
+ * face and corner are arithmetic on the half-edge index and are not stored.
+ * Each half-edge stores only its twin, origin vertex and edge. Because the
+ * mesh contains no pointers it can be copied, moved and written to disk as
+ * plain memory.
+ */
+class IndexedMesh {
+public:
+    using Index = uint32_t;
+    static constexpr Index invalid = std::numeric_limits<Index>::max();
+
+    IndexedMesh(int vertexCount, const std::vector<std::array<int, 3>> &faces, unsigned threads = 1);
+    explicit IndexedMesh(const Mesh &mesh);
+
+    size_t vertexCount() const { return vertexHalfedge_.size(); }
+    size_t edgeCount() const { return edgeHalfedge_.size(); }
+    size_t faceCount() const { return twin_.size() / 3; }
+    size_t halfedgeCount() const { return twin_.size(); }
+    size_t cornerCount() const { return twin_.size(); }
+
+    bool closed() const;
+    int eulerCharacteristic() const;
+
+    // Bytes held by the connectivity arrays.
+    size_t memoryUsage() const;
+
+    Index next(Index h) const { return h % 3 == 2 ? h - 2 : h + 1; }
+    Index prev(Index h) const { return h % 3 == 0 ? h + 2 : h - 1; }
+    Index twin(Index h) const { return twin_[h]; }
+    Index vertex(Index h) const { return vertex_[h]; }
+    Index edge(Index h) const { return edge_[h]; }
+    Index face(Index h) const { return h / 3; }
+    Index corner(Index h) const { return h; }
+    bool onBoundary(Index h) const { return twin_[h] == invalid; }
+
+    Index vertexHalfedge(Index v) const { return vertexHalfedge_[v]; }
+    Index edgeHalfedge(Index e) const { return edgeHalfedge_[e]; }
+    Index faceHalfedge(Index f) const { return 3 * f; }
+    Index cornerHalfedge(Index c) const { return c; }
+
+    std::array<Index, 3> faceHalfedges(Index f) const {
+        return {3 * f, 3 * f + 1, 3 * f + 2};
+    }
+
+    std::array<Index, 3> faceVertices(Index f) const {
+        return {vertex_[3 * f], vertex_[3 * f + 1], vertex_[3 * f + 2]};
+    }
+
+    std::array<Index, 3> faceEdges(Index f) const {
+        return {edge_[3 * f], edge_[3 * f + 1], edge_[3 * f + 2]};
+    }
+
+    // The second face is invalid for boundary edges.
+    std::array<Index, 2> edgeFaces(Index e) const {
+        Index h = edgeHalfedge_[e];
+        return {face(h), onBoundary(h) ? invalid : face(twin_[h])};
+    }
+
+    // Calls visit(face) for every face around vertex v. On the boundary the
+    // fan is walked in both directions from the vertex's half-edge. An
+    // isolated vertex has no half-edge and no faces.
+    template <typename F>
+    void vertexFaces(Index v, F &&visit) const {
+        Index start = vertexHalfedge_[v];
+        if (start == invalid) return;
+        Index h = start;
+        do {
+            visit(face(h));
+            h = twin_[prev(h)];
+        } while (h != invalid && h != start);
+
+        if (h == invalid) {
+            for (h = twin_[start]; h != invalid; h = twin_[next(h)]) {
+                visit(face(h));
+            }
+        }
+    }
+
+private:
+    std::vector<Index> twin_;
+    std::vector<Index> vertex_;
+    std::vector<Index> edge_;
+    std::vector<Index> vertexHalfedge_;
+    std::vector<Index> edgeHalfedge_;
+};
+
+#endif /* INDEXED_MESH_H */
@@ -0,0 +1,98 @@
+/**
+ * \file Infill.h
+ * \author Thomas Barrett
+ * \brief Sparse infill toolpaths clipped to layer regions
+ *
+ * Infill is a family of parallel lines, or two or three families for the
+ * grid and triangle patterns, clipped to the interior of a layer. Each
+ * family is generated by a scanline pass in a frame rotated so that its
+ * lines run along the u axis: the region's edges are bucketed in an edge
+ * table by the first line they cross, an active edge list holds the edges
+ * spanning the current line, and the sorted crossings of the line pair up
+ * into segments under the even-odd rule. The cost of a layer is linear in
+ * its edges plus the crossings found.
+ *
+ * Lines lie at multiples of the spacing from the model origin rather than
+ * from the region, so the infill of consecutive layers lines up, and the
+ * three families of the triangle pattern meet at common points.
+ */
+
+#include <array>
+#include <vector>
+#include <Slicer.h>
+
+#ifndef INFILL_H
+#define INFILL_H
+
+enum class InfillPattern {
+    // One family of lines, turned by 90 degrees on every other layer.
+    Lines,
+    // Two families at right angles on every layer.
+    Grid,
+    // Three families 60 degrees apart on every layer.
+    Triangles
+};
+
+struct InfillSettings {
+    InfillPattern pattern = InfillPattern::Lines;
+    // The fraction of the region covered by extrusions; 0 disables infill.
+    double density = 0.2;
+    // The width of an extrusion in model units.
+    double lineWidth = 0.4;
+    // The direction of the first family of lines, in degrees from the x
+    // axis.
+    double angle = 45;
+};
+
+// A straight extrusion from a to b in model units.
+struct InfillSegment {
+    std::array<double, 2> a, b;
+};
+using InfillPath = std::vector<InfillSegment>;
+
+// The distance between neighbouring lines of one family, which spreads the
+// density over the families of the pattern.
+double infillSpacing(const InfillSettings &settings);
+
+/**
+ * Generates the infill of one layer at a time, keeping its edge table from
+ * one layer to the next so that a generator reused across layers stops
+ * allocating once it has seen the largest of them. A generator must only be
+ * used by one thread at a time.
+ */
+class InfillGenerator {
+public:
+    explicit InfillGenerator(const InfillSettings &settings);
+
+    // Replaces result with the infill of the region bounded by contours on
+    // the given layer. The contours are filled with the even-odd rule and
+    // would normally be the innermost perimeter offset inward by half a
+    // line width. Within a family, segments are ordered line by line and
+    // alternate in direction, so that the travel between them is short.
+    void generate(const Slicer::Polygons &contours, int layer, InfillPath &result);
+
+private:
+    // An edge in the rotated frame, crossing lines [first, last).
+    struct ScanEdge {
+        double u0, v0, dudv;
+        int first, last;
+        int next;
+    };
+
+    void scan(const Slicer::Polygons &contours, double angle, InfillPath &result);
+
+    InfillSettings settings_;
+    double spacing_;
+    std::vector<ScanEdge> edges_;
+    std::vector<int> starts_;
+    std::vector<int> active_;
+    std::vector<double> crossings_;
+};
+
+// Generates the infill of every layer on `threads` workers, each with a
+// generator of its own; 0 selects one per hardware thread. Layer i of the
+// result is the infill of layers[i] as layer i.
+std::vector<InfillPath> infillLayers(const std::vector<Slicer::Polygons> &layers, const InfillSettings &settings,
+                                     unsigned threads = 1);
+
+#endif /* INFILL_H */
@@ -1,26 +1,167 @@
 #ifndef INTERVAL_TREE_H
 #define INTERVAL_TREE_H
 
-struct IntervalTreeNode {
-
-};
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
 
+/**
+ * A static centered interval tree over closed intervals [min, max].
+ *
+ * Nodes are stored in a single preorder array and every interval is stored
+ * twice, once in a run sorted by ascending minimum and once in a run sorted
+ * by descending maximum. A node refers to its runs by offset, so the whole
+ * tree lives in three flat vectors and a query never touches the heap.
+ * Queries report the index of each matching interval in O(log n + k).
+ */
 class IntervalTree {
 private:
     struct Node {
-        double x;
+        double center;
+        uint32_t begin;
+        uint32_t end;
+        int32_t left;
+        int32_t right;
+    };
+
+    struct Entry {
+        double key;
+        uint32_t index;
     };
 
-    std::vector<Node> tree_;
+    std::vector<Node> nodes_;
+    std::vector<Entry> byMin_;
+    std::vector<Entry> byMax_;
+
+    int32_t build(const std::vector<double> &min, const std::vector<double> &max,
+                  uint32_t *begin, uint32_t *end, std::vector<double> &endpoints) {
+        if (begin == end) return -1;
+
+        // The median endpoint leaves at most half of the intervals entirely
+        // on either side, which bounds the depth of the tree by log2(n).
+        endpoints.clear();
+        for (auto it = begin; it != end; it++) {
+            endpoints.push_back(min[*it]);
+            endpoints.push_back(max[*it]);
+        }
+        auto median = endpoints.begin() + endpoints.size() / 2;
+        std::nth_element(endpoints.begin(), median, endpoints.end());
+        double center = *median;
+
+        uint32_t *left = std::partition(begin, end, [&](uint32_t i) { return max[i] < center; });
+        uint32_t *right = std::partition(left, end, [&](uint32_t i) { return min[i] <= center; });
+
+        int32_t index = nodes_.size();
+        nodes_.push_back({center, (uint32_t) byMin_.size(), 0, -1, -1});
+        for (auto it = left; it != right; it++) {
+            byMin_.push_back({min[*it], *it});
+            byMax_.push_back({max[*it], *it});
+        }
+        nodes_[index].end = byMin_.size();
+
+        auto first = byMin_.begin() + nodes_[index].begin;
+        std::sort(first, byMin_.end(), [](auto &a, auto &b) { return a.key < b.key; });
+        first = byMax_.begin() + nodes_[index].begin;
+        std::sort(first, byMax_.end(), [](auto &a, auto &b) { return a.key > b.key; });
+
+        int32_t l = build(min, max, begin, left, endpoints);
+        int32_t r = build(min, max, right, end, endpoints);
+        nodes_[index].left = l;
+        nodes_[index].right = r;
+        return index;
+    }
+
 public:
-    IntervalTree(std::vector<double> min, std::vector<double> max) {
-        std::set<double> elementary_intervals;
-        elementary_intervals.insert(min.begin(), min.end());
-        elementary_intervals.insert(max.begin(), max.end());
-        tree_.resize(elementary_intervals.size());
+    IntervalTree() = default;
+
+    IntervalTree(const std::vector<double> &min, const std::vector<double> &max) {
+        assert(min.size() == max.size());
+        nodes_.reserve(min.size());
+        byMin_.reserve(min.size());
+        byMax_.reserve(min.size());
+
+        std::vector<uint32_t> indices(min.size());
+        for (uint32_t i = 0; i < indices.size(); i++) indices[i] = i;
+        std::vector<double> endpoints;
+        endpoints.reserve(2 * min.size());
+        build(min, max, indices.data(), indices.data() + indices.size(), endpoints);
+    }
+
+    size_t size() const { return byMin_.size(); }
+
+    // Calls visit(index) for every interval that contains z.
+    template <typename F>
+    void stab(double z, F &&visit) const {
+        int32_t n = nodes_.empty() ? -1 : 0;
+        while (n != -1) {
+            const Node &node = nodes_[n];
+            if (z < node.center) {
+                for (uint32_t i = node.begin; i < node.end && byMin_[i].key <= z; i++) {
+                    visit(byMin_[i].index);
+                }
+                n = node.left;
+            } else if (z > node.center) {
+                for (uint32_t i = node.begin; i < node.end && byMax_[i].key >= z; i++) {
+                    visit(byMax_[i].index);
+                }
+                n = node.right;
+            } else {
+                for (uint32_t i = node.begin; i < node.end; i++) {
+                    visit(byMin_[i].index);
+                }
+                break;
+            }
+        }
+    }
+
+    // Calls visit(index) for every interval that overlaps [z0, z1].
+    template <typename F>
+    void overlap(double z0, double z1, F &&visit) const {
+        assert(z0 <= z1);
+        if (nodes_.empty()) return;
+
+        // A node only defers a sibling while descending, so the stack never
+        // holds more entries than the depth of the tree.
+        std::array<int32_t, 128> stack;
+        size_t top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            const Node &node = nodes_[stack[--top]];
+            if (z1 < node.center) {
+                for (uint32_t i = node.begin; i < node.end && byMin_[i].key <= z1; i++) {
+                    visit(byMin_[i].index);
+                }
+                if (node.left != -1) stack[top++] = node.left;
+            } else if (z0 > node.center) {
+                for (uint32_t i = node.begin; i < node.end && byMax_[i].key >= z0; i++) {
+                    visit(byMax_[i].index);
+                }
+                if (node.right != -1) stack[top++] = node.right;
+            } else {
+                for (uint32_t i = node.begin; i < node.end; i++) {
+                    visit(byMin_[i].index);
+                }
+                if (node.left != -1) stack[top++] = node.left;
+                if (node.right != -1) stack[top++] = node.right;
+            }
+            assert(top + 2 <= stack.size());
+        }
+    }
+
+    std::vector<int> stab(double z) const {
+        std::vector<int> result;
+        stab(z, [&](int i) { result.push_back(i); });
+        return result;
     }
 
-    priva
-}
+    std::vector<int> overlap(double z0, double z1) const {
+        std::vector<int> result;
+        overlap(z0, z1, [&](int i) { result.push_back(i); });
+        return result;
+    }
+};
 
-#endif /* INTERVAL_TREE_H */
\ No newline at end of file
+#endif /* INTERVAL_TREE_H */
@@ -0,0 +1,138 @@
+/**
+ * \file LayerStack.h
+ * \author Thomas Barrett
+ * \brief Single-file container for the layers of a sliced model
+ *
+ * A layer stack holds the contours of every layer, and optionally its
+ * raster mask, in one file instead of one file per layer and polygon.
+ * Contour points are quantized to integer multiples of a fixed step and
+ * stored as zigzag varint deltas from the previous point; masks are stored
+ * as varint run lengths over the pixels in row order. The file is written
+ * as one sequential stream: a header, the layer records, then an index of
+ * every record and a fixed-size footer that locates the index, so that a
+ * reader maps the file and reaches any layer without reading the others.
+ *
+ * All integers are little-endian. The layout is
+ *
+ *     Header
+ *     layer records: contours, then the mask if the stack has masks
+ *     Index entry for each layer: z, offset, contour bytes, mask bytes
+ *     Footer: index offset, layer count, magic
+ *
+ * and test/scripts/visualize_slice.py reads the same layout.
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstdint>
+#include <Slicer.h>
+#include <Rasterizer.h>
+
+#ifndef LAYER_STACK_H
+#define LAYER_STACK_H
+
+class MappedFile;
+
+struct LayerStackSettings {
+    // Contour coordinates are stored as integer multiples of 1 / scale
+    // model units.
+    double scale = 1e5;
+    // Whether each layer stores a mask rasterized with `raster`.
+    bool masks = false;
+    RasterSettings raster;
+};
+
+// The encoded form of one layer, produced by LayerStackWriter::encode.
+struct LayerRecord {
+    double z = 0;
+    std::string contours;
+    std::string mask;
+};
+
+/**
+ * Writes a layer stack to a temporary file next to path, which is renamed
+ * into place by finish, so that a reader never maps a partial stack.
+ * Encoding is independent per layer and may run on any thread; records are
+ * appended in layer order.
+ */
+class LayerStackWriter {
+public:
+    // Throws std::runtime_error if the file cannot be created.
+    LayerStackWriter(const std::string &path, const LayerStackSettings &settings);
+    ~LayerStackWriter();
+
+    LayerStackWriter(const LayerStackWriter &) = delete;
+    LayerStackWriter& operator=(const LayerStackWriter &) = delete;
+
+    // Encodes a layer. mask is required if and only if the stack has masks.
+    LayerRecord encode(double z, const Slicer::Polygons &polygons, const Mask *mask = nullptr) const;
+
+    // Appends the next layer.
+    void append(const LayerRecord &record);
+    void write(double z, const Slicer::Polygons &polygons, const Mask *mask = nullptr);
+
+    // Writes the index and moves the file into place. Throws
+    // std::runtime_error if any write failed.
+    void finish();
+
+    size_t layers() const { return index_.size(); }
+
+private:
+    struct Entry {
+        double z;
+        uint64_t offset;
+        uint64_t contourBytes;
+        uint64_t maskBytes;
+    };
+
+    std::string path_;
+    std::string temporary_;
+    LayerStackSettings settings_;
+    std::ofstream file_;
+    uint64_t offset_ = 0;
+    std::vector<Entry> index_;
+    bool finished_ = false;
+
+    friend class LayerStackReader;
+};
+
+/**
+ * Reads a layer stack through a memory map. Only the header, footer and
+ * index are validated up front; a layer is decoded when it is requested,
+ * and may be requested from several threads at once.
+ */
+class LayerStackReader {
+public:
+    // Throws std::runtime_error if the file is missing, truncated or not a
+    // layer stack.
+    explicit LayerStackReader(const std::string &path);
+    ~LayerStackReader();
+
+    const LayerStackSettings& settings() const { return settings_; }
+    size_t layers() const { return count_; }
+    double z(size_t layer) const;
+
+    // The first layer at or above z, or layers() if there is none.
+    size_t find(double z) const;
+
+    // Decodes the contours of a layer, in the order they were written, with
+    // every point within 0.5 / scale of the point written.
+    Slicer::Polygons contours(size_t layer) const;
+
+    // Decodes the mask of a layer. Throws std::runtime_error if the stack
+    // has no masks.
+    void mask(size_t layer, Mask &mask) const;
+
+private:
+    using Entry = LayerStackWriter::Entry;
+    Entry entry(size_t layer) const;
+
+    std::unique_ptr<MappedFile> file_;
+    LayerStackSettings settings_;
+    const char *index_ = nullptr;
+    size_t count_ = 0;
+};
+
+#endif /* LAYER_STACK_H */
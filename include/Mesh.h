@@ -8,6 +8,7 @@
 #include <vector>
 #include <array>
 #include <memory>
+#include <Connectivity.h>
 
 #ifndef MESH_HPP
 #define MESH_HPP
@@ -42,6 +43,12 @@ struct Edge {
     std::vector<Face*> adjacentFaces() const {
         return {halfedge->face, halfedge->twin->face};
     }
+
+    // The faces on either side of the edge, without allocating. The second
+    // face is null on the boundary.
+    std::array<Face*, 2> faces() const {
+        return {halfedge->face, halfedge->onBoundary ? nullptr : halfedge->twin->face};
+    }
 };
 
 /**
@@ -82,6 +89,59 @@ struct Face {
             halfedge->next->next
         };
     }
+
+    // Non-allocating equivalents of the adjacent* methods, for inner loops.
+    std::array<HalfEdge*, 3> halfedges() const {
+        return {halfedge, halfedge->next, halfedge->next->next};
+    }
+
+    std::array<Vertex*, 3> vertices() const {
+        return {halfedge->vertex, halfedge->next->vertex, halfedge->next->next->vertex};
+    }
+
+    std::array<Edge*, 3> edges() const {
+        return {halfedge->edge, halfedge->next->edge, halfedge->next->next->edge};
+    }
+};
+
+/**
+ * A range over the faces around a vertex that walks the half-edges in place
+ * rather than collecting them. On the boundary the fan is walked in both
+ * directions from the vertex's half-edge, so every face is visited once.
+ */
+class VertexFaces {
+public:
+    class iterator {
+    public:
+        iterator(HalfEdge *start, HalfEdge *h): start_{start}, h_{h} {}
+
+        Face* operator*() const { return h_->face; }
+        bool operator!=(const iterator &other) const { return h_ != other.h_; }
+
+        iterator& operator++() {
+            if (reversed_) {
+                h_ = h_->next->twin;
+            } else if ((h_ = h_->prev->twin) == start_) {
+                h_ = nullptr;
+            } else if (!h_) {
+                reversed_ = true;
+                h_ = start_->twin;
+            }
+            return *this;
+        }
+
+    private:
+        HalfEdge *start_;
+        HalfEdge *h_;
+        bool reversed_ = false;
+    };
+
+    explicit VertexFaces(HalfEdge *start): start_{start} {}
+    iterator begin() const { return {start_, start_}; }
+    iterator end() const { return {start_, nullptr}; }
+
+private:
+    HalfEdge *start_;
 };
 
 /**
@@ -100,6 +160,11 @@ struct Vertex {
         } while (h != halfedge);
         return faces;
     }
+
+    // The faces around the vertex, without allocating.
+    VertexFaces faces() const {
+        return VertexFaces{halfedge};
+    }
 };
 
 /**
@@ -113,11 +178,23 @@ private:
     std::vector<Corner> corners_;
     std::vector<HalfEdge> halfedges_;
 public:
-    Mesh(int vertexCount, const std::vector<std::array<int, 3>> &faces);
+    // Builds the mesh on `threads` workers; 0 selects one per hardware
+    // thread. Throws std::runtime_error for non-manifold input.
+    Mesh(int vertexCount, const std::vector<std::array<int, 3>> &faces, unsigned threads = 1);
+
+    // Builds the mesh from connectivity computed earlier, for example by a
+    // previous run, which skips twin matching entirely.
+    Mesh(int vertexCount, const std::vector<std::array<int, 3>> &faces, const Connectivity &connectivity, unsigned threads = 1);
 
     bool closed() const;
     int eulerCharacteristic() const;
 
+    // Bytes held by the element arrays.
+    size_t memoryUsage() const;
+
+    // Returns the connectivity of the mesh in index form.
+    Connectivity connectivity() const;
+
     const std::vector<Vertex>& vertices() const { return vertices_; }
     const std::vector<Edge>& edges() const { return edges_; }
     const std::vector<Face>& faces() const { return faces_; }
@@ -125,6 +202,15 @@ public:
     const std::vector<HalfEdge>& halfedges() const { return halfedges_; }
 };
 
+/**
+ * An indexed triangle list, as produced by the file readers before the
+ * half-edge connectivity is built.
+ */
+struct MeshData {
+    std::vector<std::array<double, 3>> positions;
+    std::vector<std::array<int, 3>> faces;
+};
+
 /**
  * 
  */
@@ -132,7 +218,14 @@ class Geometry {
 public:
     using Point = std::array<double, 3>;
     Geometry() = default;
+    // Reads an OBJ document from the stream. Throws std::runtime_error if
+    // it is malformed or has no faces.
     Geometry(std::istream &);
+    Geometry(std::vector<Point> positions, const std::vector<std::array<int, 3>> &faces, unsigned threads = 1);
+    Geometry(std::vector<Point> positions, const std::vector<std::array<int, 3>> &faces,
+             const Connectivity &connectivity, unsigned threads = 1);
+    Geometry(Geometry &&) = default;
+    Geometry& operator=(Geometry &&) = default;
     virtual ~Geometry() = default;
 
     const Mesh& mesh() const { return *mesh_; }
@@ -0,0 +1,50 @@
+/**
+ * \file MeshCache.h
+ * \author Thomas Barrett
+ * \brief Binary mesh cache files
+ *
+ * A cache file holds the positions, faces and precomputed half-edge
+ * connectivity of a Geometry as flat little-endian arrays, so that it can be
+ * memory-mapped and copied into place without any parsing or twin matching.
+ * Each file records a fingerprint of the source file it was built from and
+ * a checksum of its contents; a cache whose source has changed, or whose
+ * contents are damaged, is rejected and rebuilt.
+ */
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include <Mesh.h>
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+/**
+ * Identifies the contents of a source file without reading all of it: its
+ * size, modification time and a hash of its first and last 64 KiB.
+ */
+struct SourceFingerprint {
+    uint64_t size = 0;
+    int64_t modified = 0;
+    uint64_t hash = 0;
+
+    static SourceFingerprint of(const std::string &path);
+    bool operator==(const SourceFingerprint &other) const;
+};
+
+// Writes g to a cache file at cachePath, fingerprinted against sourcePath.
+// Throws std::runtime_error if the file cannot be written.
+void writeMeshCache(const std::string &cachePath, const Geometry &g, const std::string &sourcePath);
+
+// Reads the cache file at cachePath. Returns std::nullopt if the file is
+// missing or cannot be mapped, was written by another version, was built
+// from a different source file, or fails its checksum.
+std::optional<Geometry> readMeshCache(const std::string &cachePath, const std::string &sourcePath, unsigned threads = 1);
+
+// Loads an OBJ or STL file through a cache file stored next to it with a
+// ".hemc" suffix, which is created or rebuilt whenever it cannot be used.
+// The mesh is built on `threads` workers; 0 selects one per hardware
+// thread. Throws std::runtime_error if the source cannot be read.
+Geometry loadGeometry(const std::string &path, unsigned threads = 1, bool useCache = true);
+
+#endif /* MESH_CACHE_H */
@@ -0,0 +1,28 @@
+/**
+ * \file ObjReader.h
+ * \author Thomas Barrett
+ * \brief Wavefront OBJ reader
+ */
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <Mesh.h>
+
+#ifndef OBJ_READER_H
+#define OBJ_READER_H
+
+// Parses the vertices and faces of an OBJ document. Faces may reference
+// vertices as v, v/vt, v//vn or v/vt/vn, with negative indices counting back
+// from the most recent vertex, and polygons with more than three vertices are
+// triangulated as a fan. The text is split into `chunks` line-aligned pieces
+// that are parsed on up to `threads` workers and merged in order. Throws
+// std::runtime_error on malformed input.
+MeshData parseOBJ(std::string_view text, unsigned threads = 1, unsigned chunks = 0);
+
+// Memory-maps and parses the OBJ file at path. Throws std::runtime_error if
+// the file cannot be read, is malformed or has no faces.
+MeshData readOBJ(const std::string &path, unsigned threads = 1);
+
+#endif /* OBJ_READER_H */
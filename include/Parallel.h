@@ -0,0 +1,66 @@
+/**
+ * \file Parallel.h
+ * \brief Work-stealing parallel loops
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using RangeFunction = std::function<void(size_t begin, size_t end, unsigned worker)>;
+
+// Returns the number of hardware threads, or 1 if it cannot be determined.
+unsigned hardwareThreads();
+
+// Calls fn over disjoint chunks of at most `grain` indices that together
+// cover [0, count). Each of the `threads` workers starts with a contiguous
+// block of the range and works through it from the front; a worker whose
+// block is exhausted steals the back half of another worker's block. The
+// calling thread acts as worker 0. A thread count of 0 selects
+// hardwareThreads().
+void parallelFor(size_t count, unsigned threads, size_t grain, const RangeFunction &fn);
+
+/**
+ * A fixed set of threads that run tasks in the order they were submitted.
+ * At most `capacity` tasks wait to be run; submit blocks while the queue
+ * is full, which holds back whoever submits tasks faster than they can be
+ * run. Tasks must not throw.
+ */
+class ThreadPool {
+public:
+    // A thread count of 0 selects hardwareThreads().
+    ThreadPool(unsigned threads, size_t capacity);
+
+    // Runs the tasks still queued, then joins the threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished.
+    void wait();
+
+    unsigned threads() const { return threads_.size(); }
+
+private:
+    void run();
+
+    size_t capacity_;
+    std::deque<std::function<void()>> queue_;
+    size_t running_ = 0;
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<std::thread> threads_;
+};
+
+#endif /* PARALLEL_H */
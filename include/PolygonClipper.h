@@ -0,0 +1,154 @@
+/**
+ * \file PolygonClipper.h
+ * \author Thomas Barrett
+ * \brief Integer polygon booleans and offsetting for layer contours
+ *
+ * Polygons are clipped in integer coordinates, model units times a fixed
+ * scale, so every predicate is exact. A boolean operation proceeds in four
+ * passes over the edges of both operands:
+ *
+ *  1. A sweep over the edges in order of their left ends finds every pair
+ *     of edges that cross, and each crossing is rounded to the nearest
+ *     integer point.
+ *  2. The crossings and the vertices are the hot pixels of snap rounding:
+ *     every edge is rerouted through the center of every unit pixel it
+ *     passes through. After snapping, edges meet only at their ends, which
+ *     leaves a planar graph with integer vertices.
+ *  3. A second sweep orders the edges bottom to top at every x and carries
+ *     the winding numbers of both operands across them, so each edge knows
+ *     which side of it is inside the result under the fill rule.
+ *  4. The edges with the result on one side only are linked into closed
+ *     polygons that keep the result on their left: outer boundaries run
+ *     counter-clockwise and holes clockwise, as Slicer::computeContours
+ *     produces them.
+ *
+ * Offsetting moves every edge along its normal, joins the ends at convex
+ * corners with a miter, an arc or a square cap, and takes the union of the
+ * result under the positive fill rule, which removes the loops that form
+ * at concave corners and where the offset overruns narrow features.
+ */
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <Slicer.h>
+
+#ifndef POLYGON_CLIPPER_H
+#define POLYGON_CLIPPER_H
+
+using IntPoint = std::array<int64_t, 2>;
+// A closed polygon; the edge from the last point back to the first is
+// implicit.
+using IntPolygon = std::vector<IntPoint>;
+using IntPolygons = std::vector<IntPolygon>;
+
+enum class ClipType { Union, Intersection, Difference, Xor };
+
+// Which winding numbers count as inside.
+enum class FillRule { EvenOdd, NonZero, Positive, Negative };
+
+enum class JoinType { Miter, Round, Square };
+
+struct OffsetSettings {
+    JoinType join = JoinType::Miter;
+    // The longest miter, as a multiple of the offset, before the corner is
+    // squared off instead.
+    double miterLimit = 2;
+    // The furthest a round join may depart from a true arc, in model units.
+    double arcTolerance = 1e-3;
+    // Integer units per model unit.
+    double scale = 1e5;
+};
+
+// Coordinates must stay within +-2^30 so that products of differences fit
+// in 64 bits.
+constexpr int64_t maxClipCoordinate = int64_t(1) << 30;
+
+// Rounds polygons to integer units, dropping the repeated closing point
+// and consecutive duplicates. Open contours are closed. Throws
+// std::runtime_error if a point is out of range.
+IntPolygons toIntPolygons(const Slicer::Polygons &polygons, double scale);
+
+// Converts back to model units, repeating the first point at the end.
+Slicer::Polygons toPolygons(const IntPolygons &polygons, double scale);
+
+// The signed area of a polygon, positive when it runs counter-clockwise.
+double area(const IntPolygon &polygon);
+
+/**
+ * Performs boolean operations and offsets, keeping its buffers from one call
+ * to the next so that a clipper reused across layers stops allocating once
+ * it has seen the largest of them. A clipper must only be used by one thread
+ * at a time.
+ */
+class PolygonClipper {
+public:
+    // Replaces result with subject op clip, with the regions of both
+    // operands defined by rule.
+    void execute(ClipType op, const IntPolygons &subject, const IntPolygons &clip, FillRule rule,
+                 IntPolygons &result);
+
+    // Replaces result with polygons grown by delta integer units, or shrunk
+    // if delta is negative. The input is first normalized by a union under
+    // the even-odd rule, so its orientation does not matter.
+    void offset(const IntPolygons &polygons, double delta, const OffsetSettings &settings, IntPolygons &result);
+
+private:
+    struct Segment {
+        IntPoint a, b;
+        // 0 for an edge of the subject, 1 for the clip.
+        uint8_t operand;
+    };
+    struct Edge {
+        IntPoint lo, hi;
+        // The change in the winding numbers of each operand from below the
+        // edge to above it, or from right to left of a vertical edge.
+        int delta[2];
+        // The winding numbers below the edge, or left of a vertical one.
+        int below[2];
+    };
+
+    void addSegments(const IntPolygons &polygons, uint8_t operand);
+    void findCrossings();
+    void buildGrid();
+    template <typename F> void visitHotPixels(const IntPoint &a, const IntPoint &b, F &&visit) const;
+    void snapSegments();
+    void computeWindings();
+    void linkPolygons(ClipType op, FillRule rule, IntPolygons &result);
+    void offsetPolygon(const IntPolygon &polygon, double delta, const OffsetSettings &settings,
+                       IntPolygon &result) const;
+
+    std::vector<Segment> segments_;
+    std::vector<IntPoint> hot_;
+    // The hot pixels bucketed into a grid of cellSize_ squares.
+    IntPoint gridOrigin_{};
+    int64_t cellSize_ = 1;
+    int64_t gridWidth_ = 0, gridHeight_ = 0;
+    std::vector<uint32_t> cellOffsets_;
+    std::vector<IntPoint> cells_;
+    std::vector<Edge> edges_;
+    std::vector<uint32_t> status_;
+    IntPolygons normalized_;
+    IntPolygons raw_;
+};
+
+// Applies op to polygons in model units, rounded to 1 / scale.
+Slicer::Polygons clipPolygons(ClipType op, const Slicer::Polygons &subject, const Slicer::Polygons &clip,
+                              FillRule rule = FillRule::EvenOdd, double scale = 1e5);
+
+// Grows polygons by delta model units, or shrinks them if delta is
+// negative.
+Slicer::Polygons offsetPolygons(const Slicer::Polygons &polygons, double delta, const OffsetSettings &settings = {});
+
+// The centerlines of count perimeter shells of the region bounded by
+// contours, for extrusions `width` wide: shell i is the boundary offset
+// inward by (i + 0.5) * width. Stops early once the region is used up.
+std::vector<Slicer::Polygons> perimeters(const Slicer::Polygons &contours, int count, double width,
+                                         const OffsetSettings &settings = {});
+
+// Offsets every layer by delta on `threads` workers, each with a clipper of
+// its own; 0 selects one per hardware thread.
+std::vector<Slicer::Polygons> offsetLayers(const std::vector<Slicer::Polygons> &layers, double delta,
+                                           const OffsetSettings &settings = {}, unsigned threads = 1);
+
+#endif /* POLYGON_CLIPPER_H */
@@ -1,32 +1,51 @@
+/**
+ * \file Progress.h
+ * \author Thomas Barrett
+ * \brief Progress reporting and informational messages
+ *
+ * Long stages report their progress through a ProgressBar, which draws a
+ * bar on stdout unless a callback has been installed to receive progress
+ * instead, or quiet mode is on. Informational messages go through info(),
+ * which quiet mode silences too; warnings and errors always print.
+ */
+
+#include <iostream>
+#include <functional>
+#include <string>
+
 #ifndef PROGRESS_H
 #define PROGRESS_H
 
-#include <iostream>
+// Receives the progress of a stage, from 0 to 1.
+using ProgressCallback = std::function<void(const std::string &stage, float progress)>;
+
+// Sends progress to callback instead of drawing a bar. An empty callback
+// restores the bar. The callback may be called from any thread, but only
+// from one at a time.
+void setProgressCallback(ProgressCallback callback);
+
+// Turns off the progress bar and informational messages. A progress
+// callback is still called.
+void setQuiet(bool quiet);
+bool quiet();
+
+// The stream for an informational message, with "info: " written to it
+// already. In quiet mode the stream discards everything.
+std::ostream& info();
 
 class ProgressBar {
 public:
-    void update(float progress) {
-        int barWidth = 70;
-        std::cout << "[";
-        int pos = barWidth * progress;
-        for (int i = 0; i < barWidth; ++i) {
-            if (i < pos) std::cout << "=";
-            else if (i == pos) std::cout << ">";
-            else std::cout << " ";
-        }
-        std::cout << "] " << int(progress * 100.0) << " %\r";
-        std::cout.flush();
-    }
-
-    void finish() {
-        int barWidth = 70;
-        std::cout << "[";
-        for (int i = 0; i < barWidth; ++i) {
-            std::cout << "=";
-        }
-        std::cout << "] " << "100%\n";
-        std::cout.flush();
-    }
+    explicit ProgressBar(std::string stage = ""): stage_{std::move(stage)} {}
+
+    // Reports progress. Nothing is drawn or called unless the progress has
+    // moved on by a whole percent since the last report.
+    void update(float progress);
+
+    void finish();
+
+private:
+    std::string stage_;
+    int percent_ = -1;
 };
 
-#endif
\ No newline at end of file
+#endif /* PROGRESS_H */
@@ -0,0 +1,107 @@
+/**
+ * \file Rasterizer.h
+ * \author Thomas Barrett
+ * \brief Scanline rasterization of layer contours into projection masks
+ *
+ * Contours are filled with the even-odd rule by a scanline converter with
+ * an edge table and an active edge list, so the cost of a layer is linear
+ * in its edges and the pixels it fills. Without anti-aliasing, a pixel is
+ * set when its center lies inside the contours, after snapping vertices to
+ * 1/256 of a pixel, with the top and left edges of a shape inclusive; this
+ * is the sampling rule of cairo's non-antialiased fill. With supersampling,
+ * each pixel stores the fraction of an n by n grid of sample points inside.
+ */
+
+#include <string>
+#include <vector>
+#include <array>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+// Closed contours in model units, the same type as Slicer::Polygons.
+using RasterPolygons = std::vector<std::vector<std::array<double, 2>>>;
+
+struct RasterSettings {
+    int width = 1920;
+    int height = 1080;
+    // The size of a pixel in model units.
+    double pitch = 0.05;
+    // The model point at the center of the image.
+    double centerX = 0;
+    double centerY = 0;
+    // 1 for a bitmask, 8 for grayscale.
+    int bits = 1;
+    // Anti-aliasing samples per pixel along each axis; 1 disables it.
+    int supersample = 1;
+};
+
+/**
+ * A rasterized layer. Rows are stride bytes apart, top row first. With one
+ * bit per pixel the leftmost pixel is the most significant bit of a byte,
+ * as in PNG.
+ */
+struct Mask {
+    int width = 0;
+    int height = 0;
+    int bits = 8;
+    size_t stride = 0;
+    std::vector<uint8_t> data;
+
+    // The value of pixel (x, y): 0 or 1 in a bitmask, 0 to 255 in grayscale.
+    int at(int x, int y) const;
+
+    // Sets pixels [begin, end) of row y to value.
+    void fill(int y, int begin, int end, int value);
+};
+
+// Fills polygons into mask, reusing its buffer when the size is unchanged.
+void rasterize(const RasterPolygons &polygons, const RasterSettings &settings, Mask &mask);
+
+// Encodes mask as a grayscale PNG at path. Throws std::runtime_error if the
+// file cannot be written.
+void writePNG(const Mask &mask, const std::string &path);
+
+/**
+ * Encodes and writes masks on a background thread, so that PNG compression
+ * and disk writes overlap with slicing. At most `capacity` masks wait in
+ * the queue; write blocks while it is full, which bounds the memory held
+ * when the disk falls behind. The first error is rethrown by the next call
+ * to write or finish, and masks queued after it are dropped.
+ */
+class MaskWriter {
+public:
+    explicit MaskWriter(size_t capacity = 8);
+    ~MaskWriter();
+
+    MaskWriter(const MaskWriter &) = delete;
+    MaskWriter& operator=(const MaskWriter &) = delete;
+
+    // Queues mask to be written to path. Safe to call from several threads.
+    void write(Mask mask, std::string path);
+
+    // Waits until every queued mask has been written.
+    void finish();
+
+private:
+    void run();
+    void rethrow();
+
+    size_t capacity_;
+    std::deque<std::pair<Mask, std::string>> queue_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool busy_ = false;
+    bool stopping_ = false;
+    bool failed_ = false;
+    std::exception_ptr error_;
+    std::thread thread_;
+};
+
+#endif /* RASTERIZER_H */
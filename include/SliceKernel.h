@@ -0,0 +1,85 @@
+/**
+ * \file SliceKernel.h
+ * \author Thomas Barrett
+ * \brief Vectorized triangle/plane intersection
+ *
+ * The kernel classifies a run of triangles against one or several horizontal
+ * planes at once and emits the segment each crossed triangle leaves on each
+ * plane. It reads vertex coordinates from separate x, y and z arrays, so a
+ * vector of triangles is loaded with one gather per corner and coordinate,
+ * and it is compiled for AVX2 and AVX-512 as well as plain scalar code. The
+ * widest variant the processor supports is selected at runtime.
+ *
+ * Crossings follow the same rules as Slicer::Section: a vertex exactly at
+ * the plane counts as above it, each segment runs from the edge where the
+ * triangle's boundary passes down through the plane to the edge where it
+ * passes back up, and a crossing at a vertex is that vertex exactly. In
+ * double precision every variant produces the same bits as Slicer.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <Mesh.h>
+
+#ifndef SLICE_KERNEL_H
+#define SLICE_KERNEL_H
+
+enum class SimdLevel { Scalar, AVX2, AVX512 };
+
+// The widest instruction set the processor supports.
+SimdLevel supportedSimd();
+
+// A short name for level, such as "avx2".
+const char* simdName(SimdLevel level);
+
+/**
+ * The vertex coordinates of a mesh as separate arrays, and the corners of
+ * each face as three arrays of vertex indices, in half-edge order.
+ */
+template <typename T>
+struct SoaMesh {
+    std::vector<T> x, y, z;
+    std::vector<uint32_t> corners[3];
+
+    explicit SoaMesh(const Geometry &g);
+
+    size_t faceCount() const { return corners[0].size(); }
+};
+
+// Where face crosses plane: from (x0, y0) on the way down to (x1, y1) on the
+// way back up. The crossed edges are given by their position in the face,
+// in half-edge order.
+template <typename T>
+struct Segment {
+    uint32_t face;
+    uint32_t plane;
+    T x0, y0, x1, y1;
+    uint8_t entry, exit;
+};
+
+// Appends a segment to out for every face in [begin, end) and every plane
+// zs[0], ..., zs[planes - 1] the face crosses. Segments come out in an
+// order that depends on the vector width. A level the processor does not
+// support falls back to the widest one it does.
+template <typename T>
+void intersectTriangles(const SoaMesh<T> &mesh, size_t begin, size_t end,
+                        const T *zs, size_t planes, std::vector<Segment<T>> &out,
+                        SimdLevel level = supportedSimd());
+
+// Appends a segment to out for every face in [begin, end) and every plane
+// in zs, which must be sorted ascending, that the face crosses. Each face
+// is intersected only with the planes within its z-range, computed by
+// binary search, and the kernel is vectorized across those planes, so the
+// cost is O((end - begin) log planes + segments). Segments come out in
+// ascending face order, and in ascending plane order within a face.
+template <typename T>
+void intersectSpans(const SoaMesh<T> &mesh, size_t begin, size_t end,
+                    const T *zs, size_t planes, std::vector<Segment<T>> &out,
+                    SimdLevel level = supportedSimd());
+
+// The planes of the sorted array zs that face crosses are [first, last).
+template <typename T>
+void spannedPlanes(const SoaMesh<T> &mesh, size_t face, const T *zs, size_t planes, size_t &first, size_t &last);
+
+#endif /* SLICE_KERNEL_H */
@@ -0,0 +1,185 @@
+/**
+ * \file SliceServer.h
+ * \author Thomas Barrett
+ * \brief A long-running slicing server on a Unix domain socket
+ *
+ * The server keeps the meshes it has loaded in a GeometryCache, keyed by
+ * the fingerprint of their source file, together with the SliceSessions
+ * built on them, so that slicing a part again skips reading, connecting
+ * and indexing it. Jobs run on a fixed pool of workers, one job per
+ * worker; when every worker is busy and the queue is full, the server
+ * stops accepting connections until a job finishes, and further clients
+ * wait in the listen backlog.
+ *
+ * Requests and replies are single lines of fields separated by tabs:
+ *
+ *   slice <working directory> <argument>...  slices a job given by the
+ *                                            job options of build/slicer
+ *   status                                   reports the cache and jobs
+ *   stop                                     stops the server
+ *
+ * The reply starts with "ok" followed by key=value fields, or is an error
+ * message. Relative paths in a job are taken relative to the working
+ * directory sent with it.
+ */
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <MeshCache.h>
+#include <SliceSession.h>
+#include <Parallel.h>
+
+#ifndef SLICE_SERVER_H
+#define SLICE_SERVER_H
+
+// A slicing job as given to build/slicer: the model and what to make of it.
+struct SliceJob {
+    std::string path;
+    SliceSettings settings;
+    std::string stackPath;
+    std::string outputPath;
+
+    // If args[i] is a job option, consumes it and its value, leaving i on
+    // the last argument consumed, and returns true. Throws
+    // std::invalid_argument or std::out_of_range for a value that is not
+    // wholly a number, or is out of range for its option.
+    bool parse(const std::vector<std::string> &args, size_t &i);
+
+    // Whether the job names a model and somewhere to write it, a layer
+    // stack or a PNG directory, and its settings make sense.
+    bool valid() const;
+
+    // The sink the job writes to: its layer stack, or PNGs in outputPath.
+    std::unique_ptr<LayerSink> sink() const;
+};
+
+/**
+ * Loaded meshes in least recently used order, within a budget of bytes
+ * counting the geometry and the sessions built on it. Once the budget is
+ * exceeded the least recently used meshes are dropped, though never the
+ * one just requested; jobs still slicing a dropped mesh keep it until they
+ * finish.
+ */
+class GeometryCache {
+public:
+    class Entry {
+    public:
+        explicit Entry(Geometry geometry);
+
+        const Geometry& geometry() const { return geometry_; }
+
+        // Bytes held by the geometry and every session built on it.
+        size_t bytes() const { return bytes_; }
+
+        // Takes the idle session on the geometry, or builds one. Sessions
+        // are returned with release; one is kept for the next job and any
+        // others are freed.
+        std::unique_ptr<SliceSession> acquire();
+        void release(std::unique_ptr<SliceSession> session);
+
+    private:
+        Geometry geometry_;
+        std::atomic<size_t> bytes_;
+        std::mutex mutex_;
+        std::unique_ptr<SliceSession> idle_;
+    };
+
+    struct Stats {
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    // Meshes are loaded through loadGeometry with `threads` workers, 0 for
+    // one per hardware thread, and through cache files unless
+    // useCacheFiles is false.
+    explicit GeometryCache(size_t budget, unsigned threads = 1, bool useCacheFiles = true);
+
+    // The mesh in the file at path, loaded unless a file with the same
+    // fingerprint is cached; hit, if given, tells which. Concurrent
+    // requests for a file being loaded wait for that load. Throws
+    // std::runtime_error if the file cannot be read.
+    std::shared_ptr<Entry> get(const std::string &path, bool *hit = nullptr);
+
+    Stats stats() const;
+
+private:
+    using Key = std::tuple<uint64_t, int64_t, uint64_t>;
+
+    struct Slot {
+        std::shared_future<std::shared_ptr<Entry>> entry;
+        std::list<Key>::iterator recent;
+    };
+
+    // Drops the least recently used loaded meshes, other than keep, until
+    // the cache is within its budget. The mutex must be held.
+    void evict(const Key &keep);
+
+    size_t budget_;
+    unsigned threads_;
+    bool useCacheFiles_;
+    mutable std::mutex mutex_;
+    std::map<Key, Slot> slots_;
+    std::list<Key> recent_;
+    Stats stats_;
+};
+
+struct ServerSettings {
+    std::string socketPath;
+    // The number of jobs sliced at once; 0 selects one per hardware thread.
+    unsigned workers = 0;
+    // The number of jobs that may wait for a worker.
+    size_t queue = 64;
+    size_t cacheBytes = size_t(1) << 30;
+    bool useCacheFiles = true;
+};
+
+class SliceServer {
+public:
+    // Listens on settings.socketPath, replacing any socket left there.
+    // Throws std::runtime_error if the socket cannot be created.
+    explicit SliceServer(const ServerSettings &settings);
+
+    // Finishes the jobs accepted so far and removes the socket.
+    ~SliceServer();
+
+    SliceServer(const SliceServer &) = delete;
+    SliceServer& operator=(const SliceServer &) = delete;
+
+    // Serves requests until stop is called or a client asks to stop.
+    void run();
+
+    // Makes run return. Safe to call from any thread.
+    void stop();
+
+    const GeometryCache& cache() const { return cache_; }
+
+private:
+    void serve(int connection);
+    std::string slice(const std::vector<std::string> &fields);
+    std::string status() const;
+
+    ServerSettings settings_;
+    GeometryCache cache_;
+    ThreadPool pool_;
+    int listener_ = -1;
+    int wake_[2] = {-1, -1};
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> jobs_{0};
+    std::atomic<size_t> failures_{0};
+};
+
+// Sends a request to the server listening at socketPath and returns its
+// reply. Throws std::runtime_error if the server cannot be reached.
+std::string serverRequest(const std::string &socketPath, const std::vector<std::string> &fields);
+
+#endif /* SLICE_SERVER_H */
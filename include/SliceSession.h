@@ -0,0 +1,176 @@
+/**
+ * \file SliceSession.h
+ * \author Thomas Barrett
+ * \brief Repeated slicing jobs on one mesh, with output to any sink
+ *
+ * A SliceSession holds everything about a Geometry that slicing it needs
+ * besides the heights: the interval tree over the z-ranges of its faces,
+ * a Section per worker, the incremental sweep with its sorted vertices,
+ * and the most recent layer schedule. These are built once, so a second
+ * job on the same mesh goes straight to intersecting faces.
+ *
+ * A job is described by a SliceSettings and delivers its layers to a
+ * LayerSink in ascending z. Sinks are provided that keep the layers in
+ * memory, hand them to a callback, write PNG masks into a directory or
+ * write a layer stack; others are written by deriving from LayerSink.
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <functional>
+#include <Slicer.h>
+#include <Rasterizer.h>
+#include <LayerStack.h>
+
+#ifndef SLICE_SESSION_H
+#define SLICE_SESSION_H
+
+struct SliceSettings {
+    LayerSettings layers;
+    // Only the layers of the schedule with minZ <= z <= maxZ are sliced.
+    // The schedule always starts at the bottom of the mesh, so a job
+    // restricted to a band slices the same heights as a whole job.
+    double minZ = -std::numeric_limits<double>::infinity();
+    double maxZ = std::numeric_limits<double>::infinity();
+    RasterSettings raster;
+    // Whether each layer is rasterized into a mask with raster.
+    bool masks = true;
+    // The number of workers; 0 selects one per hardware thread.
+    unsigned threads = 1;
+};
+
+// One sliced layer as a sink sees it, valid only for the call it is
+// passed to. index counts the layers of the job from 0.
+struct SliceLayer {
+    int index;
+    double z;
+    const Slicer::Polygons &polygons;
+    // The rasterized layer, or null without masks. A sink may move from it.
+    Mask *mask;
+};
+
+class LayerSink {
+public:
+    virtual ~LayerSink() = default;
+
+    // Called before the first layer of a job with the number of layers.
+    virtual void begin(const SliceSettings &/*settings*/, size_t /*layers*/) {}
+
+    // Called on the worker that sliced each layer, concurrently and in no
+    // particular order, before the layer is delivered. Work that does not
+    // depend on order, such as encoding, belongs here.
+    virtual void process(const SliceLayer &/*layer*/) {}
+
+    // Delivers each layer, one call at a time, in ascending z.
+    virtual void layer(const SliceLayer &layer) = 0;
+
+    // Called after the last layer of a job.
+    virtual void finish() {}
+};
+
+// Keeps every layer of the most recent job.
+class MemorySink: public LayerSink {
+public:
+    struct Layer {
+        double z;
+        Slicer::Polygons polygons;
+        Mask mask;
+    };
+
+    const std::vector<Layer>& layers() const { return layers_; }
+
+    void begin(const SliceSettings &settings, size_t layers) override;
+    void layer(const SliceLayer &layer) override;
+
+private:
+    std::vector<Layer> layers_;
+};
+
+// Hands each layer to a function.
+class CallbackSink: public LayerSink {
+public:
+    explicit CallbackSink(std::function<void(const SliceLayer &layer)> callback): callback_{std::move(callback)} {}
+
+    void layer(const SliceLayer &layer) override { callback_(layer); }
+
+private:
+    std::function<void(const SliceLayer &layer)> callback_;
+};
+
+// Writes the mask of each layer to slice<index>.png in a directory, which
+// must exist, on a background writer. Throws std::runtime_error if the
+// job has no masks or a file cannot be written.
+class PngSink: public LayerSink {
+public:
+    explicit PngSink(std::string directory): directory_{std::move(directory)} {}
+
+    void begin(const SliceSettings &settings, size_t layers) override;
+    void layer(const SliceLayer &layer) override;
+    void finish() override;
+
+private:
+    std::string directory_;
+    MaskWriter writer_;
+};
+
+// Writes the layers to a layer stack at path, with their masks if the job
+// has them. Layers are encoded on the worker that sliced them.
+class LayerStackSink: public LayerSink {
+public:
+    explicit LayerStackSink(std::string path): path_{std::move(path)} {}
+
+    void begin(const SliceSettings &settings, size_t layers) override;
+    void process(const SliceLayer &layer) override;
+    void layer(const SliceLayer &layer) override;
+    void finish() override;
+
+private:
+    std::string path_;
+    std::unique_ptr<LayerStackWriter> writer_;
+    std::vector<LayerRecord> records_;
+};
+
+class SliceSession {
+public:
+    // Builds the acceleration structures for geometry, which must outlive
+    // the session.
+    explicit SliceSession(const Geometry &geometry);
+    ~SliceSession();
+
+    SliceSession(const SliceSession &) = delete;
+    SliceSession& operator=(const SliceSession &) = delete;
+
+    const Geometry& geometry() const { return geometry_; }
+    double minZ() const { return minz_; }
+    double maxZ() const { return maxz_; }
+
+    // The heights settings would slice at, within its bounds. The schedule
+    // for the whole mesh is kept until a job asks for other LayerSettings.
+    std::vector<double> layers(const SliceSettings &settings);
+
+    // Slices a job, delivering its layers to sink, and returns the
+    // problems found. Errors thrown by the sink propagate. A session runs
+    // one job at a time.
+    Slicer::Diagnostics slice(const SliceSettings &settings, LayerSink &sink);
+
+    // Slices a single height. The contours live in the session until its
+    // next job or layer.
+    const Slicer::Polygons& sliceAt(double z);
+
+private:
+    const std::vector<double>& schedule(const LayerSettings &settings, unsigned threads);
+
+    const Geometry &geometry_;
+    double minz_ = 0;
+    double maxz_ = 0;
+    IntervalTree tree_;
+    std::vector<std::unique_ptr<Slicer::Section>> sections_;
+    std::unique_ptr<IncrementalSlicer> sweep_;
+    bool scheduled_ = false;
+    LayerSettings scheduleSettings_;
+    std::vector<double> schedule_;
+};
+
+#endif /* SLICE_SESSION_H */
@@ -1,26 +1,270 @@
-
 #ifndef SLICER_H
 #define SLICER_H
 
-#include <set>
-#include <variant>
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <Mesh.h>
+#include <IntervalTree.h>
+#include <Rasterizer.h>
 
-class Slicer {
+/**
+ * Sweeps a horizontal plane upward through a mesh while maintaining the set
+ * of faces whose z-range spans the plane. Faces are sorted by their minimum z
+ * once, and each face enters and leaves the active set exactly once, so a
+ * complete sweep costs O(F log F) plus the number of faces actually spanned.
+ */
+class FaceSweep {
 public:
-    static void sliceGeometry(const Geometry &g /*, SliceJobSettings */);
+    FaceSweep(const Geometry &geometry);
+
+    // Advances the plane to height z and returns every face with
+    // zmin <= z <= zmax. Successive calls must not decrease z.
+    const std::vector<const Face*>& advance(double z);
 
 private:
-    using Intersection = std::variant<const Edge*, const Vertex*>;
-    using Edges = std::multimap<Intersection, Intersection>;
+    std::vector<double> zmin_;
+    std::vector<double> zmax_;
+    std::vector<const Face*> order_;
+    std::vector<const Face*> active_;
+    size_t next_ = 0;
+};
+
+class IncrementalSlicer;
+struct SliceSettings;
+class LayerSink;
+
+/**
+ * How far apart to slice. Uniform layers are `height` apart. Adaptive
+ * layers are as thick as the surface allows: a layer of height h leaves
+ * steps on a surface whose normal makes an angle t with the z axis that
+ * stand h |cos t| proud of it, so each layer is made as thick as it can
+ * be, between minHeight and height, without a face it spans exceeding
+ * tolerance. Near-vertical walls get thick layers and shallow slopes
+ * thin ones.
+ */
+struct LayerSettings {
+    double height = 0.1;
+    bool adaptive = false;
+    double minHeight = 0.025;
+    double tolerance = 0.01;
+};
+
+class Slicer {
+public:
     using Point = std::array<double, 2>;
-    using Points = std::map<Intersection, Point>;
     using Polygon = std::vector<Point>;
     using Polygons = std::vector<Polygon>;
+    using LayerCallback = std::function<void(int layer, double z, const Polygons &polygons)>;
+
+    /**
+     * A problem found while chaining the contours of a layer. An open
+     * contour runs into the boundary of a mesh that is not closed and is
+     * reported as an unclosed polyline. A collapsed contour has fewer than
+     * three distinct points, as when the plane just touches a peak, and is
+     * dropped.
+     */
+    struct Diagnostic {
+        enum Kind { OpenContour, CollapsedContour };
+
+        Kind kind;
+        int layer;      // the layer index, or -1 outside sliceLayers
+        int face;       // the lowest-indexed face the contour crosses
+        size_t points;  // the number of distinct points in the contour
+    };
+    using Diagnostics = std::vector<Diagnostic>;
+
+    /**
+     * Scratch buffers for slicing one layer at a time. A vertex at exactly
+     * the height of the plane counts as above it, so the plane never passes
+     * through a vertex: it crosses some edges, and every face it crosses has
+     * exactly two crossed edges. Contours are then chained by walking from a
+     * face out through its exit edge into the face on the other side of
+     * that edge, which is O(1) per segment and needs no lookup structure.
+     *
+     * Faces are marked with the stamp of the current layer rather than
+     * cleared, so starting a layer costs O(1) and nothing is freed between
+     * layers. Once the first layers have grown the buffers, slicing a layer
+     * into a Section performs no heap allocation. A Section belongs to the
+     * Geometry it was built for and must only be used by one thread at a time.
+     */
+    class Section {
+    public:
+        explicit Section(const Geometry &g);
+
+        // The number of segments, one per crossed face, in the current layer.
+        size_t segments() const { return crossed_.size(); }
+
+        // The contours found by the most recent call to computeContours.
+        const Polygons& polygons() const { return polygons_; }
+
+        // Problems found by the most recent call to computeContours.
+        const Diagnostics& diagnostics() const { return diagnostics_; }
+
+    private:
+        friend class Slicer;
+        friend class IncrementalSlicer;
+
+        void begin(double z);
+        bool above(const Vertex *v) const { return geometry_->positions()[v->index][2] >= z_; }
+        bool classify(const Face &face);
+        Point crossing(const Edge &edge) const;
+        Point exitPoint(int face) const;
+        Polygon& addPolygon();
+        bool walk(const Face *face, bool forward, Polygon &polygon);
+
+        const Geometry *geometry_;
+        double z_ = 0;
+        uint32_t stamp_ = 0;
+        std::vector<uint32_t> visited_;
+        std::vector<const HalfEdge*> entries_;
+        std::vector<const HalfEdge*> exits_;
+        // Exit points supplied by sliceBatch, used while cached_ is set.
+        bool cached_ = false;
+        std::vector<Point> exitPoints_;
+        std::vector<int> crossed_;
+        std::vector<const Face*> faces_;
+        Polygons polygons_;
+        Polygons spare_;
+        Diagnostics diagnostics_;
+    };
+
+    // Slices the STL file at path without building a Geometry, keeping at
+    // most memoryCap bytes of triangles and contours resident, and delivers
+    // the layers to sink. Layers are uniform, whatever settings.layers asks
+    // for, and are sliced on a single thread. See StreamSlicer and
+    // SliceSession.
+    static Diagnostics sliceStream(const std::string &path, size_t memoryCap, const SliceSettings &settings,
+                                   LayerSink &sink);
+
+    // Returns evenly spaced slicing heights covering the z-extent of g, or
+    // the range [minz, maxz].
+    static std::vector<double> uniformLayers(const Geometry &g, double height);
+    static std::vector<double> uniformLayers(double minz, double maxz, double height);
+
+    // Returns slicing heights covering the z-extent of g, adapted to its
+    // surface if settings ask for it. The largest layer height allowed at
+    // each z is gathered into a histogram of bins minHeight / 2 tall, each
+    // bin holding the limit of the steepest-stepping face that spans it.
+    // Faces are binned on `threads` workers; 0 selects one per hardware
+    // thread.
+    static std::vector<double> layerSchedule(const Geometry &g, const LayerSettings &settings, unsigned threads = 1);
 
-    static std::pair<Points, Edges> sliceTriangles(const Geometry &g, double z);
-    static Polygons computeContours(const Geometry &g, const Points &points, Edges edges);
+    // Slices g at every height in zs, which must be sorted ascending, and
+    // invokes emit once per layer in order. Problems found in any layer are
+    // appended to diagnostics, if given, in layer order.
+    static void sliceLayers(const Geometry &g, const std::vector<double> &zs, const LayerCallback &emit,
+                            Diagnostics *diagnostics = nullptr);
+
+    // Slices the layers in zs on `threads` workers that steal ranges of
+    // layers from one another. `process` is called on the worker that sliced
+    // each layer, concurrently and in no particular order. `emit` is called
+    // once per layer, one call at a time, in ascending z, so its output is
+    // identical for every thread count.
+    static void sliceLayers(const Geometry &g, const std::vector<double> &zs, const LayerCallback &emit,
+                            unsigned threads, const LayerCallback &process = nullptr,
+                            Diagnostics *diagnostics = nullptr);
+
+    // As above, querying tree, which must be faceTree(g), and slicing into
+    // the Section of each worker in sections, which are created as needed
+    // and kept for the next call.
+    static void sliceLayers(const Geometry &g, const IntervalTree &tree, std::vector<std::unique_ptr<Section>> &sections,
+                            const std::vector<double> &zs, const LayerCallback &emit, unsigned threads,
+                            const LayerCallback &process = nullptr, Diagnostics *diagnostics = nullptr);
+
+    /**
+     * Slices g at every height in zs, which must be sorted ascending, face by
+     * face rather than layer by layer. The range of layers each face spans
+     * is found by binary search, and its segment on each of those layers is
+     * computed by the vectorized kernel and scattered into a bucket for that
+     * layer. The buckets are then chained into contours on `threads`
+     * workers, with the exit points taken from the kernel rather than
+     * computed again. The cost is O(F log L + L + segments), and
+     * emit sees the same layers, in the same order, as sliceLayers; so do
+     * diagnostics. All segments are held at once, 24 bytes each.
+     */
+    static void sliceBatch(const Geometry &g, const std::vector<double> &zs, const LayerCallback &emit,
+                           unsigned threads = 1, Diagnostics *diagnostics = nullptr);
+
+    // Builds an interval tree over the z-range of every face, indexed by
+    // face index, for random access to individual layers.
+    static IntervalTree faceTree(const Geometry &g);
+
+    // Slices g at a single height z, visiting only the faces in tree that
+    // span z. The contours live in section until its next layer.
+    static const Polygons& sliceLayer(const Geometry &g, const IntervalTree &tree, double z, Section &section);
+
+    // As above, with a Section of its own. Building the Section costs
+    // O(V + E), so callers slicing many layers should keep one instead.
+    static Polygons sliceLayer(const Geometry &g, const IntervalTree &tree, double z);
+
+    // Starts a new layer in section and records where every face of g, or
+    // every face in faces, meets the plane at height z.
+    static void sliceTriangles(const Geometry &g, double z, Section &section);
+    static void sliceTriangles(const Geometry &g, double z, const std::vector<const Face*> &faces, Section &section);
+
+    // Chains the segments of the current layer of section into contours.
+    // Closed contours repeat their first point at the end and wind
+    // counter-clockwise around solid material seen from above, so holes run
+    // clockwise, provided the faces of g are consistently oriented outward.
+    static const Polygons& computeContours(Section &section);
+
+    // Prints a warning for each kind of problem in diagnostics.
+    static void reportDiagnostics(const Diagnostics &diagnostics);
+
+private:
     static void exportPolygons(const Polygons &polygons, const std::string &path);
-    static void exportPolygonsToPNG(const Polygons &polygons, const std::string &path);
 };
 
-#endif /* SLICER_H */
\ No newline at end of file
+/**
+ * Slices a mesh at a rising sequence of heights, carrying the crossed faces
+ * and their entry and exit edges from one layer to the next. Between two
+ * heights a face can only change how it meets the plane if one of its
+ * vertices lies in between, so only the faces around those vertices are
+ * re-examined; every other crossed face keeps its edges and only has its
+ * crossing points re-interpolated. Vertices are visited once each over a
+ * whole sweep, which makes many fine layers far cheaper than slicing each
+ * independently. The contours are identical to those of Slicer::sliceLayer.
+ */
+class IncrementalSlicer {
+public:
+    explicit IncrementalSlicer(const Geometry &g);
+
+    // Moves the plane up to height z, which must not be below the previous
+    // height, and returns the contours there.
+    const Slicer::Polygons& advance(double z);
+
+    // Moves the plane back below the mesh, so that the next call to advance
+    // may start over at any height. The sorted vertices and the buffers are
+    // kept.
+    void rewind();
+
+    // Problems found in the most recent layer.
+    const Slicer::Diagnostics& diagnostics() const { return section_.diagnostics(); }
+
+    // The number of segments in the most recent layer.
+    size_t segments() const { return section_.segments(); }
+
+    // The number of faces re-examined by the most recent call to advance.
+    size_t updatedFaces() const { return touched_.size(); }
+
+private:
+    // Brings the crossed faces and their edges up to height z.
+    void update(double z);
+
+    const Geometry &geometry_;
+    Slicer::Section section_;
+    std::vector<int> order_;
+    size_t next_ = 0;
+    uint32_t stamp_ = 0;
+    std::vector<uint32_t> marks_;
+    std::vector<uint8_t> crossed_;
+    std::vector<int> touched_;
+    std::vector<int> added_;
+    std::vector<int> merged_;
+};
+
+#endif /* SLICER_H */
@@ -0,0 +1,33 @@
+/**
+ * \file StlFile.h
+ * \author Thomas Barrett
+ * \brief Binary and ASCII STL files
+ */
+
+#include <string>
+#include <functional>
+#include <Mesh.h>
+
+#ifndef STL_FILE_H
+#define STL_FILE_H
+
+// Reads a binary or ASCII STL file. STL stores three unshared vertices per
+// triangle, so coincident vertices are welded as they are read: vertices
+// closer than `epsilon` in every coordinate become one, and triangles that
+// collapse as a result are dropped. The file is read in fixed-size blocks,
+// so memory use is bounded by the welded mesh rather than the file size.
+// Throws std::runtime_error if the file cannot be read, is malformed or
+// has no triangles.
+MeshData readSTL(const std::string &path, double epsilon = 1e-6);
+
+using TriangleCallback = std::function<void(const Geometry::Point &a, const Geometry::Point &b, const Geometry::Point &c)>;
+
+// Calls fn with the corners of every triangle of a binary or ASCII STL
+// file, in file order, without welding or keeping any of them. Throws
+// std::runtime_error if the file cannot be read or is malformed.
+void readSTLTriangles(const std::string &path, const TriangleCallback &fn);
+
+// Writes the triangles of g as a binary STL file.
+void writeSTL(const std::string &path, const Geometry &g);
+
+#endif /* STL_FILE_H */
@@ -0,0 +1,124 @@
+/**
+ * \file StreamSlicer.h
+ * \author Thomas Barrett
+ * \brief Out-of-core slicing of STL files larger than memory
+ *
+ * A Geometry holds the whole half-edge mesh in memory before slicing can
+ * start. StreamSlicer instead reads the triangles of an STL file once,
+ * sorts them by their lowest z into runs that fit in a memory budget, and
+ * spills the runs to a temporary file. Slicing then merges the runs in
+ * rising z, so that only the band of triangles spanning the current layer
+ * is resident, and each layer is emitted as soon as it is sliced.
+ *
+ * Without half-edges, segments are chained through the edges they cross,
+ * identified by the exact coordinates of their endpoints. For a closed mesh
+ * whose shared vertices are bit-identical, as in any STL written from an
+ * indexed mesh, the contours and diagnostics are the same as those of
+ * Slicer::sliceLayers on the Geometry read from the same file.
+ */
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdio>
+#include <cstdint>
+#include <Slicer.h>
+
+#ifndef STREAM_SLICER_H
+#define STREAM_SLICER_H
+
+class StreamSlicer {
+public:
+    // Reads and sorts the triangles of the STL file at path, keeping at
+    // most memoryCap bytes resident. Throws std::runtime_error if the file
+    // cannot be read, has no triangles or the cap is too small to make
+    // progress.
+    StreamSlicer(const std::string &path, size_t memoryCap);
+    ~StreamSlicer();
+
+    StreamSlicer(const StreamSlicer &) = delete;
+    StreamSlicer& operator=(const StreamSlicer &) = delete;
+
+    // The number of non-degenerate triangles in the file.
+    size_t triangles() const { return triangles_; }
+
+    // The z-extent of the triangles.
+    double minZ() const { return minz_; }
+    double maxZ() const { return maxz_; }
+
+    // The number of sorted runs spilled to disk.
+    size_t runs() const { return runs_.size(); }
+
+    // Slices at every height in zs, which must be sorted ascending, and
+    // invokes emit once per layer in order. Problems found in any layer are
+    // appended to diagnostics, if given, with the face index of a triangle
+    // being its position in the file. Throws std::runtime_error if the
+    // triangles spanning a layer do not fit in the memory cap.
+    void slice(const std::vector<double> &zs, const Slicer::LayerCallback &emit,
+               Slicer::Diagnostics *diagnostics = nullptr);
+
+    // The largest number of bytes held in buffers at once so far.
+    size_t peakMemory() const { return peak_; }
+
+private:
+    struct Triangle {
+        uint32_t index;
+        double v[9];
+
+        double zmin() const;
+        double zmax() const;
+    };
+
+    // A sorted run in the spill file, and a window of it read ahead.
+    struct Run {
+        long offset;
+        size_t count;
+        size_t next;
+        std::vector<Triangle> buffer;
+        size_t cursor;
+    };
+
+    // The endpoints of an edge, below the plane first, as raw bits.
+    using EdgeKey = std::array<uint64_t, 6>;
+
+    // A crossed triangle of active_, and its entry and exit edges.
+    struct Crossing {
+        uint32_t index;
+        uint32_t triangle;
+        uint8_t entry, exit;
+        Slicer::Point entryPoint, exitPoint;
+    };
+
+    // Orders triangles by their lowest z, then by their position in the file.
+    static bool before(const Triangle &a, const Triangle &b);
+    static size_t hash(const EdgeKey &key);
+
+    void spill(std::vector<Triangle> &buffer);
+    bool refill(Run &run);
+    const Triangle* peek();
+    void pop();
+    void sliceLayer(double z);
+    bool walk(int crossing, bool forward, Slicer::Polygon &polygon);
+    EdgeKey key(const Crossing &c, bool entry) const;
+    int find(const std::vector<int> &table, const EdgeKey &edge, bool entry) const;
+    size_t track(size_t extra = 0);
+
+    size_t memoryCap_;
+    size_t window_ = 1;
+    size_t triangles_ = 0;
+    double minz_;
+    double maxz_;
+    std::FILE *file_ = nullptr;
+    std::vector<Run> runs_;
+    std::vector<int> heap_;
+    std::vector<Triangle> active_;
+    std::vector<Crossing> crossings_;
+    std::vector<int> byEntry_;
+    std::vector<int> byExit_;
+    std::vector<uint8_t> visited_;
+    Slicer::Polygons polygons_;
+    Slicer::Diagnostics diagnostics_;
+    size_t peak_ = 0;
+};
+
+#endif /* STREAM_SLICER_H */
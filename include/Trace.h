@@ -0,0 +1,82 @@
+/**
+ * \file Trace.h
+ * \author Thomas Barrett
+ * \brief Scoped stage timers and counters for the slicing pipeline
+ *
+ * Stages are timed by constructing a trace::Scope named after them, and
+ * quantities are tallied with trace::count. Both do nothing but test a flag
+ * until tracing is enabled. Once it is, each thread appends to a log of its
+ * own, so threads never contend with one another; a log is handed on to
+ * a later thread when its thread exits, which keeps the number of logs at
+ * the most threads alive at once however many parallel loops run.
+ *
+ * The logs can be summarized per stage, or written out whole as JSON or
+ * as Chrome trace events, which chrome://tracing and Perfetto display as a
+ * timeline with one lane per thread. Names must be string literals, or
+ * otherwise outlive the trace.
+ */
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+#ifndef TRACE_H
+#define TRACE_H
+
+namespace trace {
+
+// Starts or stops recording. Events recorded so far are kept.
+void enable(bool enabled);
+bool enabled();
+
+// Discards every event and counter recorded so far.
+void reset();
+
+// Adds delta to the counter called name.
+void count(const char *name, int64_t delta = 1);
+
+// Records the time from construction to destruction as a span of stage
+// name on the current thread.
+class Scope {
+public:
+    explicit Scope(const char *name);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope& operator=(const Scope &) = delete;
+
+private:
+    const char *name_;
+    int64_t start_;
+};
+
+struct StageSummary {
+    std::string name;
+    uint64_t calls = 0;
+    // The sum of every span, which exceeds wall time for stages that run
+    // on several threads at once.
+    double totalMs = 0;
+    double maxMs = 0;
+};
+
+struct Summary {
+    std::vector<StageSummary> stages;
+    std::vector<std::pair<std::string, int64_t>> counters;
+};
+
+// Aggregates the spans of each stage and the counters, ordered by name.
+// Spans still open are left out.
+Summary summarize();
+
+// Writes the summary as a JSON object with "stages" and "counters" members.
+void writeJSON(std::ostream &out);
+
+// Writes every span as a complete ("X") event, in microseconds since the
+// program started, followed by the final value of every counter,
+// in the Chrome trace event format.
+void writeChromeTrace(std::ostream &out);
+
+}
+
+#endif /* TRACE_H */
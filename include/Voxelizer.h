@@ -0,0 +1,95 @@
+/**
+ * \file Voxelizer.h
+ * \author Thomas Barrett
+ * \brief Parallel voxelization of closed meshes into bit-packed grids
+ *
+ * A voxel grid is a stack of z-layers, each a one-bit Mask with x along
+ * its rows, so that a layer holds its voxels in nx * ny / 8 bytes. The
+ * solid interior is found one layer at a time: the mesh is sliced at the
+ * height of the voxel centers and the contours are filled by the scanline
+ * rasterizer, which marks every voxel whose center is inside under the
+ * even-odd rule. The shell is the set of voxels the surface passes
+ * through, found by an exact triangle/box separating axis test against
+ * every voxel in the bounds of each triangle. Both stages run on `threads`
+ * workers that each own whole layers, so no two workers write to the same
+ * byte.
+ */
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <Mesh.h>
+#include <Rasterizer.h>
+
+#ifndef VOXELIZER_H
+#define VOXELIZER_H
+
+struct VoxelSettings {
+    // The edge length of a voxel in model units; 0 derives it from
+    // resolution.
+    double size = 0;
+    // Voxels along the longest axis of the model when size is 0.
+    int resolution = 256;
+    // Marks voxels whose centers are inside the mesh.
+    bool solid = true;
+    // Marks voxels that the surface passes through.
+    bool shell = true;
+    unsigned threads = 1;
+};
+
+// The placement and dimensions of a grid, known before it is allocated.
+struct VoxelLayout {
+    Geometry::Point origin{};
+    double size = 1;
+    int nx = 0;
+    int ny = 0;
+    int nz = 0;
+
+    // The bytes a grid with this layout occupies.
+    size_t bytes() const;
+};
+
+// Returns the layout that covers the bounding box of g at the voxel size
+// or resolution in settings.
+VoxelLayout voxelLayout(const Geometry &g, const VoxelSettings &settings);
+
+class VoxelGrid {
+public:
+    VoxelGrid() = default;
+    explicit VoxelGrid(const VoxelLayout &layout);
+
+    const VoxelLayout& layout() const { return layout_; }
+
+    bool at(int x, int y, int z) const { return layers_[z].at(x, y); }
+    void set(int x, int y, int z);
+
+    // Layer z, with pixel (x, y) holding voxel (x, y, z).
+    Mask& layer(int z) { return layers_[z]; }
+    const Mask& layer(int z) const { return layers_[z]; }
+
+    // The center of voxel (x, y, z) in model units.
+    Geometry::Point center(int x, int y, int z) const;
+
+    // The number of voxels set, and the volume they enclose.
+    size_t count() const;
+    double volume() const;
+
+private:
+    VoxelLayout layout_;
+    std::vector<Mask> layers_;
+};
+
+// Voxelizes g. The mesh should be closed for the solid interior to be
+// meaningful; open contours are closed as the rasterizer closes them.
+VoxelGrid voxelize(const Geometry &g, const VoxelSettings &settings);
+
+// Returns whether the triangle overlaps the closed axis-aligned box with
+// the given center and half extents, testing the 13 separating axes of
+// Akenine-Möller: the box normals, the triangle normal and the nine cross
+// products of their edges. The second form takes a cube.
+bool triangleOverlapsBox(const Geometry::Point &center, const Geometry::Point &halfSize,
+                         const std::array<Geometry::Point, 3> &triangle);
+bool triangleOverlapsBox(const Geometry::Point &center, double halfSize,
+                         const std::array<Geometry::Point, 3> &triangle);
+
+#endif /* VOXELIZER_H */
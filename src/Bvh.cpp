@@ -0,0 +1,482 @@
+#include <Bvh.h>
+#include <Parallel.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+using Point = Geometry::Point;
+
+constexpr int bins = 12;
+constexpr uint32_t leafSize = 4;
+// Ranges at most this large are built as independent subtrees.
+constexpr uint32_t subtreeSize = 4096;
+// Below this depth, splits fall back to the median, which bounds the depth
+// of the tree and so the traversal stacks.
+constexpr int maxDepth = 40;
+constexpr int packetSize = 8;
+
+// Slab test bounds are widened by this factor to cover the rounding of the
+// single precision arithmetic.
+constexpr float slack = 1e-6f;
+
+Point subtract(const Point &a, const Point &b) {
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+Point cross(const Point &a, const Point &b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+double dot(const Point &a, const Point &b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+double area(const Point &lo, const Point &hi) {
+    Point d = subtract(hi, lo);
+    return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+void grow(Point &lo, Point &hi, const Point &p) {
+    for (int axis = 0; axis < 3; axis++) {
+        lo[axis] = std::min(lo[axis], p[axis]);
+        hi[axis] = std::max(hi[axis], p[axis]);
+    }
+}
+
+Point infinite(double sign) {
+    double v = sign * std::numeric_limits<double>::infinity();
+    return {v, v, v};
+}
+
+// The reciprocal of a direction component, with zero replaced by a tiny
+// value of the same sign so that the slab test never computes 0 * inf.
+float reciprocal(double d) {
+    return 1.0f / (d == 0 ? std::copysign(1e-30, d) : d);
+}
+
+// Moller-Trumbore, inclusive of the edges of the triangle.
+bool intersectTriangle(const Ray &ray, const std::array<Point, 3> &t, double tmax, RayHit &hit) {
+    Point e1 = subtract(t[1], t[0]), e2 = subtract(t[2], t[0]);
+    Point p = cross(ray.direction, e2);
+    double det = dot(e1, p);
+    if (det == 0) return false;
+
+    double inv = 1 / det;
+    Point s = subtract(ray.origin, t[0]);
+    double u = dot(s, p) * inv;
+    if (u < 0 || u > 1) return false;
+    Point q = cross(s, e1);
+    double v = dot(ray.direction, q) * inv;
+    if (v < 0 || u + v > 1) return false;
+    double d = dot(e2, q) * inv;
+    if (d < ray.tmin || d > tmax) return false;
+
+    hit.t = d;
+    hit.u = u;
+    hit.v = v;
+    return true;
+}
+
+// Keeps the nearer of two hits, or the lower face at the same distance.
+void keep(RayHit &best, const RayHit &hit) {
+    if (hit.t < best.t || (hit.t == best.t && hit.face < best.face)) best = hit;
+}
+
+// The point of the triangle nearest to p, by the Voronoi regions of its
+// vertices and edges (Ericson, Real-Time Collision Detection, 5.1.5).
+Point closestOnTriangle(const Point &p, const std::array<Point, 3> &t) {
+    const Point &a = t[0], &b = t[1], &c = t[2];
+    Point ab = subtract(b, a), ac = subtract(c, a), ap = subtract(p, a);
+    double d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) return a;
+
+    Point bp = subtract(p, b);
+    double d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) return b;
+
+    auto along = [](const Point &from, const Point &d, double s) -> Point {
+        return {from[0] + s * d[0], from[1] + s * d[1], from[2] + s * d[2]};
+    };
+
+    double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) return along(a, ab, d1 / (d1 - d3));
+
+    Point cp = subtract(p, c);
+    double d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) return c;
+
+    double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) return along(a, ac, d2 / (d2 - d6));
+
+    double va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+        return along(b, subtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    double denominator = 1 / (va + vb + vc);
+    double v = vb * denominator, w = vc * denominator;
+    return {a[0] + ab[0] * v + ac[0] * w, a[1] + ab[1] * v + ac[1] * w, a[2] + ab[2] * v + ac[2] * w};
+}
+
+double boxDistance2(const BvhNode &node, const Point &p) {
+    double d2 = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        double d = std::max({double(node.lo[axis]) - p[axis], 0.0, p[axis] - double(node.hi[axis])});
+        d2 += d * d;
+    }
+    return d2;
+}
+
+}
+
+Bvh::Bvh(const Geometry &geometry, unsigned threads) {
+    const auto &faces = geometry.mesh().faces();
+    assert(faces.size() < UINT32_MAX);
+    if (faces.empty()) return;
+
+    std::vector<Reference> refs(faces.size());
+    std::vector<std::array<Point, 3>> triangles(faces.size());
+    double scale = 0;
+    for (const Face &face: faces) {
+        Reference &ref = refs[face.index];
+        ref.lo = infinite(1);
+        ref.hi = infinite(-1);
+        int c = 0;
+        for (const Vertex *vertex: face.vertices()) {
+            const Point &p = geometry.positions()[vertex->index];
+            triangles[face.index][c++] = p;
+            grow(ref.lo, ref.hi, p);
+            scale = std::max({scale, std::abs(p[0]), std::abs(p[1]), std::abs(p[2])});
+        }
+        for (int axis = 0; axis < 3; axis++) ref.centroid[axis] = (ref.lo[axis] + ref.hi[axis]) / 2;
+        ref.face = face.index;
+    }
+    pad_ = scale * slack;
+
+    // Split the upper levels here, then build the subtrees below them in
+    // parallel, each into its own array.
+    std::vector<Subtree> subtrees;
+    buildTop(refs.data(), 0, refs.size(), 0, subtrees);
+    std::vector<std::vector<BvhNode>> local(subtrees.size());
+    parallelFor(subtrees.size(), threads, 1, [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; i++) {
+            build(refs.data(), subtrees[i].begin, subtrees[i].end, subtrees[i].depth, local[i]);
+        }
+    });
+
+    // Splice each subtree over its placeholder. Placeholders were pushed in
+    // depth-first order, so the result is depth-first too.
+    std::vector<BvhNode> top;
+    top.swap(nodes_);
+    std::vector<uint32_t> remap(top.size());
+    std::vector<bool> placeholder(top.size(), false);
+    for (const Subtree &subtree: subtrees) placeholder[subtree.node] = true;
+    size_t next = 0;
+    for (size_t i = 0; i < top.size(); i++) {
+        remap[i] = nodes_.size();
+        if (!placeholder[i]) {
+            nodes_.push_back(top[i]);
+            continue;
+        }
+        uint32_t offset = nodes_.size();
+        for (BvhNode node: local[next++]) {
+            if (node.count == 0) node.index += offset;
+            nodes_.push_back(node);
+        }
+    }
+    for (size_t i = 0; i < top.size(); i++) {
+        if (!placeholder[i]) nodes_[remap[i]].index = remap[top[i].index];
+    }
+
+    triangles_.resize(refs.size());
+    faces_.resize(refs.size());
+    for (size_t i = 0; i < refs.size(); i++) {
+        triangles_[i] = triangles[refs[i].face];
+        faces_[i] = refs[i].face;
+    }
+}
+
+uint32_t Bvh::buildTop(Reference *refs, uint32_t begin, uint32_t end, int depth, std::vector<Subtree> &subtrees) {
+    uint32_t index = nodes_.size();
+    nodes_.emplace_back();
+    if (end - begin <= subtreeSize) {
+        subtrees.push_back({index, begin, end, depth});
+        return index;
+    }
+
+    BvhNode node;
+    uint32_t middle;
+    bool interior = split(refs, begin, end, depth, node, middle);
+    assert(interior);
+    nodes_[index] = node;
+    buildTop(refs, begin, middle, depth + 1, subtrees);
+    nodes_[index].index = buildTop(refs, middle, end, depth + 1, subtrees);
+    return index;
+}
+
+void Bvh::build(Reference *refs, uint32_t begin, uint32_t end, int depth, std::vector<BvhNode> &nodes) const {
+    uint32_t index = nodes.size();
+    nodes.emplace_back();
+    BvhNode node;
+    uint32_t middle;
+    if (!split(refs, begin, end, depth, node, middle)) {
+        node.index = begin;
+        node.count = end - begin;
+        nodes[index] = node;
+        return;
+    }
+    nodes[index] = node;
+    build(refs, begin, middle, depth + 1, nodes);
+    nodes[index].index = nodes.size();
+    build(refs, middle, end, depth + 1, nodes);
+}
+
+bool Bvh::split(Reference *refs, uint32_t begin, uint32_t end, int depth, BvhNode &node, uint32_t &middle) const {
+    Point lo = infinite(1), hi = infinite(-1), clo = infinite(1), chi = infinite(-1);
+    for (uint32_t i = begin; i < end; i++) {
+        grow(lo, hi, refs[i].lo);
+        grow(lo, hi, refs[i].hi);
+        grow(clo, chi, refs[i].centroid);
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        node.lo[axis] = std::nextafter(float(lo[axis]), -INFINITY) - pad_;
+        node.hi[axis] = std::nextafter(float(hi[axis]), INFINITY) + pad_;
+    }
+    node.index = 0;
+    node.count = 0;
+    node.axis = 0;
+    node.pad = 0;
+
+    const uint32_t n = end - begin;
+    if (n <= 1) return false;
+
+    // Find the cheapest of the planes between bins on every axis, costing
+    // a traversal step and a triangle test alike.
+    double best = std::numeric_limits<double>::infinity();
+    int bestAxis = -1, bestPlane = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        double extent = chi[axis] - clo[axis];
+        if (extent <= 0) continue;
+
+        uint32_t counts[bins] = {};
+        Point blo[bins], bhi[bins];
+        std::fill(blo, blo + bins, infinite(1));
+        std::fill(bhi, bhi + bins, infinite(-1));
+        for (uint32_t i = begin; i < end; i++) {
+            int b = std::min(bins - 1, int(bins * (refs[i].centroid[axis] - clo[axis]) / extent));
+            counts[b]++;
+            grow(blo[b], bhi[b], refs[i].lo);
+            grow(blo[b], bhi[b], refs[i].hi);
+        }
+
+        // Right-to-left sweep for the right sides, then left-to-right.
+        double rightCost[bins];
+        Point rlo = infinite(1), rhi = infinite(-1);
+        uint32_t rcount = 0;
+        for (int b = bins - 1; b > 0; b--) {
+            grow(rlo, rhi, blo[b]);
+            grow(rlo, rhi, bhi[b]);
+            rcount += counts[b];
+            rightCost[b] = rcount ? rcount * area(rlo, rhi) : 0;
+        }
+        Point llo = infinite(1), lhi = infinite(-1);
+        uint32_t lcount = 0;
+        for (int b = 0; b < bins - 1; b++) {
+            grow(llo, lhi, blo[b]);
+            grow(llo, lhi, bhi[b]);
+            lcount += counts[b];
+            if (lcount == 0 || lcount == n) continue;
+            double cost = lcount * area(llo, lhi) + rightCost[b + 1];
+            if (cost < best) {
+                best = cost;
+                bestAxis = axis;
+                bestPlane = b + 1;
+            }
+        }
+    }
+
+    const double splitCost = 1 + best / area(lo, hi);
+    if (n <= leafSize && (bestAxis == -1 || n <= splitCost)) return false;
+
+    Reference *first = refs + begin, *last = refs + end;
+    if (bestAxis == -1 || depth >= maxDepth) {
+        // Coincident centroids, or too deep: split the widest axis at the
+        // median.
+        int axis = 0;
+        for (int a = 1; a < 3; a++) {
+            if (chi[a] - clo[a] > chi[axis] - clo[axis]) axis = a;
+        }
+        middle = begin + n / 2;
+        std::nth_element(first, refs + middle, last, [&](const Reference &a, const Reference &b) {
+            return a.centroid[axis] < b.centroid[axis] || (a.centroid[axis] == b.centroid[axis] && a.face < b.face);
+        });
+        node.axis = axis;
+        return true;
+    }
+
+    const double extent = chi[bestAxis] - clo[bestAxis];
+    Reference *mid = std::partition(first, last, [&](const Reference &ref) {
+        return std::min(bins - 1, int(bins * (ref.centroid[bestAxis] - clo[bestAxis]) / extent)) < bestPlane;
+    });
+    middle = mid - refs;
+    node.axis = bestAxis;
+    return true;
+}
+
+bool Bvh::intersect(const Ray &ray, RayHit &best) const {
+    best = RayHit{};
+    if (nodes_.empty()) return false;
+
+    const float o[3] = {float(ray.origin[0]), float(ray.origin[1]), float(ray.origin[2])};
+    const float inv[3] = {reciprocal(ray.direction[0]), reciprocal(ray.direction[1]), reciprocal(ray.direction[2])};
+
+    std::array<uint32_t, Bvh::stackSize> stack;
+    size_t top = 0;
+    stack[top++] = 0;
+    double tmax = ray.tmax;
+    while (top > 0) {
+        const BvhNode &node = nodes_[stack[--top]];
+        float tnear = -INFINITY, tfar = INFINITY;
+        for (int axis = 0; axis < 3; axis++) {
+            float t0 = (node.lo[axis] - o[axis]) * inv[axis];
+            float t1 = (node.hi[axis] - o[axis]) * inv[axis];
+            tnear = std::max(tnear, std::min(t0, t1));
+            tfar = std::min(tfar, std::max(t0, t1));
+        }
+        tnear -= std::abs(tnear) * slack;
+        tfar += std::abs(tfar) * slack;
+        if (tnear > tfar || tfar < ray.tmin || tnear > tmax) continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.index; i < node.index + node.count; i++) {
+                RayHit hit;
+                if (!intersectTriangle(ray, triangles_[i], tmax, hit)) continue;
+                hit.face = faces_[i];
+                keep(best, hit);
+                tmax = best.t;
+            }
+            continue;
+        }
+
+        // Visit the nearer child first.
+        uint32_t first = &node - nodes_.data() + 1, second = node.index;
+        if (ray.direction[node.axis] < 0) std::swap(first, second);
+        stack[top++] = second;
+        stack[top++] = first;
+    }
+    return best.face != -1;
+}
+
+void Bvh::packet(const Ray *rays, RayHit *hits, size_t count) const {
+    // Lanes past count have an empty interval and never hit anything.
+    alignas(32) float ox[packetSize], oy[packetSize], oz[packetSize];
+    alignas(32) float ix[packetSize], iy[packetSize], iz[packetSize];
+    alignas(32) float tmin[packetSize], tmax[packetSize];
+    for (size_t i = 0; i < packetSize; i++) {
+        const Ray &ray = rays[i < count ? i : 0];
+        ox[i] = ray.origin[0];
+        oy[i] = ray.origin[1];
+        oz[i] = ray.origin[2];
+        ix[i] = reciprocal(ray.direction[0]);
+        iy[i] = reciprocal(ray.direction[1]);
+        iz[i] = reciprocal(ray.direction[2]);
+        tmin[i] = i < count ? std::nextafter(float(ray.tmin), -INFINITY) : 1;
+        tmax[i] = i < count ? std::nextafter(float(ray.tmax), INFINITY) : -1;
+    }
+    for (size_t i = 0; i < count; i++) hits[i] = RayHit{};
+
+    std::array<uint32_t, Bvh::stackSize> stack;
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BvhNode &node = nodes_[stack[--top]];
+
+        // The slab test for the whole packet, written so that it vectorizes.
+        alignas(32) int active[packetSize];
+        for (int i = 0; i < packetSize; i++) {
+            float x0 = (node.lo[0] - ox[i]) * ix[i], x1 = (node.hi[0] - ox[i]) * ix[i];
+            float y0 = (node.lo[1] - oy[i]) * iy[i], y1 = (node.hi[1] - oy[i]) * iy[i];
+            float z0 = (node.lo[2] - oz[i]) * iz[i], z1 = (node.hi[2] - oz[i]) * iz[i];
+            float tnear = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::min(z0, z1));
+            float tfar = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::max(z0, z1));
+            tnear -= std::abs(tnear) * slack;
+            tfar += std::abs(tfar) * slack;
+            active[i] = (tnear <= tfar) & (tfar >= tmin[i]) & (tnear <= tmax[i]);
+        }
+        int any = 0;
+        for (int i = 0; i < packetSize; i++) any |= active[i];
+        if (!any) continue;
+
+        if (node.count > 0) {
+            for (uint32_t t = node.index; t < node.index + node.count; t++) {
+                for (size_t i = 0; i < count; i++) {
+                    if (!active[i]) continue;
+                    RayHit hit;
+                    if (!intersectTriangle(rays[i], triangles_[t], std::min(rays[i].tmax, hits[i].t), hit)) continue;
+                    hit.face = faces_[t];
+                    keep(hits[i], hit);
+                    tmax[i] = std::nextafter(float(hits[i].t), INFINITY);
+                }
+            }
+            continue;
+        }
+
+        // Order the children by the direction of the first ray.
+        uint32_t first = &node - nodes_.data() + 1, second = node.index;
+        if (rays[0].direction[node.axis] < 0) std::swap(first, second);
+        stack[top++] = second;
+        stack[top++] = first;
+    }
+}
+
+void Bvh::intersect(const Ray *rays, RayHit *hits, size_t count, unsigned threads) const {
+    if (nodes_.empty()) {
+        std::fill(hits, hits + count, RayHit{});
+        return;
+    }
+    const size_t packets = (count + packetSize - 1) / packetSize;
+    parallelFor(packets, threads, 64, [&](size_t begin, size_t end, unsigned) {
+        for (size_t p = begin; p < end; p++) {
+            size_t first = p * packetSize;
+            packet(rays + first, hits + first, std::min<size_t>(packetSize, count - first));
+        }
+    });
+}
+
+ClosestPoint Bvh::closest(const Geometry::Point &p, double maxDistance) const {
+    ClosestPoint best;
+    if (nodes_.empty()) return best;
+
+    double best2 = maxDistance * maxDistance;
+    std::array<uint32_t, Bvh::stackSize> stack;
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BvhNode &node = nodes_[stack[--top]];
+        if (boxDistance2(node, p) > best2) continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.index; i < node.index + node.count; i++) {
+                Point q = closestOnTriangle(p, triangles_[i]);
+                Point d = subtract(q, p);
+                double d2 = dot(d, d);
+                if (d2 < best2 || (d2 == best2 && (best.face == -1 || faces_[i] < best.face))) {
+                    best2 = d2;
+                    best.point = q;
+                    best.face = faces_[i];
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first.
+        uint32_t first = &node - nodes_.data() + 1, second = node.index;
+        if (boxDistance2(nodes_[first], p) > boxDistance2(nodes_[second], p)) std::swap(first, second);
+        stack[top++] = second;
+        stack[top++] = first;
+    }
+    if (best.face != -1) best.distance = std::sqrt(best2);
+    return best;
+}
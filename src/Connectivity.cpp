@@ -0,0 +1,167 @@
+#include <Connectivity.h>
+#include <Parallel.h>
+#include <Trace.h>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+namespace {
+
+struct HalfEdgeKey {
+    uint64_t key;
+    uint32_t halfedge;
+};
+
+constexpr int radixBits = 8;
+constexpr size_t radixSize = 1 << radixBits;
+using Histogram = std::array<size_t, radixSize>;
+
+// Splits [0, n) into `chunks` contiguous, ordered ranges.
+size_t chunkBegin(size_t n, size_t chunks, size_t c) {
+    return n * c / chunks;
+}
+
+// A stable least-significant-digit radix sort. Each chunk of the input is
+// histogrammed in parallel, the histograms are combined into per-chunk
+// output offsets, and each chunk then scatters in parallel. Digits on which
+// every key agrees are skipped.
+void radixSort(std::vector<HalfEdgeKey> &keys, uint64_t maxKey, unsigned threads) {
+    const size_t n = keys.size();
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, n / 16384));
+    std::vector<HalfEdgeKey> scratch(n);
+    std::vector<Histogram> histograms(chunks);
+
+    for (int shift = 0; shift < 64 && (maxKey >> shift) != 0; shift += radixBits) {
+        parallelFor(chunks, threads, 1, [&](size_t begin, size_t end, unsigned) {
+            for (size_t c = begin; c < end; c++) {
+                histograms[c].fill(0);
+                for (size_t i = chunkBegin(n, chunks, c); i < chunkBegin(n, chunks, c + 1); i++) {
+                    histograms[c][(keys[i].key >> shift) & (radixSize - 1)]++;
+                }
+            }
+        });
+
+        size_t offset = 0;
+        bool uniform = false;
+        for (size_t d = 0; d < radixSize; d++) {
+            size_t total = 0;
+            for (size_t c = 0; c < chunks; c++) {
+                size_t count = histograms[c][d];
+                histograms[c][d] = offset + total;
+                total += count;
+            }
+            uniform = uniform || total == n;
+            offset += total;
+        }
+        if (uniform) continue;
+
+        parallelFor(chunks, threads, 1, [&](size_t begin, size_t end, unsigned) {
+            for (size_t c = begin; c < end; c++) {
+                auto &position = histograms[c];
+                for (size_t i = chunkBegin(n, chunks, c); i < chunkBegin(n, chunks, c + 1); i++) {
+                    scratch[position[(keys[i].key >> shift) & (radixSize - 1)]++] = keys[i];
+                }
+            }
+        });
+        keys.swap(scratch);
+    }
+}
+
+}
+
+Connectivity computeConnectivity(int vertexCount, const std::vector<std::array<int, 3>> &faces, unsigned threads) {
+    trace::Scope scope{"connectivity"};
+    if (threads == 0) threads = hardwareThreads();
+    const size_t n = 3 * faces.size();
+    const uint64_t v = vertexCount;
+    const size_t grain = 1 << 16;
+
+    // Key each half-edge by its sorted vertex indices. Packing the pair as
+    // min * V + max keeps the key as short as possible, which bounds the
+    // number of radix passes by 2 log2(V) / 8.
+    std::vector<HalfEdgeKey> keys(n);
+    parallelFor(faces.size(), threads, grain, [&](size_t begin, size_t end, unsigned) {
+        for (size_t f = begin; f < end; f++) {
+            for (int j = 0; j < 3; j++) {
+                int a = faces[f][j];
+                int b = faces[f][(j + 1) % 3];
+                assert(a >= 0 && a < vertexCount);
+                assert(b >= 0 && b < vertexCount);
+                auto [lo, hi] = std::minmax(a, b);
+                keys[3 * f + j] = {lo * v + hi, static_cast<uint32_t>(3 * f + j)};
+            }
+        }
+    });
+    radixSort(keys, v * v, threads);
+
+    // Half-edges of the same edge are now adjacent. A run of one is a
+    // boundary edge, a run of two is a pair of twins, and anything longer is
+    // non-manifold. Runs that straddle a chunk boundary belong to the chunk
+    // in which they start.
+    Connectivity connectivity;
+    auto &twins = connectivity.twins;
+    twins.assign(n, Connectivity::invalid);
+    std::atomic<bool> manifold{true};
+
+    parallelFor(n, threads, grain, [&](size_t begin, size_t end, unsigned) {
+        size_t i = begin;
+        while (i > 0 && i < end && keys[i].key == keys[i - 1].key) i++;
+        while (i < end) {
+            size_t j = i + 1;
+            while (j < n && keys[j].key == keys[i].key) j++;
+            if (j - i == 2) {
+                twins[keys[i].halfedge] = keys[i + 1].halfedge;
+                twins[keys[i + 1].halfedge] = keys[i].halfedge;
+            } else if (j - i > 2) {
+                manifold = false;
+            }
+            i = j;
+        }
+    });
+
+    if (!manifold) {
+        throw std::runtime_error("error: non-manifold surface");
+    }
+
+    // Number the edges in order of their first half-edge with a parallel
+    // prefix sum, so that the numbering does not depend on the thread count.
+    auto first = [&](size_t h) {
+        return twins[h] == Connectivity::invalid || h < twins[h];
+    };
+
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, n / grain));
+    std::vector<size_t> offsets(chunks + 1, 0);
+    parallelFor(chunks, threads, 1, [&](size_t begin, size_t end, unsigned) {
+        for (size_t c = begin; c < end; c++) {
+            for (size_t h = chunkBegin(n, chunks, c); h < chunkBegin(n, chunks, c + 1); h++) {
+                offsets[c + 1] += first(h);
+            }
+        }
+    });
+    for (size_t c = 0; c < chunks; c++) {
+        offsets[c + 1] += offsets[c];
+    }
+
+    connectivity.edges.resize(n);
+    connectivity.edgeHalfedges.resize(offsets[chunks]);
+    parallelFor(chunks, threads, 1, [&](size_t begin, size_t end, unsigned) {
+        for (size_t c = begin; c < end; c++) {
+            size_t e = offsets[c];
+            for (size_t h = chunkBegin(n, chunks, c); h < chunkBegin(n, chunks, c + 1); h++) {
+                if (first(h)) {
+                    connectivity.edges[h] = e;
+                    connectivity.edgeHalfedges[e] = h;
+                    e++;
+                }
+            }
+        }
+    });
+    parallelFor(n, threads, grain, [&](size_t begin, size_t end, unsigned) {
+        for (size_t h = begin; h < end; h++) {
+            if (!first(h)) connectivity.edges[h] = connectivity.edges[twins[h]];
+        }
+    });
+
+    return connectivity;
+}
@@ -0,0 +1,54 @@
+#include <IndexedMesh.h>
+#include <Connectivity.h>
+#include <algorithm>
+#include <cassert>
+
+IndexedMesh::IndexedMesh(int vertexCount, const std::vector<std::array<int, 3>> &faces, unsigned threads) {
+    assert(faces.size() > 0);
+
+    Connectivity connectivity = computeConnectivity(vertexCount, faces, threads);
+    twin_ = std::move(connectivity.twins);
+    edge_ = std::move(connectivity.edges);
+    edgeHalfedge_ = std::move(connectivity.edgeHalfedges);
+
+    vertex_.resize(3 * faces.size());
+    vertexHalfedge_.assign(vertexCount, invalid);
+    for (Index h = 0; h < vertex_.size(); h++) {
+        vertex_[h] = faces[h / 3][h % 3];
+        vertexHalfedge_[vertex_[h]] = h;
+    }
+}
+
+IndexedMesh::IndexedMesh(const Mesh &mesh) {
+    const auto &halfedges = mesh.halfedges();
+    twin_.resize(halfedges.size());
+    vertex_.resize(halfedges.size());
+    edge_.resize(halfedges.size());
+    vertexHalfedge_.resize(mesh.vertices().size());
+    edgeHalfedge_.resize(mesh.edges().size());
+
+    for (auto &h: halfedges) {
+        twin_[h.index] = h.onBoundary ? invalid : h.twin->index;
+        vertex_[h.index] = h.vertex->index;
+        edge_[h.index] = h.edge->index;
+    }
+    for (auto &v: mesh.vertices()) {
+        vertexHalfedge_[v.index] = v.halfedge ? v.halfedge->index : invalid;
+    }
+    for (auto &e: mesh.edges()) {
+        edgeHalfedge_[e.index] = e.halfedge->index;
+    }
+}
+
+bool IndexedMesh::closed() const {
+    return std::find(twin_.begin(), twin_.end(), invalid) == twin_.end();
+}
+
+int IndexedMesh::eulerCharacteristic() const {
+    return vertexCount() - edgeCount() + faceCount();
+}
+
+size_t IndexedMesh::memoryUsage() const {
+    return sizeof(Index) * (twin_.capacity() + vertex_.capacity() + edge_.capacity()
+        + vertexHalfedge_.capacity() + edgeHalfedge_.capacity());
+}
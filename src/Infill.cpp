@@ -0,0 +1,138 @@
+#include <Infill.h>
+#include <Parallel.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+// The unit vector at the given angle in degrees, exact at quarter turns so
+// that lines parallel to the axes stay parallel to axis-aligned edges.
+std::array<double, 2> direction(double degrees) {
+    double turns = std::fmod(degrees, 360.0);
+    if (turns < 0) turns += 360;
+    if (turns == 0) return {1, 0};
+    if (turns == 90) return {0, 1};
+    if (turns == 180) return {-1, 0};
+    if (turns == 270) return {0, -1};
+    return {std::cos(turns * M_PI / 180), std::sin(turns * M_PI / 180)};
+}
+
+}
+
+double infillSpacing(const InfillSettings &settings) {
+    int families = settings.pattern == InfillPattern::Grid ? 2 : settings.pattern == InfillPattern::Triangles ? 3 : 1;
+    return families * settings.lineWidth / settings.density;
+}
+
+InfillGenerator::InfillGenerator(const InfillSettings &settings):
+    settings_{settings},
+    spacing_{settings.density > 0 ? infillSpacing(settings) : 0} {
+    assert(settings.lineWidth > 0 && settings.density <= 1);
+}
+
+void InfillGenerator::generate(const Slicer::Polygons &contours, int layer, InfillPath &result) {
+    result.clear();
+    if (settings_.density <= 0) return;
+
+    switch (settings_.pattern) {
+    case InfillPattern::Lines:
+        scan(contours, settings_.angle + (layer % 2 ? 90 : 0), result);
+        break;
+    case InfillPattern::Grid:
+        scan(contours, settings_.angle, result);
+        scan(contours, settings_.angle + 90, result);
+        break;
+    case InfillPattern::Triangles:
+        scan(contours, settings_.angle, result);
+        scan(contours, settings_.angle + 60, result);
+        scan(contours, settings_.angle + 120, result);
+        break;
+    }
+}
+
+void InfillGenerator::scan(const Slicer::Polygons &contours, double angle, InfillPath &result) {
+    // In the rotated frame, u runs along the lines and v across them; line
+    // k lies at v = k * spacing.
+    const std::array<double, 2> d = direction(angle);
+    const double c = d[0], s = d[1];
+    auto rotate = [&](const Slicer::Point &p) -> std::array<double, 2> {
+        return {c * p[0] + s * p[1], c * p[1] - s * p[0]};
+    };
+
+    double vmin = INFINITY, vmax = -INFINITY;
+    for (const auto &polygon: contours) {
+        for (const auto &p: polygon) {
+            double v = c * p[1] - s * p[0];
+            vmin = std::min(vmin, v);
+            vmax = std::max(vmax, v);
+        }
+    }
+    if (!(vmin < vmax)) return;
+
+    // An edge crosses the lines with v0 <= v < v1. Every vertex decides
+    // which lines it lies below in the same way for both of its edges, so
+    // each line crosses a closed contour an even number of times.
+    const int base = std::ceil(vmin / spacing_);
+    const int lines = int(std::ceil(vmax / spacing_)) - base;
+    edges_.clear();
+    starts_.assign(lines, -1);
+
+    auto addEdge = [&](const Slicer::Point &a, const Slicer::Point &b) {
+        std::array<double, 2> p = rotate(a), q = rotate(b);
+        if (p[1] == q[1]) return;
+        if (p[1] > q[1]) std::swap(p, q);
+        int first = int(std::ceil(p[1] / spacing_)) - base;
+        int last = int(std::ceil(q[1] / spacing_)) - base;
+        if (first >= last) return;
+        edges_.push_back({p[0], p[1], (q[0] - p[0]) / (q[1] - p[1]), first, last, starts_[first]});
+        starts_[first] = edges_.size() - 1;
+    };
+
+    // Open contours are closed, as the rasterizer closes them.
+    for (const auto &polygon: contours) {
+        if (polygon.size() < 2) continue;
+        for (size_t i = 0; i + 1 < polygon.size(); i++) addEdge(polygon[i], polygon[i + 1]);
+        if (polygon.back() != polygon.front()) addEdge(polygon.back(), polygon.front());
+    }
+
+    active_.clear();
+    for (int line = 0; line < lines; line++) {
+        for (int e = starts_[line]; e != -1; e = edges_[e].next) active_.push_back(e);
+        active_.erase(std::remove_if(active_.begin(), active_.end(), [&](int e) {
+            return edges_[e].last <= line;
+        }), active_.end());
+
+        const double v = (base + line) * spacing_;
+        crossings_.clear();
+        for (int e: active_) {
+            const ScanEdge &edge = edges_[e];
+            crossings_.push_back(edge.u0 + (v - edge.v0) * edge.dudv);
+        }
+        std::sort(crossings_.begin(), crossings_.end());
+
+        // Odd lines run backwards, so that each segment starts near where
+        // the last one ended.
+        auto emit = [&](double u0, double u1) {
+            if (u0 == u1) return;
+            result.push_back({{{c * u0 - s * v, s * u0 + c * v}}, {{c * u1 - s * v, s * u1 + c * v}}});
+        };
+        const size_t n = crossings_.size() & ~size_t(1);
+        if ((base + line) % 2 == 0) {
+            for (size_t i = 0; i < n; i += 2) emit(crossings_[i], crossings_[i + 1]);
+        } else {
+            for (size_t i = n; i > 0; i -= 2) emit(crossings_[i - 1], crossings_[i - 2]);
+        }
+    }
+}
+
+std::vector<InfillPath> infillLayers(const std::vector<Slicer::Polygons> &layers, const InfillSettings &settings,
+                                     unsigned threads) {
+    if (threads == 0) threads = hardwareThreads();
+    std::vector<InfillPath> result(layers.size());
+    std::vector<InfillGenerator> generators(threads, InfillGenerator{settings});
+    parallelFor(layers.size(), threads, 1, [&](size_t begin, size_t end, unsigned worker) {
+        for (size_t i = begin; i < end; i++) generators[worker].generate(layers[i], i, result[i]);
+    });
+    return result;
+}
@@ -0,0 +1,381 @@
+#include <LayerStack.h>
+#include <MappedFile.h>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+constexpr char magic[8] = {'H', 'E', 'L', 'A', 'Y', 'E', 'R', 'S'};
+constexpr uint32_t version = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    double scale;
+    double pitch;
+    double centerX;
+    double centerY;
+    uint32_t masks;
+    int32_t width;
+    int32_t height;
+    int32_t bits;
+    int32_t supersample;
+    int32_t reserved;
+};
+
+struct Footer {
+    uint64_t indexOffset;
+    uint64_t layerCount;
+    char magic[8];
+};
+
+void putVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(char(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(char(v));
+}
+
+// Zigzag encoding keeps small negative deltas small.
+void putSigned(std::string &out, int64_t v) {
+    putVarint(out, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+}
+
+// Reads varints from a byte range, throwing rather than reading past it.
+class Cursor {
+public:
+    Cursor(const char *begin, size_t size):
+        p_{reinterpret_cast<const uint8_t*>(begin)}, end_{p_ + size} {}
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            v |= uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("error: corrupt layer stack");
+    }
+
+    int64_t signedVarint() {
+        uint64_t v = varint();
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+    uint8_t byte() {
+        if (p_ == end_) throw std::runtime_error("error: corrupt layer stack");
+        return *p_++;
+    }
+
+    bool done() const { return p_ == end_; }
+
+private:
+    const uint8_t *p_;
+    const uint8_t *end_;
+};
+
+// Accumulates runs of equal pixel values. Bitmasks store only the lengths,
+// alternating between 0 and 1 from a run of 0; grayscale masks store each
+// length followed by its value.
+class RunEncoder {
+public:
+    RunEncoder(std::string &out, int bits): out_{out}, bits_{bits} {}
+
+    void add(int value, uint64_t count) {
+        if (value == value_) {
+            run_ += count;
+            return;
+        }
+        flush();
+        value_ = value;
+        run_ = count;
+    }
+
+    void flush() {
+        putVarint(out_, run_);
+        if (bits_ == 8) out_.push_back(char(value_));
+    }
+
+private:
+    std::string &out_;
+    int bits_;
+    int value_ = 0;
+    uint64_t run_ = 0;
+};
+
+void encodeMask(const Mask &mask, std::string &out) {
+    RunEncoder runs{out, mask.bits};
+    for (int y = 0; y < mask.height; y++) {
+        const uint8_t *row = &mask.data[y * mask.stride];
+        if (mask.bits == 8) {
+            for (int x = 0; x < mask.width;) {
+                int begin = x++;
+                while (x < mask.width && row[x] == row[begin]) x++;
+                runs.add(row[begin], x - begin);
+            }
+            continue;
+        }
+
+        // Runs of whole bytes of 0 or 1 bits are counted at once.
+        int x = 0;
+        while (x + 8 <= mask.width) {
+            uint8_t b = row[x >> 3];
+            if (b == 0x00 || b == 0xFF) {
+                int begin = x;
+                const uint64_t word = b ? ~uint64_t{0} : 0;
+                x += 8;
+                while (x + 64 <= mask.width) {
+                    uint64_t w;
+                    std::memcpy(&w, row + (x >> 3), sizeof(w));
+                    if (w != word) break;
+                    x += 64;
+                }
+                while (x + 8 <= mask.width && row[x >> 3] == b) x += 8;
+                runs.add(b & 1, x - begin);
+            } else {
+                for (int i = 7; i >= 0; i--) runs.add((b >> i) & 1, 1);
+                x += 8;
+            }
+        }
+        for (; x < mask.width; x++) runs.add(mask.at(x, y), 1);
+    }
+    runs.flush();
+}
+
+void decodeMask(Cursor cursor, Mask &mask) {
+    const uint64_t total = uint64_t(mask.width) * mask.height;
+    uint64_t position = 0;
+    int value = 0;
+    while (position < total) {
+        uint64_t run = cursor.varint();
+        if (mask.bits == 8) value = cursor.byte();
+        if (run > total - position) throw std::runtime_error("error: corrupt layer stack");
+
+        // A run may cover the end of one row and the start of the next.
+        uint64_t end = position + run;
+        while (value != 0 && position < end) {
+            int y = position / mask.width, x = position % mask.width;
+            int last = std::min<uint64_t>(mask.width, x + (end - position));
+            mask.fill(y, x, last, value);
+            position += last - x;
+        }
+        position = end;
+        if (mask.bits == 1) value ^= 1;
+    }
+    if (!cursor.done()) throw std::runtime_error("error: corrupt layer stack");
+}
+
+}
+
+LayerStackWriter::LayerStackWriter(const std::string &path, const LayerStackSettings &settings):
+    path_{path}, temporary_{path + ".tmp"}, settings_{settings},
+    file_{temporary_, std::ios::binary} {
+    assert(settings.scale > 0);
+    if (!file_) {
+        throw std::runtime_error("error: cannot write " + path);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.headerSize = sizeof(Header);
+    header.scale = settings.scale;
+    header.pitch = settings.raster.pitch;
+    header.centerX = settings.raster.centerX;
+    header.centerY = settings.raster.centerY;
+    header.masks = settings.masks;
+    header.width = settings.raster.width;
+    header.height = settings.raster.height;
+    header.bits = settings.raster.bits;
+    header.supersample = settings.raster.supersample;
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    offset_ = sizeof(header);
+}
+
+LayerStackWriter::~LayerStackWriter() {
+    if (!finished_) {
+        file_.close();
+        std::error_code error;
+        std::filesystem::remove(temporary_, error);
+    }
+}
+
+LayerRecord LayerStackWriter::encode(double z, const Slicer::Polygons &polygons, const Mask *mask) const {
+    assert(settings_.masks == (mask != nullptr));
+    LayerRecord record;
+    record.z = z;
+
+    // Each polygon stores its point count, shifted left by one, with the low
+    // bit set when its repeated closing point was dropped. Deltas run on
+    // from the last point of the previous polygon.
+    std::string &out = record.contours;
+    putVarint(out, polygons.size());
+    int64_t px = 0, py = 0;
+    for (const auto &polygon: polygons) {
+        bool closed = polygon.size() > 1 && polygon.front() == polygon.back();
+        size_t n = closed ? polygon.size() - 1 : polygon.size();
+        putVarint(out, n << 1 | closed);
+        for (size_t i = 0; i < n; i++) {
+            int64_t x = std::llround(polygon[i][0] * settings_.scale);
+            int64_t y = std::llround(polygon[i][1] * settings_.scale);
+            putSigned(out, x - px);
+            putSigned(out, y - py);
+            px = x;
+            py = y;
+        }
+    }
+
+    if (mask) {
+        assert(mask->width == settings_.raster.width && mask->height == settings_.raster.height);
+        assert(mask->bits == settings_.raster.bits);
+        encodeMask(*mask, record.mask);
+    }
+    return record;
+}
+
+void LayerStackWriter::append(const LayerRecord &record) {
+    assert(index_.empty() || index_.back().z <= record.z);
+    index_.push_back({record.z, offset_, record.contours.size(), record.mask.size()});
+    file_.write(record.contours.data(), record.contours.size());
+    file_.write(record.mask.data(), record.mask.size());
+    offset_ += record.contours.size() + record.mask.size();
+}
+
+void LayerStackWriter::write(double z, const Slicer::Polygons &polygons, const Mask *mask) {
+    append(encode(z, polygons, mask));
+}
+
+void LayerStackWriter::finish() {
+    assert(!finished_);
+    Footer footer{offset_, index_.size(), {}};
+    std::memcpy(footer.magic, magic, sizeof(magic));
+    file_.write(reinterpret_cast<const char*>(index_.data()), sizeof(Entry) * index_.size());
+    file_.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error("error: cannot write " + path_);
+    }
+    std::filesystem::rename(temporary_, path_);
+    finished_ = true;
+}
+
+LayerStackReader::LayerStackReader(const std::string &path):
+    file_{std::make_unique<MappedFile>(path)} {
+    auto invalid = [&]() {
+        return std::runtime_error("error: " + path + " is not a layer stack");
+    };
+    if (file_->size() < sizeof(Header) + sizeof(Footer)) throw invalid();
+
+    Header header;
+    Footer footer;
+    std::memcpy(&header, file_->data(), sizeof(header));
+    std::memcpy(&footer, file_->data() + file_->size() - sizeof(footer), sizeof(footer));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || std::memcmp(footer.magic, magic, sizeof(magic)) != 0
+            || header.version != version || header.headerSize != sizeof(Header)) {
+        throw invalid();
+    }
+
+    // The index must fill the space between the last record and the footer.
+    const uint64_t indexEnd = file_->size() - sizeof(Footer);
+    if (footer.indexOffset < sizeof(Header) || footer.indexOffset > indexEnd
+            || (indexEnd - footer.indexOffset) / sizeof(Entry) != footer.layerCount
+            || (indexEnd - footer.indexOffset) % sizeof(Entry) != 0) {
+        throw invalid();
+    }
+    if (header.masks && (header.width <= 0 || header.height <= 0 || (header.bits != 1 && header.bits != 8))) {
+        throw invalid();
+    }
+
+    settings_.scale = header.scale;
+    settings_.masks = header.masks;
+    settings_.raster.width = header.width;
+    settings_.raster.height = header.height;
+    settings_.raster.bits = header.bits;
+    settings_.raster.supersample = header.supersample;
+    settings_.raster.pitch = header.pitch;
+    settings_.raster.centerX = header.centerX;
+    settings_.raster.centerY = header.centerY;
+    index_ = file_->data() + footer.indexOffset;
+    count_ = footer.layerCount;
+}
+
+LayerStackReader::~LayerStackReader() = default;
+
+LayerStackReader::Entry LayerStackReader::entry(size_t layer) const {
+    assert(layer < count_);
+    Entry entry;
+    std::memcpy(&entry, index_ + layer * sizeof(Entry), sizeof(entry));
+    const uint64_t end = index_ - file_->data();
+    if (entry.offset < sizeof(Header) || entry.offset > end || entry.contourBytes > end - entry.offset
+            || entry.maskBytes > end - entry.offset - entry.contourBytes) {
+        throw std::runtime_error("error: corrupt layer stack");
+    }
+    return entry;
+}
+
+double LayerStackReader::z(size_t layer) const {
+    assert(layer < count_);
+    double z;
+    std::memcpy(&z, index_ + layer * sizeof(Entry), sizeof(z));
+    return z;
+}
+
+size_t LayerStackReader::find(double z) const {
+    size_t first = 0, count = count_;
+    while (count > 0) {
+        size_t step = count / 2;
+        if (this->z(first + step) < z) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+Slicer::Polygons LayerStackReader::contours(size_t layer) const {
+    Entry e = entry(layer);
+    Cursor cursor{file_->data() + e.offset, e.contourBytes};
+    // Dividing by an integral scale gives the nearest double to each
+    // decimal multiple of 1 / scale.
+    const double scale = settings_.scale;
+
+    // Every point takes at least two bytes, which bounds the counts read
+    // from a damaged file before anything is allocated for them.
+    Slicer::Polygons polygons(std::min<uint64_t>(cursor.varint(), e.contourBytes));
+    int64_t x = 0, y = 0;
+    for (auto &polygon: polygons) {
+        uint64_t header = cursor.varint();
+        uint64_t n = std::min<uint64_t>(header >> 1, e.contourBytes / 2);
+        polygon.reserve(n + (header & 1));
+        for (uint64_t i = 0; i < n; i++) {
+            x += cursor.signedVarint();
+            y += cursor.signedVarint();
+            polygon.push_back({x / scale, y / scale});
+        }
+        if ((header & 1) && n > 0) polygon.push_back(polygon.front());
+    }
+    if (!cursor.done()) throw std::runtime_error("error: corrupt layer stack");
+    return polygons;
+}
+
+void LayerStackReader::mask(size_t layer, Mask &mask) const {
+    if (!settings_.masks) {
+        throw std::runtime_error("error: layer stack has no masks");
+    }
+    Entry e = entry(layer);
+    const RasterSettings &raster = settings_.raster;
+    mask.width = raster.width;
+    mask.height = raster.height;
+    mask.bits = raster.bits;
+    mask.stride = raster.bits == 1 ? (raster.width + 7) / 8 : raster.width;
+    mask.data.assign(mask.stride * mask.height, 0);
+    decodeMask(Cursor{file_->data() + e.offset + e.contourBytes, e.maskBytes}, mask);
+}
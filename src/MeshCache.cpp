@@ -0,0 +1,271 @@
+#include <MeshCache.h>
+#include <MappedFile.h>
+#include <ObjReader.h>
+#include <StlFile.h>
+#include <Trace.h>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <atomic>
+#include <unistd.h>
+
+namespace {
+
+constexpr char magic[8] = {'H', 'E', 'M', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t version = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t vertexCount;
+    uint64_t faceCount;
+    uint64_t edgeCount;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t sourceHash;
+    uint64_t checksum;
+};
+
+// A fast non-cryptographic hash that consumes 32 bytes per step in four
+// independent lanes, so that verifying a cache runs near memory bandwidth.
+uint64_t hashBytes(const char *data, size_t size, uint64_t seed = 0) {
+    constexpr uint64_t prime = 0x9FB21C651E98DF25ull;
+    uint64_t lanes[4] = {seed ^ size, seed + prime, ~seed, seed - prime};
+
+    auto mix = [](uint64_t h, uint64_t w) {
+        h ^= w * prime;
+        h = (h << 31) | (h >> 33);
+        return h * 0xC2B2AE3D27D4EB4Full;
+    };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t w[4];
+        std::memcpy(w, data + i, sizeof(w));
+        for (int j = 0; j < 4; j++) lanes[j] = mix(lanes[j], w[j]);
+    }
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, sizeof(w));
+        lanes[0] = mix(lanes[0], w);
+    }
+    if (i < size) {
+        uint64_t w = 0;
+        std::memcpy(&w, data + i, size - i);
+        lanes[1] = mix(lanes[1], w);
+    }
+
+    uint64_t h = lanes[0];
+    for (int j = 1; j < 4; j++) h = mix(h, lanes[j]);
+    h ^= h >> 29;
+    h *= prime;
+    return h ^ (h >> 32);
+}
+
+// The sections of a cache file, in file order.
+struct Sections {
+    const char *data[5];
+    size_t size[5];
+
+    uint64_t checksum() const {
+        uint64_t h = 0;
+        for (int i = 0; i < 5; i++) h = hashBytes(data[i], size[i], h);
+        return h;
+    }
+};
+
+std::string fileExtension(const std::string &path) {
+    auto dot = path.rfind(".");
+    if (dot == std::string::npos) return "";
+
+    std::string extension = path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+}
+
+SourceFingerprint SourceFingerprint::of(const std::string &path) {
+    SourceFingerprint fingerprint;
+    fingerprint.size = std::filesystem::file_size(path);
+    fingerprint.modified = std::filesystem::last_write_time(path).time_since_epoch().count();
+
+    constexpr size_t sample = 64 * 1024;
+    std::ifstream file{path, std::ios::binary};
+    std::vector<char> buffer(std::min<uint64_t>(fingerprint.size, 2 * sample));
+    if (fingerprint.size <= 2 * sample) {
+        file.read(buffer.data(), buffer.size());
+    } else {
+        file.read(buffer.data(), sample);
+        file.seekg(fingerprint.size - sample);
+        file.read(buffer.data() + sample, sample);
+    }
+    if (!file) {
+        throw std::runtime_error("error: cannot read " + path);
+    }
+    fingerprint.hash = hashBytes(buffer.data(), buffer.size(), fingerprint.size);
+    return fingerprint;
+}
+
+bool SourceFingerprint::operator==(const SourceFingerprint &other) const {
+    return size == other.size && modified == other.modified && hash == other.hash;
+}
+
+void writeMeshCache(const std::string &cachePath, const Geometry &geometry, const std::string &sourcePath) {
+    trace::Scope scope{"cache"};
+    const Mesh &mesh = geometry.mesh();
+    Connectivity connectivity = mesh.connectivity();
+
+    std::vector<std::array<int, 3>> faces(mesh.faces().size());
+    for (auto &h: mesh.halfedges()) {
+        faces[h.index / 3][h.index % 3] = h.vertex->index;
+    }
+
+    Sections sections{{
+        reinterpret_cast<const char*>(geometry.positions().data()),
+        reinterpret_cast<const char*>(faces.data()),
+        reinterpret_cast<const char*>(connectivity.twins.data()),
+        reinterpret_cast<const char*>(connectivity.edges.data()),
+        reinterpret_cast<const char*>(connectivity.edgeHalfedges.data()),
+    }, {
+        sizeof(Geometry::Point) * geometry.positions().size(),
+        sizeof(faces[0]) * faces.size(),
+        sizeof(uint32_t) * connectivity.twins.size(),
+        sizeof(uint32_t) * connectivity.edges.size(),
+        sizeof(uint32_t) * connectivity.edgeHalfedges.size(),
+    }};
+
+    SourceFingerprint source = SourceFingerprint::of(sourcePath);
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.headerSize = sizeof(Header);
+    header.vertexCount = geometry.positions().size();
+    header.faceCount = faces.size();
+    header.edgeCount = connectivity.edgeHalfedges.size();
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.sourceHash = source.hash;
+    header.checksum = sections.checksum();
+
+    // Write to a temporary file and rename it into place, so that a reader
+    // never maps a partially written cache. The name is unique to this
+    // writer, as other processes and threads may cache the same model.
+    static std::atomic<unsigned> writes{0};
+    std::string temporary = cachePath + ".tmp" + std::to_string(getpid()) + "-" + std::to_string(writes++);
+    {
+        std::ofstream file{temporary, std::ios::binary};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (int i = 0; i < 5; i++) {
+            file.write(sections.data[i], sections.size[i]);
+        }
+        if (!file) {
+            std::filesystem::remove(temporary);
+            throw std::runtime_error("error: cannot write " + cachePath);
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, cachePath, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("error: cannot write " + cachePath);
+    }
+}
+
+std::optional<Geometry> readMeshCache(const std::string &cachePath, const std::string &sourcePath, unsigned threads) {
+    trace::Scope scope{"cache"};
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error) || !std::filesystem::exists(sourcePath, error)) {
+        return std::nullopt;
+    }
+
+    // A cache that cannot be mapped is rebuilt like any other unusable one.
+    std::optional<MappedFile> mapped;
+    try {
+        mapped.emplace(cachePath);
+    } catch (const std::runtime_error &) {
+        return std::nullopt;
+    }
+    const MappedFile &file = *mapped;
+    if (file.size() < sizeof(Header)) return std::nullopt;
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version
+            || header.headerSize != sizeof(Header) || header.faceCount == 0) {
+        return std::nullopt;
+    }
+
+    const uint64_t V = header.vertexCount, F = header.faceCount, E = header.edgeCount;
+    if (V > INT32_MAX || F > INT32_MAX / 3 || E > 3 * F) return std::nullopt;
+    if (file.size() != sizeof(Header) + 24 * V + 36 * F + 4 * E) return std::nullopt;
+
+    SourceFingerprint source = SourceFingerprint::of(sourcePath);
+    if (!(source == SourceFingerprint{header.sourceSize, header.sourceModified, header.sourceHash})) {
+        return std::nullopt;
+    }
+
+    const char *p = file.data() + sizeof(Header);
+    Sections sections{{p, p + 24 * V, p + 24 * V + 12 * F, p + 24 * V + 24 * F, p + 24 * V + 36 * F},
+                      {24 * V, 12 * F, 12 * F, 12 * F, 4 * E}};
+    if (sections.checksum() != header.checksum) return std::nullopt;
+
+    std::vector<Geometry::Point> positions(V);
+    std::vector<std::array<int, 3>> faces(F);
+    Connectivity connectivity;
+    connectivity.twins.resize(3 * F);
+    connectivity.edges.resize(3 * F);
+    connectivity.edgeHalfedges.resize(E);
+    std::memcpy(positions.data(), sections.data[0], sections.size[0]);
+    std::memcpy(faces.data(), sections.data[1], sections.size[1]);
+    std::memcpy(connectivity.twins.data(), sections.data[2], sections.size[2]);
+    std::memcpy(connectivity.edges.data(), sections.data[3], sections.size[3]);
+    std::memcpy(connectivity.edgeHalfedges.data(), sections.data[4], sections.size[4]);
+
+    // The checksum only detects damage, so the indices are range checked
+    // before they are turned into pointers.
+    for (auto &face: faces) {
+        for (int v: face) {
+            if (v < 0 || uint64_t(v) >= V) return std::nullopt;
+        }
+    }
+    for (size_t h = 0; h < 3 * F; h++) {
+        uint32_t twin = connectivity.twins[h];
+        if ((twin != Connectivity::invalid && twin >= 3 * F) || connectivity.edges[h] >= E) return std::nullopt;
+    }
+    for (uint32_t h: connectivity.edgeHalfedges) {
+        if (h >= 3 * F) return std::nullopt;
+    }
+
+    return Geometry{std::move(positions), faces, connectivity, threads};
+}
+
+Geometry loadGeometry(const std::string &path, unsigned threads, bool useCache) {
+    std::string extension = fileExtension(path);
+    if (extension != ".obj" && extension != ".stl") {
+        throw std::runtime_error("error: input file does not have 'obj' or 'stl' extension");
+    }
+
+    const std::string cachePath = path + ".hemc";
+    if (useCache) {
+        if (auto cached = readMeshCache(cachePath, path, threads)) {
+            return std::move(*cached);
+        }
+    }
+
+    MeshData data = extension == ".obj" ? readOBJ(path, threads) : readSTL(path);
+    Geometry geometry{std::move(data.positions), data.faces, threads};
+
+    if (useCache) {
+        try {
+            writeMeshCache(cachePath, geometry, path);
+        } catch (const std::exception &e) {
+            std::cout << "warning: cannot cache mesh: " << e.what() << std::endl;
+        }
+    }
+    return geometry;
+}
@@ -0,0 +1,275 @@
+#include <ObjReader.h>
+#include <MappedFile.h>
+#include <Parallel.h>
+#include <Trace.h>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <set>
+
+namespace {
+
+// The parsed contents of one line-aligned chunk. Vertex references are
+// stored zero-based and absolute, except for negative references, which
+// can only be resolved once the number of vertices in earlier chunks is
+// known; those are stored relative to the start of the chunk and listed in
+// `relative`.
+struct Chunk {
+    std::vector<Geometry::Point> positions;
+    std::vector<std::array<int, 3>> faces;
+    std::vector<size_t> relative;
+    std::set<std::string> unknown;
+};
+
+[[noreturn]] void invalid() {
+    throw std::runtime_error("invalid obj file");
+}
+
+bool blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skipBlanks(const char *p, const char *end) {
+    while (p < end && blank(*p)) p++;
+    return p;
+}
+
+const char* skipLine(const char *p, const char *end) {
+    const void *newline = std::memchr(p, '\n', end - p);
+    return newline ? static_cast<const char*>(newline) + 1 : end;
+}
+
+// Parses a decimal number. Numbers with at most 15 significant digits and a
+// decimal exponent within [-22, 22], which covers almost every OBJ file,
+// are assembled directly: both the integer mantissa and the power of ten are
+// exact doubles, so a single multiplication or division rounds correctly
+// (Clinger's fast path). Everything else falls back to std::from_chars.
+const char* parseDouble(const char *p, const char *end, double &value) {
+    static constexpr double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+') p++;
+    const char *start = p;
+
+    bool negative = p < end && *p == '-';
+    if (negative) p++;
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    const char *first = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (mantissa != 0 || *p != '0') digits++;
+        mantissa = 10 * mantissa + (*p++ - '0');
+    }
+    bool integral = p != first;
+    if (p < end && *p == '.') {
+        first = ++p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (mantissa != 0 || *p != '0') digits++;
+            mantissa = 10 * mantissa + (*p++ - '0');
+            exponent--;
+        }
+        integral = integral || p != first;
+    }
+    if (integral && p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negativeExponent = q < end && *q == '-';
+        if (q < end && (*q == '-' || *q == '+')) q++;
+        int e = 0;
+        first = q;
+        while (q < end && *q >= '0' && *q <= '9' && e < 10000) {
+            e = 10 * e + (*q++ - '0');
+        }
+        if (q != first) {
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    if (integral && digits <= 15 && exponent >= -22 && exponent <= 22) {
+        value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+        if (negative) value = -value;
+        return p;
+    }
+
+    auto [next, error] = std::from_chars(start, end, value);
+    if (error != std::errc{}) invalid();
+    return next;
+}
+
+// Parses a vertex reference of the form v, v/vt, v//vn or v/vt/vn and
+// returns v, which is negative for relative references.
+const char* parseReference(const char *p, const char *end, int &index) {
+    bool negative = p < end && *p == '-';
+    if (negative) p++;
+
+    const char *first = p;
+    int64_t value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = 10 * value + (*p++ - '0');
+        if (value > INT_MAX) invalid();
+    }
+    if (p == first || value == 0) invalid();
+    index = negative ? -int(value) : int(value);
+
+    // Texture and normal references are not needed.
+    if (p < end && *p == '/') {
+        while (p < end && (*p == '/' || *p == '-' || (*p >= '0' && *p <= '9'))) p++;
+    }
+    return p;
+}
+
+void parseChunk(const char *p, const char *end, Chunk &chunk) {
+    // Reused across lines, so a face line stops allocating once this has
+    // grown to the largest polygon in the chunk.
+    std::vector<int> polygon;
+
+    while (p < end) {
+        p = skipBlanks(p, end);
+        if (p == end) break;
+        if (*p == '\n' || *p == '#') {
+            p = skipLine(p, end);
+            continue;
+        }
+
+        const char *word = p;
+        while (p < end && !blank(*p) && *p != '\n') p++;
+        std::string_view directive{word, static_cast<size_t>(p - word)};
+
+        if (directive == "v") {
+            Geometry::Point r;
+            p = parseDouble(p, end, r[0]);
+            p = parseDouble(p, end, r[1]);
+            p = parseDouble(p, end, r[2]);
+            chunk.positions.push_back(r);
+        } else if (directive == "f") {
+            polygon.clear();
+            while (true) {
+                p = skipBlanks(p, end);
+                if (p == end || *p == '\n' || *p == '#') break;
+                int index;
+                p = parseReference(p, end, index);
+                polygon.push_back(index);
+            }
+
+            if (polygon.size() < 3) invalid();
+
+            // Triangulate as a fan around the first vertex.
+            const int count = chunk.positions.size();
+            for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                size_t face = chunk.faces.size();
+                int corners[3] = {polygon[0], polygon[i], polygon[i + 1]};
+                std::array<int, 3> resolved;
+                for (int j = 0; j < 3; j++) {
+                    if (corners[j] > 0) {
+                        resolved[j] = corners[j] - 1;
+                    } else {
+                        resolved[j] = count + corners[j];
+                        chunk.relative.push_back(3 * face + j);
+                    }
+                }
+                chunk.faces.push_back(resolved);
+            }
+        } else if (directive == "vp") {
+            throw std::runtime_error("free-form geometry not supported");
+        } else if (directive == "l") {
+            throw std::runtime_error("line elements not supported");
+        } else if (directive != "vt" && directive != "vn" && directive != "g" && directive != "o"
+                && directive != "s" && directive != "usemtl" && directive != "mtllib") {
+            chunk.unknown.emplace(directive);
+        }
+
+        p = skipLine(p, end);
+    }
+}
+
+}
+
+MeshData parseOBJ(std::string_view text, unsigned threads, unsigned chunks) {
+    trace::Scope scope{"parse"};
+    if (threads == 0) threads = hardwareThreads();
+    if (chunks == 0) chunks = threads;
+
+    // Split the text into chunks that begin at the start of a line.
+    std::vector<const char*> bounds{text.data()};
+    const char *end = text.data() + text.size();
+    for (unsigned c = 1; c < chunks; c++) {
+        const char *p = std::max(bounds.back(), text.data() + text.size() * c / chunks);
+        if (p > text.data() && p < end && p[-1] != '\n') p = skipLine(p, end);
+        bounds.push_back(p);
+    }
+    bounds.push_back(end);
+
+    std::vector<Chunk> parsed(chunks);
+    parallelFor(chunks, threads, 1, [&](size_t begin, size_t last, unsigned) {
+        for (size_t c = begin; c < last; c++) {
+            parseChunk(bounds[c], bounds[c + 1], parsed[c]);
+        }
+    });
+
+    // Merge the chunks in order, resolving negative references against the
+    // number of vertices that precede each chunk.
+    std::vector<size_t> vertexOffsets{0}, faceOffsets{0};
+    for (auto &chunk: parsed) {
+        vertexOffsets.push_back(vertexOffsets.back() + chunk.positions.size());
+        faceOffsets.push_back(faceOffsets.back() + chunk.faces.size());
+    }
+
+    MeshData data;
+    if (chunks == 1) {
+        data.positions = std::move(parsed[0].positions);
+        data.faces = std::move(parsed[0].faces);
+    } else {
+        data.positions.resize(vertexOffsets.back());
+        data.faces.resize(faceOffsets.back());
+        parallelFor(chunks, threads, 1, [&](size_t begin, size_t last, unsigned) {
+            for (size_t c = begin; c < last; c++) {
+                auto &chunk = parsed[c];
+                for (size_t i: chunk.relative) {
+                    chunk.faces[i / 3][i % 3] += vertexOffsets[c];
+                }
+                std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + vertexOffsets[c]);
+                std::copy(chunk.faces.begin(), chunk.faces.end(), data.faces.begin() + faceOffsets[c]);
+            }
+        });
+    }
+    const int vertexCount = data.positions.size();
+
+    for (auto &face: data.faces) {
+        for (int v: face) {
+            if (v < 0 || v >= vertexCount) invalid();
+        }
+    }
+
+    std::set<std::string> unknown;
+    for (auto &chunk: parsed) {
+        unknown.insert(chunk.unknown.begin(), chunk.unknown.end());
+    }
+    for (auto &directive: unknown) {
+        std::cout << "warning: unknown directive: " << directive << std::endl;
+    }
+
+    return data;
+}
+
+MeshData readOBJ(const std::string &path, unsigned threads) {
+    MappedFile file{path};
+
+    // Parallel parsing only pays off once each worker has a few megabytes.
+    if (threads == 0) threads = hardwareThreads();
+    threads = std::max<size_t>(1, std::min<size_t>(threads, file.size() >> 22));
+    MeshData data = parseOBJ(file.view(), threads);
+    if (data.faces.empty()) {
+        throw std::runtime_error("error: no triangles in " + path);
+    }
+    return data;
+}
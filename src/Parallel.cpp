@@ -0,0 +1,146 @@
+#include <Parallel.h>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <exception>
+
+unsigned hardwareThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+namespace {
+
+struct Block {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+}
+
+void parallelFor(size_t count, unsigned threads, size_t grain, const RangeFunction &fn) {
+    if (threads == 0) threads = hardwareThreads();
+    grain = std::max<size_t>(grain, 1);
+    threads = std::max<size_t>(1, std::min<size_t>(threads, (count + grain - 1) / grain));
+
+    if (threads == 1) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            fn(begin, std::min(begin + grain, count), 0);
+        }
+        return;
+    }
+
+    std::vector<Block> blocks(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        blocks[i].begin = count * i / threads;
+        blocks[i].end = count * (i + 1) / threads;
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto work = [&](unsigned worker) {
+        Block &own = blocks[worker];
+        while (true) {
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock{own.mutex};
+                begin = own.begin;
+                end = std::min(own.begin + grain, own.end);
+                own.begin = end;
+            }
+
+            if (begin < end) {
+                try {
+                    fn(begin, end, worker);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock{errorMutex};
+                    if (!error) error = std::current_exception();
+                }
+                continue;
+            }
+
+            // Steal the back half of the next block that still has work. The
+            // front half stays with its owner, who consumes it from the front,
+            // so the two never contend for the same chunk. Stolen work is
+            // installed as this worker's own block so that it can in turn
+            // be stolen from.
+            bool stolen = false;
+            for (unsigned offset = 1; offset < threads && !stolen; offset++) {
+                Block &victim = blocks[(worker + offset) % threads];
+                std::scoped_lock lock{victim.mutex, own.mutex};
+                if (victim.begin < victim.end) {
+                    size_t middle = victim.begin + (victim.end - victim.begin) / 2;
+                    own.begin = middle;
+                    own.end = victim.end;
+                    victim.end = middle;
+                    stolen = true;
+                }
+            }
+            if (!stolen) return;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back(work, i);
+    }
+    work(0);
+    for (auto &thread: pool) {
+        thread.join();
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
+ThreadPool::ThreadPool(unsigned threads, size_t capacity): capacity_{std::max<size_t>(capacity, 1)} {
+    if (threads == 0) threads = hardwareThreads();
+    for (unsigned i = 0; i < threads; i++) {
+        threads_.emplace_back([this]() { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    for (auto &thread: threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    changed_.wait(lock, [&]() { return queue_.size() < capacity_; });
+    queue_.push_back(std::move(task));
+    changed_.notify_all();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    changed_.wait(lock, [&]() { return queue_.empty() && running_ == 0; });
+}
+
+void ThreadPool::run() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+        changed_.wait(lock, [&]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+
+        std::function<void()> task = std::move(queue_.front());
+        queue_.pop_front();
+        running_++;
+        changed_.notify_all();
+
+        lock.unlock();
+        task();
+        lock.lock();
+        running_--;
+        changed_.notify_all();
+    }
+}
@@ -0,0 +1,707 @@
+#include <PolygonClipper.h>
+#include <Parallel.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+using Wide = __int128;
+
+int sign(Wide v) {
+    return (v > 0) - (v < 0);
+}
+
+Wide cross(const IntPoint &u, const IntPoint &v) {
+    return Wide(u[0]) * v[1] - Wide(u[1]) * v[0];
+}
+
+IntPoint difference(const IntPoint &a, const IntPoint &b) {
+    return {a[0] - b[0], a[1] - b[1]};
+}
+
+// Positive when c lies to the left of the line from a to b.
+int orient(const IntPoint &a, const IntPoint &b, const IntPoint &c) {
+    return sign(cross(difference(b, a), difference(c, a)));
+}
+
+Wide floorDiv(Wide n, Wide d) {
+    assert(d > 0);
+    Wide q = n / d;
+    return q - (n % d != 0 && n < 0);
+}
+
+// The pixel containing n / d: the nearest integer, rounding halves up, so
+// that every point lies in exactly one of the half-open pixels
+// [x - 1/2, x + 1/2).
+int64_t roundDiv(Wide n, Wide d) {
+    if (d < 0) n = -n, d = -d;
+    return floorDiv(2 * n + d, 2 * d);
+}
+
+// A bound on a segment parameter, n / d with d > 0.
+struct Bound {
+    Wide n, d;
+    bool open;
+};
+
+int compare(const Bound &a, const Bound &b) {
+    return sign(a.n * b.d - b.n * a.d);
+}
+
+// Whether the segment from a to b passes through the half-open pixel
+// centered on h, and the parameter at which it enters. Coordinates are
+// doubled so that the pixel edges fall on integers.
+bool throughPixel(const IntPoint &a, const IntPoint &b, const IntPoint &h, Bound &enter) {
+    Bound lo{0, 1, false}, hi{1, 1, false};
+    for (int axis = 0; axis < 2; axis++) {
+        const Wide p = 2 * Wide(a[axis]), d = 2 * (Wide(b[axis]) - a[axis]);
+        const Wide left = 2 * Wide(h[axis]) - 1, right = 2 * Wide(h[axis]) + 1;
+        Bound lower, upper;
+        if (d == 0) {
+            if (p < left || p >= right) return false;
+            continue;
+        } else if (d > 0) {
+            lower = {left - p, d, false};
+            upper = {right - p, d, true};
+        } else {
+            lower = {p - right, -d, true};
+            upper = {p - left, -d, false};
+        }
+        int c = compare(lower, lo);
+        if (c > 0 || (c == 0 && lower.open)) lo = lower;
+        c = compare(upper, hi);
+        if (c < 0 || (c == 0 && upper.open)) hi = upper;
+    }
+    int c = compare(lo, hi);
+    if (c > 0 || (c == 0 && (lo.open || hi.open))) return false;
+    enter = lo;
+    return true;
+}
+
+// Whether h lies on the segment from a to b, other than at its ends.
+bool insideSegment(const IntPoint &a, const IntPoint &b, const IntPoint &h) {
+    if (h == a || h == b || orient(a, b, h) != 0) return false;
+    return std::min(a[0], b[0]) <= h[0] && h[0] <= std::max(a[0], b[0]) &&
+           std::min(a[1], b[1]) <= h[1] && h[1] <= std::max(a[1], b[1]);
+}
+
+bool filled(int winding, FillRule rule) {
+    switch (rule) {
+    case FillRule::EvenOdd: return winding & 1;
+    case FillRule::NonZero: return winding != 0;
+    case FillRule::Positive: return winding > 0;
+    case FillRule::Negative: return winding < 0;
+    }
+    return false;
+}
+
+bool inside(ClipType op, FillRule rule, const int winding[2]) {
+    bool subject = filled(winding[0], rule), clip = filled(winding[1], rule);
+    switch (op) {
+    case ClipType::Union: return subject || clip;
+    case ClipType::Intersection: return subject && clip;
+    case ClipType::Difference: return subject && !clip;
+    case ClipType::Xor: return subject != clip;
+    }
+    return false;
+}
+
+// Drops vertices in line with their neighbours, including spikes.
+void removeCollinear(IntPolygon &polygon) {
+    size_t n = 0;
+    for (const IntPoint &p: polygon) {
+        polygon[n++] = p;
+        while (n >= 3 && orient(polygon[n - 3], polygon[n - 2], polygon[n - 1]) == 0) {
+            polygon[n - 2] = polygon[n - 1];
+            n--;
+        }
+    }
+    polygon.resize(n);
+    size_t first = 0;
+    while (polygon.size() - first >= 3) {
+        size_t last = polygon.size() - 1;
+        if (orient(polygon[last - 1], polygon[last], polygon[first]) == 0) {
+            polygon.pop_back();
+        } else if (orient(polygon[last], polygon[first], polygon[first + 1]) == 0) {
+            first++;
+        } else {
+            break;
+        }
+    }
+    polygon.erase(polygon.begin(), polygon.begin() + first);
+    if (polygon.size() < 3) polygon.clear();
+}
+
+IntPoint toInt(double x, double y) {
+    if (!(std::abs(x) < maxClipCoordinate && std::abs(y) < maxClipCoordinate)) {
+        throw std::runtime_error("error: polygon coordinates out of range");
+    }
+    return {std::llround(x), std::llround(y)};
+}
+
+}
+
+IntPolygons toIntPolygons(const Slicer::Polygons &polygons, double scale) {
+    IntPolygons result;
+    result.reserve(polygons.size());
+    for (const Slicer::Polygon &polygon: polygons) {
+        IntPolygon p;
+        p.reserve(polygon.size());
+        for (const Slicer::Point &point: polygon) {
+            IntPoint q = toInt(point[0] * scale, point[1] * scale);
+            if (p.empty() || q != p.back()) p.push_back(q);
+        }
+        while (p.size() > 1 && p.back() == p.front()) p.pop_back();
+        if (p.size() >= 3) result.push_back(std::move(p));
+    }
+    return result;
+}
+
+Slicer::Polygons toPolygons(const IntPolygons &polygons, double scale) {
+    Slicer::Polygons result(polygons.size());
+    for (size_t i = 0; i < polygons.size(); i++) {
+        Slicer::Polygon &polygon = result[i];
+        polygon.reserve(polygons[i].size() + 1);
+        for (const IntPoint &p: polygons[i]) polygon.push_back({p[0] / scale, p[1] / scale});
+        if (!polygon.empty()) polygon.push_back(polygon.front());
+    }
+    return result;
+}
+
+double area(const IntPolygon &polygon) {
+    if (polygon.empty()) return 0;
+    Wide twice = 0;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        twice += cross(polygon[j], polygon[i]);
+    }
+    return double(twice) / 2;
+}
+
+void PolygonClipper::addSegments(const IntPolygons &polygons, uint8_t operand) {
+    for (const IntPolygon &polygon: polygons) {
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const IntPoint &p = polygon[i];
+            if (std::abs(p[0]) >= maxClipCoordinate || std::abs(p[1]) >= maxClipCoordinate) {
+                throw std::runtime_error("error: polygon coordinates out of range");
+            }
+            if (polygon[j] != polygon[i]) segments_.push_back({polygon[j], polygon[i], operand});
+        }
+    }
+}
+
+void PolygonClipper::findCrossings() {
+    // Every vertex is a hot pixel.
+    hot_.clear();
+    int64_t ymin = INT64_MAX, ymax = INT64_MIN;
+    for (const Segment &s: segments_) {
+        hot_.push_back(s.a);
+        ymin = std::min(ymin, s.a[1]);
+        ymax = std::max(ymax, s.a[1]);
+    }
+
+    // The plane is cut into horizontal bands, each segment is listed in
+    // every band it spans, and each band is swept on its own, so that the
+    // active list holds only the segments near the sweep line in both x
+    // and y. A crossing found in two bands is found twice.
+    const int64_t bands = std::clamp<int64_t>(std::sqrt(double(segments_.size())) / 2, 1, 1024);
+    const int64_t height = (ymax - ymin) / bands + 1;
+    auto left = [&](uint32_t i) { return std::min(segments_[i].a[0], segments_[i].b[0]); };
+    auto right = [&](uint32_t i) { return std::max(segments_[i].a[0], segments_[i].b[0]); };
+    std::vector<std::pair<int64_t, uint32_t>> order;
+    std::vector<uint32_t> offsets(bands + 1, 0);
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        if (pass == 1) order.resize(offsets.back());
+        for (uint32_t i = 0; i < segments_.size(); i++) {
+            const Segment &s = segments_[i];
+            const int64_t b0 = (std::min(s.a[1], s.b[1]) - ymin) / height;
+            const int64_t b1 = (std::max(s.a[1], s.b[1]) - ymin) / height;
+            for (int64_t b = b0; b <= b1; b++) {
+                if (pass == 0) offsets[b + 1]++;
+                else order[cursor[b]++] = {left(i), i};
+            }
+        }
+        if (pass == 0) {
+            for (int64_t b = 0; b < bands; b++) offsets[b + 1] += offsets[b];
+        }
+    }
+
+    // Sweep each band left to right over the left ends of its segments,
+    // testing each against the active segments whose y-range it overlaps.
+    // Segments leave the active list only when the sweep passes the
+    // nearest right end.
+    std::vector<uint32_t> &active = status_;
+    for (int64_t b = 0; b < bands; b++) {
+        std::sort(order.begin() + offsets[b], order.begin() + offsets[b + 1]);
+        active.clear();
+        int64_t expiry = INT64_MAX;
+        for (uint32_t k = offsets[b]; k < offsets[b + 1]; k++) {
+            const auto [x, i] = order[k];
+            const Segment &s = segments_[i];
+            if (x > expiry) {
+                expiry = INT64_MAX;
+                size_t n = 0;
+                for (uint32_t j: active) {
+                    if (right(j) < x) continue;
+                    active[n++] = j;
+                    expiry = std::min(expiry, right(j));
+                }
+                active.resize(n);
+            }
+
+            const int64_t ylo = std::min(s.a[1], s.b[1]), yhi = std::max(s.a[1], s.b[1]);
+            for (uint32_t j: active) {
+                const Segment &t = segments_[j];
+                if (std::max(t.a[1], t.b[1]) < ylo || std::min(t.a[1], t.b[1]) > yhi) continue;
+
+                // Only proper crossings add hot pixels: where segments touch,
+                // the point of contact is already a vertex.
+                if (orient(s.a, s.b, t.a) * orient(s.a, s.b, t.b) >= 0) continue;
+                if (orient(t.a, t.b, s.a) * orient(t.a, t.b, s.b) >= 0) continue;
+                const IntPoint u = difference(s.b, s.a), v = difference(t.b, t.a);
+                const Wide n = cross(difference(t.a, s.a), v), d = cross(u, v);
+                hot_.push_back({roundDiv(Wide(s.a[0]) * d + Wide(u[0]) * n, d),
+                                roundDiv(Wide(s.a[1]) * d + Wide(u[1]) * n, d)});
+            }
+            active.push_back(i);
+            expiry = std::min(expiry, right(i));
+        }
+    }
+
+    std::sort(hot_.begin(), hot_.end());
+    hot_.erase(std::unique(hot_.begin(), hot_.end()), hot_.end());
+}
+
+void PolygonClipper::buildGrid() {
+    IntPoint lo = hot_.front(), hi = lo;
+    for (const IntPoint &p: hot_) {
+        lo[1] = std::min(lo[1], p[1]);
+        hi[1] = std::max(hi[1], p[1]);
+    }
+    hi[0] = hot_.back()[0];
+
+    // About one hot pixel per cell.
+    const int64_t cells = std::clamp<int64_t>(std::sqrt(double(hot_.size())), 1, 1024);
+    const int64_t extent = std::max(hi[0] - lo[0], hi[1] - lo[1]) + 1;
+    gridOrigin_ = lo;
+    cellSize_ = (extent + cells - 1) / cells;
+    gridWidth_ = (hi[0] - lo[0]) / cellSize_ + 1;
+    gridHeight_ = (hi[1] - lo[1]) / cellSize_ + 1;
+
+    auto cell = [&](const IntPoint &p) {
+        return ((p[1] - lo[1]) / cellSize_) * gridWidth_ + (p[0] - lo[0]) / cellSize_;
+    };
+    cellOffsets_.assign(gridWidth_ * gridHeight_ + 1, 0);
+    for (const IntPoint &p: hot_) cellOffsets_[cell(p) + 1]++;
+    for (size_t c = 1; c < cellOffsets_.size(); c++) cellOffsets_[c] += cellOffsets_[c - 1];
+    cells_.resize(hot_.size());
+    std::vector<uint32_t> cursor(cellOffsets_.begin(), cellOffsets_.end() - 1);
+    for (const IntPoint &p: hot_) cells_[cursor[cell(p)]++] = p;
+}
+
+// Calls visit(h) for every hot pixel h whose cell the segment from a to b
+// passes near: for each column of cells the segment spans, the rows within
+// a pixel of its y-range in that column.
+template <typename F>
+void PolygonClipper::visitHotPixels(const IntPoint &a, const IntPoint &b, F &&visit) const {
+    const double xlo = std::min(a[0], b[0]), xhi = std::max(a[0], b[0]);
+    const double ylo = std::min(a[1], b[1]), yhi = std::max(a[1], b[1]);
+    auto column = [&](double x) {
+        return std::clamp<int64_t>(std::floor((x - gridOrigin_[0]) / cellSize_), 0, gridWidth_ - 1);
+    };
+    auto row = [&](double y) {
+        return std::clamp<int64_t>(std::floor((y - gridOrigin_[1]) / cellSize_), 0, gridHeight_ - 1);
+    };
+
+    const double slope = a[0] == b[0] ? 0 : double(b[1] - a[1]) / (b[0] - a[0]);
+    for (int64_t cx = column(xlo - 1), cx1 = column(xhi + 1); cx <= cx1; cx++) {
+        double y0 = ylo, y1 = yhi;
+        if (a[0] != b[0]) {
+            double x0 = std::max(xlo, double(gridOrigin_[0] + cx * cellSize_) - 1);
+            double x1 = std::min(xhi, double(gridOrigin_[0] + (cx + 1) * cellSize_) + 1);
+            y0 = a[1] + slope * (x0 - a[0]);
+            y1 = a[1] + slope * (x1 - a[0]);
+            if (y0 > y1) std::swap(y0, y1);
+        }
+        for (int64_t cy = row(y0 - 2), cy1 = row(y1 + 2); cy <= cy1; cy++) {
+            const size_t c = cy * gridWidth_ + cx;
+            for (uint32_t k = cellOffsets_[c]; k < cellOffsets_[c + 1]; k++) visit(cells_[k]);
+        }
+    }
+}
+
+void PolygonClipper::snapSegments() {
+    buildGrid();
+
+    // Reroute each segment through the centers of the hot pixels it passes
+    // through, in the order it enters them.
+    std::vector<std::pair<Bound, IntPoint>> through;
+    std::vector<IntPoint> on;
+    edges_.clear();
+    auto addEdge = [&](const IntPoint &p, const IntPoint &q, uint8_t operand) {
+        Edge edge{};
+        const bool forward = p < q;
+        edge.lo = forward ? p : q;
+        edge.hi = forward ? q : p;
+        edge.delta[operand] = forward ? 1 : -1;
+        edges_.push_back(edge);
+    };
+
+    for (const Segment &s: segments_) {
+        through.clear();
+        visitHotPixels(s.a, s.b, [&](const IntPoint &h) {
+            Bound enter;
+            if (throughPixel(s.a, s.b, h, enter)) through.push_back({enter, h});
+        });
+        std::sort(through.begin(), through.end(), [](const auto &x, const auto &y) {
+            int c = compare(x.first, y.first);
+            return c < 0 || (c == 0 && !x.first.open && y.first.open);
+        });
+
+        for (size_t k = 1; k < through.size(); k++) {
+            const IntPoint &p = through[k - 1].second, &q = through[k].second;
+            if (p == q) continue;
+
+            // A fragment moved by snapping can pass exactly through the
+            // center of a hot pixel that its segment only touched on the
+            // excluded edge; split it there too, so that fragments meet only
+            // at their ends. A segment left in place found those already.
+            if (through.size() == 2 && p == s.a && q == s.b) {
+                addEdge(p, q, s.operand);
+                continue;
+            }
+            on.clear();
+            visitHotPixels(p, q, [&](const IntPoint &h) {
+                if (insideSegment(p, q, h)) on.push_back(h);
+            });
+            if (on.empty()) {
+                addEdge(p, q, s.operand);
+                continue;
+            }
+            const bool forward = p < q;
+            std::sort(on.begin(), on.end(), [&](const IntPoint &x, const IntPoint &y) {
+                return forward ? x < y : y < x;
+            });
+            IntPoint from = p;
+            for (const IntPoint &h: on) {
+                addEdge(from, h, s.operand);
+                from = h;
+            }
+            addEdge(from, q, s.operand);
+        }
+    }
+
+    // Fragments shared by several segments become one edge carrying the
+    // sum of their windings; edges whose windings cancel are dropped.
+    std::sort(edges_.begin(), edges_.end(), [](const Edge &x, const Edge &y) {
+        return x.lo < y.lo || (x.lo == y.lo && x.hi < y.hi);
+    });
+    size_t n = 0;
+    for (size_t i = 0; i < edges_.size();) {
+        Edge edge = edges_[i++];
+        while (i < edges_.size() && edges_[i].lo == edge.lo && edges_[i].hi == edge.hi) {
+            edge.delta[0] += edges_[i].delta[0];
+            edge.delta[1] += edges_[i].delta[1];
+            i++;
+        }
+        if (edge.delta[0] != 0 || edge.delta[1] != 0) edges_[n++] = edge;
+    }
+    edges_.resize(n);
+}
+
+void PolygonClipper::computeWindings() {
+    // The sign of 2 * y - y2, where y is the height of non-vertical edge e
+    // at x.
+    auto compareAt = [](const Edge &e, int64_t x, Wide y2) {
+        const Wide dx = e.hi[0] - e.lo[0], dy = e.hi[1] - e.lo[1];
+        return sign(2 * (Wide(e.lo[1]) * dx + dy * (x - e.lo[0])) - y2 * dx);
+    };
+    auto steeper = [](const Edge &e, const Edge &f) {
+        return cross(difference(e.hi, e.lo), difference(f.hi, f.lo)) < 0;
+    };
+
+    std::vector<uint32_t> sweep, vertical;
+    for (uint32_t i = 0; i < edges_.size(); i++) {
+        (edges_[i].lo[0] == edges_[i].hi[0] ? vertical : sweep).push_back(i);
+    }
+    // Edges are inserted bottom to top at each x, so that an edge's
+    // neighbour below is always in place before it.
+    std::sort(sweep.begin(), sweep.end(), [&](uint32_t i, uint32_t j) {
+        const Edge &e = edges_[i], &f = edges_[j];
+        if (e.lo != f.lo) return e.lo < f.lo;
+        return steeper(f, e);
+    });
+
+    // The status lists the edges that span the sweep line, bottom to top.
+    // Edges meet only at their ends, so the order holds between events.
+    std::vector<uint32_t> &status = status_;
+    status.clear();
+    auto above = [&](int64_t position, int winding[2]) {
+        winding[0] = winding[1] = 0;
+        if (position < 0) return;
+        const Edge &e = edges_[status[position]];
+        winding[0] = e.below[0] + e.delta[0];
+        winding[1] = e.below[1] + e.delta[1];
+    };
+
+    size_t next = 0, nextVertical = 0;
+    int64_t expiry = INT64_MAX;
+    while (next < sweep.size() || nextVertical < vertical.size()) {
+        int64_t x = expiry;
+        if (next < sweep.size()) x = std::min(x, edges_[sweep[next]].lo[0]);
+        if (nextVertical < vertical.size()) x = std::min(x, edges_[vertical[nextVertical]].lo[0]);
+
+        // The region left of a vertical edge is the one above the highest
+        // edge that passes below its midpoint, before the edges ending at x
+        // leave the status.
+        for (; nextVertical < vertical.size() && edges_[vertical[nextVertical]].lo[0] == x; nextVertical++) {
+            Edge &v = edges_[vertical[nextVertical]];
+            const Wide middle = Wide(v.lo[1]) + v.hi[1];
+            auto it = std::partition_point(status.begin(), status.end(), [&](uint32_t i) {
+                return compareAt(edges_[i], x, middle) < 0;
+            });
+            above(it - status.begin() - 1, v.below);
+        }
+
+        if (expiry == x) {
+            expiry = INT64_MAX;
+            size_t n = 0;
+            for (uint32_t i: status) {
+                if (edges_[i].hi[0] == x) continue;
+                status[n++] = i;
+                expiry = std::min(expiry, edges_[i].hi[0]);
+            }
+            status.resize(n);
+        }
+
+        for (; next < sweep.size() && edges_[sweep[next]].lo[0] == x; next++) {
+            Edge &e = edges_[sweep[next]];
+            auto it = std::partition_point(status.begin(), status.end(), [&](uint32_t i) {
+                int c = compareAt(edges_[i], x, 2 * Wide(e.lo[1]));
+                return c < 0 || (c == 0 && steeper(e, edges_[i]));
+            });
+            above(it - status.begin() - 1, e.below);
+            status.insert(it, sweep[next]);
+            expiry = std::min(expiry, e.hi[0]);
+        }
+    }
+}
+
+void PolygonClipper::linkPolygons(ClipType op, FillRule rule, IntPolygons &result) {
+    // Keep the edges with the result on one side only, directed so that it
+    // lies on their left.
+    struct Directed {
+        IntPoint from, to;
+    };
+    std::vector<Directed> out;
+    for (const Edge &e: edges_) {
+        const int after[2] = {e.below[0] + e.delta[0], e.below[1] + e.delta[1]};
+        const int before[2] = {e.below[0] - e.delta[0], e.below[1] - e.delta[1]};
+        if (e.lo[0] != e.hi[0]) {
+            const bool below = inside(op, rule, e.below), above = inside(op, rule, after);
+            if (below == above) continue;
+            out.push_back(above ? Directed{e.lo, e.hi} : Directed{e.hi, e.lo});
+        } else {
+            const bool left = inside(op, rule, e.below), right = inside(op, rule, before);
+            if (left == right) continue;
+            out.push_back(left ? Directed{e.lo, e.hi} : Directed{e.hi, e.lo});
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const Directed &x, const Directed &y) {
+        return x.from < y.from || (x.from == y.from && x.to < y.to);
+    });
+
+    // Where several boundaries meet at a vertex, turn as far left as
+    // possible, which traces the boundary of each face of the result on
+    // its own and keeps polygons that touch at a corner apart.
+    auto successor = [&](size_t e) {
+        const IntPoint &v = out[e].to;
+        const IntPoint d = difference(v, out[e].from);
+        auto first = std::lower_bound(out.begin(), out.end(), v, [](const Directed &x, const IntPoint &p) {
+            return x.from < p;
+        });
+        assert(first != out.end() && first->from == v);
+        size_t best = first - out.begin();
+        auto upper = [&](const IntPoint &w) {
+            Wide c = cross(d, w);
+            return c > 0 || (c == 0 && Wide(d[0]) * w[0] + Wide(d[1]) * w[1] < 0);
+        };
+        for (auto it = first + 1; it != out.end() && it->from == v; it++) {
+            const IntPoint w = difference(it->to, v), b = difference(out[best].to, v);
+            const bool uw = upper(w), ub = upper(b);
+            if ((uw && !ub) || (uw == ub && cross(b, w) > 0)) best = it - out.begin();
+        }
+        return best;
+    };
+
+    result.clear();
+    std::vector<bool> used(out.size(), false);
+    for (size_t start = 0; start < out.size(); start++) {
+        if (used[start]) continue;
+        IntPolygon polygon;
+        size_t e = start;
+        do {
+            used[e] = true;
+            polygon.push_back(out[e].from);
+            e = successor(e);
+        } while (e != start && !used[e]);
+        removeCollinear(polygon);
+        if (!polygon.empty()) result.push_back(std::move(polygon));
+    }
+}
+
+void PolygonClipper::execute(ClipType op, const IntPolygons &subject, const IntPolygons &clip, FillRule rule,
+                             IntPolygons &result) {
+    segments_.clear();
+    addSegments(subject, 0);
+    addSegments(clip, 1);
+    result.clear();
+    if (segments_.empty()) return;
+
+    findCrossings();
+    snapSegments();
+    computeWindings();
+    linkPolygons(op, rule, result);
+}
+
+void PolygonClipper::offsetPolygon(const IntPolygon &polygon, double delta, const OffsetSettings &settings,
+                                   IntPolygon &result) const {
+    using Vector = std::array<double, 2>;
+    const size_t n = polygon.size();
+    result.clear();
+    if (n < 3) return;
+
+    // The unit direction of each edge and its normal to the right, which
+    // points away from the region the polygon bounds.
+    std::vector<Vector> directions(n), normals(n);
+    for (size_t i = 0; i < n; i++) {
+        const IntPoint &a = polygon[i], &b = polygon[(i + 1) % n];
+        double dx = b[0] - a[0], dy = b[1] - a[1], length = std::hypot(dx, dy);
+        directions[i] = {dx / length, dy / length};
+        normals[i] = {dy / length, -dx / length};
+    }
+
+    // The widest angle one step of an arc may turn through while staying
+    // within the tolerance of the true arc.
+    const double tolerance = std::min(std::abs(delta), std::max(settings.arcTolerance * settings.scale, 0.25));
+    const double step = std::min(M_PI / 2, 2 * std::acos(1 - tolerance / std::abs(delta)));
+    const double limit = settings.miterLimit > 1 ? 2 / (settings.miterLimit * settings.miterLimit) : 2;
+
+    auto add = [&](const IntPoint &p, double x, double y) {
+        result.push_back(toInt(p[0] + x, p[1] + y));
+    };
+    for (size_t i = 0; i < n; i++) {
+        const IntPoint &p = polygon[i];
+        const Vector &n1 = normals[(i + n - 1) % n], &n2 = normals[i];
+        const Vector &u1 = directions[(i + n - 1) % n], &u2 = directions[i];
+        const double sin = n1[0] * n2[1] - n1[1] * n2[0], cos = n1[0] * n2[0] + n1[1] * n2[1];
+
+        if (cos > 1 - 1e-12) {
+            add(p, delta * n2[0], delta * n2[1]);
+            continue;
+        }
+        if (sin * delta < 0 && cos > -1 + 1e-12) {
+            // The offset edges overlap here. Passing back through the corner
+            // keeps the winding of the loop they form from counting.
+            add(p, delta * n1[0], delta * n1[1]);
+            result.push_back(p);
+            add(p, delta * n2[0], delta * n2[1]);
+            continue;
+        }
+
+        JoinType join = settings.join;
+        if (join == JoinType::Miter) {
+            if (1 + cos >= limit) {
+                const double k = delta / (1 + cos);
+                add(p, (n1[0] + n2[0]) * k, (n1[1] + n2[1]) * k);
+                continue;
+            }
+            join = JoinType::Square;
+        }
+        if (join == JoinType::Square) {
+            // Cut the corner square to the bisector at distance delta, or cap
+            // an edge that turns straight back a distance delta beyond it.
+            Vector m = {n1[0] + n2[0], n1[1] + n2[1]};
+            double length = std::hypot(m[0], m[1]);
+            if (length < 1e-9) {
+                const double reach = std::abs(delta);
+                add(p, delta * n1[0] + reach * u1[0], delta * n1[1] + reach * u1[1]);
+                add(p, delta * n2[0] + reach * u1[0], delta * n2[1] + reach * u1[1]);
+                continue;
+            }
+            m = {m[0] / length, m[1] / length};
+            const double s1 = delta * (1 - (n1[0] * m[0] + n1[1] * m[1])) / (u1[0] * m[0] + u1[1] * m[1]);
+            const double s2 = delta * (1 - (n2[0] * m[0] + n2[1] * m[1])) / (u2[0] * m[0] + u2[1] * m[1]);
+            add(p, delta * n1[0] + s1 * u1[0], delta * n1[1] + s1 * u1[1]);
+            add(p, delta * n2[0] + s2 * u2[0], delta * n2[1] + s2 * u2[1]);
+            continue;
+        }
+
+        double angle = std::atan2(sin, cos);
+        if (angle * delta < 0) angle = -angle;
+        const int steps = std::max(1, int(std::ceil(std::abs(angle) / step)));
+        for (int k = 0; k <= steps; k++) {
+            const double a = angle * k / steps, c = std::cos(a), s = std::sin(a);
+            add(p, delta * (n1[0] * c - n1[1] * s), delta * (n1[0] * s + n1[1] * c));
+        }
+    }
+}
+
+void PolygonClipper::offset(const IntPolygons &polygons, double delta, const OffsetSettings &settings,
+                            IntPolygons &result) {
+    execute(ClipType::Union, polygons, {}, FillRule::EvenOdd, normalized_);
+    if (delta == 0) {
+        result = normalized_;
+        return;
+    }
+    raw_.resize(normalized_.size());
+    for (size_t i = 0; i < normalized_.size(); i++) offsetPolygon(normalized_[i], delta, settings, raw_[i]);
+    execute(ClipType::Union, raw_, {}, FillRule::Positive, result);
+}
+
+Slicer::Polygons clipPolygons(ClipType op, const Slicer::Polygons &subject, const Slicer::Polygons &clip,
+                              FillRule rule, double scale) {
+    PolygonClipper clipper;
+    IntPolygons result;
+    clipper.execute(op, toIntPolygons(subject, scale), toIntPolygons(clip, scale), rule, result);
+    return toPolygons(result, scale);
+}
+
+Slicer::Polygons offsetPolygons(const Slicer::Polygons &polygons, double delta, const OffsetSettings &settings) {
+    PolygonClipper clipper;
+    IntPolygons result;
+    clipper.offset(toIntPolygons(polygons, settings.scale), delta * settings.scale, settings, result);
+    return toPolygons(result, settings.scale);
+}
+
+std::vector<Slicer::Polygons> perimeters(const Slicer::Polygons &contours, int count, double width,
+                                         const OffsetSettings &settings) {
+    PolygonClipper clipper;
+    IntPolygons region, shell;
+    clipper.execute(ClipType::Union, toIntPolygons(contours, settings.scale), {}, FillRule::EvenOdd, region);
+
+    std::vector<Slicer::Polygons> shells;
+    for (int i = 0; i < count; i++) {
+        clipper.offset(region, -(i + 0.5) * width * settings.scale, settings, shell);
+        if (shell.empty()) break;
+        shells.push_back(toPolygons(shell, settings.scale));
+    }
+    return shells;
+}
+
+std::vector<Slicer::Polygons> offsetLayers(const std::vector<Slicer::Polygons> &layers, double delta,
+                                           const OffsetSettings &settings, unsigned threads) {
+    if (threads == 0) threads = hardwareThreads();
+    std::vector<Slicer::Polygons> result(layers.size());
+    std::vector<PolygonClipper> clippers(threads);
+    parallelFor(layers.size(), threads, 1, [&](size_t begin, size_t end, unsigned worker) {
+        IntPolygons offset;
+        for (size_t i = begin; i < end; i++) {
+            clippers[worker].offset(toIntPolygons(layers[i], settings.scale), delta * settings.scale, settings, offset);
+            result[i] = toPolygons(offset, settings.scale);
+        }
+    });
+    return result;
+}
@@ -0,0 +1,73 @@
+#include <Progress.h>
+#include <atomic>
+#include <mutex>
+#include <memory>
+
+namespace {
+
+std::atomic<bool> silent{false};
+std::mutex callbackMutex;
+std::shared_ptr<ProgressCallback> progressCallback;
+
+std::shared_ptr<ProgressCallback> currentCallback() {
+    std::lock_guard<std::mutex> lock{callbackMutex};
+    return progressCallback;
+}
+
+void drawBar(int percent) {
+    int barWidth = 70;
+    int pos = barWidth * percent / 100;
+    std::string bar = "[";
+    for (int i = 0; i < barWidth; ++i) {
+        if (i < pos) bar += "=";
+        else if (i == pos) bar += ">";
+        else bar += " ";
+    }
+    std::cout << bar << "] " << percent << " %\r";
+    std::cout.flush();
+}
+
+}
+
+void setProgressCallback(ProgressCallback callback) {
+    std::lock_guard<std::mutex> lock{callbackMutex};
+    progressCallback = callback ? std::make_shared<ProgressCallback>(std::move(callback)) : nullptr;
+}
+
+void setQuiet(bool quiet) {
+    silent.store(quiet, std::memory_order_relaxed);
+}
+
+bool quiet() {
+    return silent.load(std::memory_order_relaxed);
+}
+
+std::ostream& info() {
+    // Each thread discards into a stream of its own, as writing to a
+    // stream without a buffer changes its state.
+    thread_local std::ostream discard{nullptr};
+    if (quiet()) return discard;
+    return std::cout << "info: ";
+}
+
+void ProgressBar::update(float progress) {
+    int percent = progress * 100;
+    if (percent == percent_) return;
+    percent_ = percent;
+
+    if (auto callback = currentCallback()) {
+        (*callback)(stage_, progress);
+    } else if (!quiet()) {
+        drawBar(percent);
+    }
+}
+
+void ProgressBar::finish() {
+    percent_ = 100;
+    if (auto callback = currentCallback()) {
+        (*callback)(stage_, 1);
+    } else if (!quiet()) {
+        std::cout << "[" << std::string(70, '=') << "] 100%\n";
+        std::cout.flush();
+    }
+}
@@ -0,0 +1,296 @@
+#include <Rasterizer.h>
+#include <Trace.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <csetjmp>
+#include <png.h>
+
+namespace {
+
+// An edge in sample space, crossing the centers of sample rows
+// [first, last). Its ends are kept rather than a slope, so that the
+// crossing on each row is computed from exact values with one rounding.
+struct RasterEdge {
+    double x0, y0, dx, dy;
+    int first, last;
+    int next;
+};
+
+// Scratch buffers kept by each thread between layers.
+struct RasterScratch {
+    std::vector<RasterEdge> edges;
+    std::vector<int> starts;
+    std::vector<int> active;
+    std::vector<double> xs;
+    std::vector<int> coverage;
+    std::vector<int> runs;
+};
+
+// Snaps a device coordinate to the 24.8 fixed-point grid cairo uses.
+double snap(double v) {
+    return std::nearbyint(v * 256) / 256;
+}
+
+}
+
+int Mask::at(int x, int y) const {
+    const uint8_t *row = &data[y * stride];
+    return bits == 1 ? (row[x >> 3] >> (7 - (x & 7))) & 1 : row[x];
+}
+
+void Mask::fill(int y, int begin, int end, int value) {
+    if (begin >= end) return;
+    uint8_t *row = &data[y * stride];
+    if (bits == 8) {
+        std::memset(row + begin, value, end - begin);
+        return;
+    }
+
+    int first = begin >> 3, last = (end - 1) >> 3;
+    uint8_t head = 0xFF >> (begin & 7);
+    uint8_t tail = 0xFF << (7 - ((end - 1) & 7));
+    if (first == last) head &= tail;
+    if (value) {
+        row[first] |= head;
+    } else {
+        row[first] &= ~head;
+    }
+    if (first == last) return;
+    std::memset(row + first + 1, value ? 0xFF : 0x00, last - first - 1);
+    if (value) {
+        row[last] |= tail;
+    } else {
+        row[last] &= ~tail;
+    }
+}
+
+void rasterize(const RasterPolygons &polygons, const RasterSettings &settings, Mask &mask) {
+    assert(settings.bits == 1 || settings.bits == 8);
+    assert(settings.supersample >= 1 && settings.pitch > 0);
+
+    const int s = settings.supersample;
+    mask.width = settings.width;
+    mask.height = settings.height;
+    mask.bits = settings.bits;
+    mask.stride = settings.bits == 1 ? (settings.width + 7) / 8 : settings.width;
+    mask.data.assign(mask.stride * mask.height, 0);
+
+    thread_local RasterScratch scratch;
+    auto &edges = scratch.edges;
+    auto &starts = scratch.starts;
+    const int rows = settings.height * s;
+    edges.clear();
+    starts.assign(rows, -1);
+
+    // The model maps onto the device as under cairo_translate to the
+    // image center followed by cairo_scale by the inverse pitch.
+    const double scale = 1 / settings.pitch;
+    const double ox = settings.width / 2.0 - settings.centerX * scale;
+    const double oy = settings.height / 2.0 - settings.centerY * scale;
+
+    auto addEdge = [&](const std::array<double, 2> &a, const std::array<double, 2> &b) {
+        double x0 = snap(scale * a[0] + ox) * s, y0 = snap(scale * a[1] + oy) * s;
+        double x1 = snap(scale * b[0] + ox) * s, y1 = snap(scale * b[1] + oy) * s;
+        if (y0 == y1) return;
+        if (y0 > y1) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+
+        // The rows whose centers lie in [y0, y1).
+        int first = std::clamp<double>(std::ceil(y0 - 0.5), 0, rows);
+        int last = std::clamp<double>(std::ceil(y1 - 0.5), 0, rows);
+        if (first >= last) return;
+
+        edges.push_back({x0, y0, x1 - x0, y1 - y0, first, last, starts[first]});
+        starts[first] = edges.size() - 1;
+    };
+
+    // Open contours are closed, as a fill closes every subpath.
+    for (const auto &polygon: polygons) {
+        if (polygon.size() < 2) continue;
+        for (size_t i = 0; i + 1 < polygon.size(); i++) addEdge(polygon[i], polygon[i + 1]);
+        if (polygon.back() != polygon.front()) addEdge(polygon.back(), polygon.front());
+    }
+
+    auto &active = scratch.active;
+    auto &xs = scratch.xs;
+    auto &coverage = scratch.coverage;
+    auto &runs = scratch.runs;
+    active.clear();
+    coverage.assign(s > 1 ? settings.width : 0, 0);
+    runs.assign(s > 1 ? settings.width + 1 : 0, 0);
+    const int columns = settings.width * s;
+    // The pixels touched by the current row of pixels, so that resolving
+    // coverage skips the empty margins.
+    int touchedBegin = settings.width, touchedEnd = 0;
+
+    for (int row = 0; row < rows; row++) {
+        for (int e = starts[row]; e != -1; e = edges[e].next) active.push_back(e);
+        active.erase(std::remove_if(active.begin(), active.end(), [&](int e) {
+            return edges[e].last <= row;
+        }), active.end());
+
+        // Even-odd: the crossings of the row's center, sorted, bound the
+        // spans inside. A sample is inside when x0 <= its center < x1.
+        double yc = row + 0.5;
+        xs.clear();
+        for (int e: active) {
+            const RasterEdge &edge = edges[e];
+            xs.push_back(edge.x0 + (yc - edge.y0) * edge.dx / edge.dy);
+        }
+        std::sort(xs.begin(), xs.end());
+
+        uint8_t *out = &mask.data[(row / s) * mask.stride];
+        const int fill = settings.bits == 1 ? 1 : 255;
+        for (size_t i = 0; i + 1 < xs.size(); i += 2) {
+            int begin = std::clamp<double>(std::ceil(xs[i] - 0.5), 0, columns);
+            int end = std::clamp<double>(std::ceil(xs[i + 1] - 0.5), 0, columns);
+            if (begin >= end) continue;
+
+            if (s > 1) {
+                // Pixels the span crosses fully gain s samples through a
+                // difference array; only the two ends are counted directly.
+                int p0 = begin / s, p1 = (end - 1) / s;
+                touchedBegin = std::min(touchedBegin, p0);
+                touchedEnd = std::max(touchedEnd, p1 + 1);
+                if (p0 == p1) {
+                    coverage[p0] += end - begin;
+                } else {
+                    coverage[p0] += (p0 + 1) * s - begin;
+                    coverage[p1] += end - p1 * s;
+                    runs[p0 + 1] += s;
+                    runs[p1] -= s;
+                }
+            } else {
+                mask.fill(row, begin, end, fill);
+            }
+        }
+
+        // Resolve the coverage of a row of pixels once all its sample rows
+        // are done.
+        if (s > 1 && row % s == s - 1) {
+            const int samples = s * s;
+            int run = 0;
+            for (int x = touchedBegin; x < touchedEnd; x++) {
+                run += runs[x];
+                runs[x] = 0;
+                int covered = coverage[x] + run;
+                coverage[x] = 0;
+                if (covered == 0) continue;
+                if (settings.bits == 1) {
+                    if (2 * covered >= samples) out[x >> 3] |= 0x80 >> (x & 7);
+                } else {
+                    out[x] = (covered * 255 + samples / 2) / samples;
+                }
+            }
+            runs[touchedEnd] = 0;
+            touchedBegin = settings.width;
+            touchedEnd = 0;
+        }
+    }
+}
+
+void writePNG(const Mask &mask, const std::string &path) {
+    trace::Scope scope{"write"};
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("error: cannot write " + path);
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        std::fclose(file);
+        throw std::runtime_error("error: cannot encode " + path);
+    }
+
+    // Masks are mostly long runs of equal bytes, which deflate handles
+    // well without row filters, so speed is favoured over size.
+    png_init_io(png, file);
+    png_set_IHDR(png, info, mask.width, mask.height, mask.bits, PNG_COLOR_TYPE_GRAY,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+    png_set_compression_level(png, 1);
+    png_write_info(png, info);
+    for (int y = 0; y < mask.height; y++) {
+        png_write_row(png, &mask.data[y * mask.stride]);
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+
+    if (std::fclose(file) != 0) {
+        throw std::runtime_error("error: cannot write " + path);
+    }
+}
+
+MaskWriter::MaskWriter(size_t capacity):
+    capacity_{std::max<size_t>(1, capacity)},
+    thread_{[this]() { run(); }} {}
+
+MaskWriter::~MaskWriter() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void MaskWriter::write(Mask mask, std::string path) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    changed_.wait(lock, [&]() { return queue_.size() < capacity_ || failed_; });
+    rethrow();
+    if (failed_) return;
+    queue_.emplace_back(std::move(mask), std::move(path));
+    changed_.notify_all();
+}
+
+void MaskWriter::finish() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    changed_.wait(lock, [&]() { return queue_.empty() && !busy_; });
+    rethrow();
+}
+
+void MaskWriter::rethrow() {
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void MaskWriter::run() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+        changed_.wait(lock, [&]() { return !queue_.empty() || stopping_; });
+        if (queue_.empty()) return;
+
+        auto job = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        changed_.notify_all();
+
+        if (!failed_) {
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                writePNG(job.first, job.second);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            if (error) {
+                error_ = error;
+                failed_ = true;
+            }
+        }
+        busy_ = false;
+        changed_.notify_all();
+    }
+}
@@ -0,0 +1,310 @@
+#include <SliceKernel.h>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SLICE_KERNEL_X86 1
+#endif
+
+template <typename T>
+SoaMesh<T>::SoaMesh(const Geometry &geometry) {
+    const auto &positions = geometry.positions();
+    x.reserve(positions.size());
+    y.reserve(positions.size());
+    z.reserve(positions.size());
+    for (auto &p: positions) {
+        x.push_back(p[0]);
+        y.push_back(p[1]);
+        z.push_back(p[2]);
+    }
+
+    for (auto &corner: corners) corner.reserve(geometry.mesh().faces().size());
+    for (const Face &face: geometry.mesh().faces()) {
+        auto halfedges = face.halfedges();
+        for (int i = 0; i < 3; i++) {
+            corners[i].push_back(halfedges[i]->vertex->index);
+        }
+    }
+}
+
+namespace {
+
+// Plane indices in the output are offset by first, for callers that pass a
+// suffix of the planes.
+template <typename T>
+void intersectScalar(const SoaMesh<T> &mesh, size_t begin, size_t end,
+                     const T *zs, size_t planes, std::vector<Segment<T>> &out, size_t first = 0) {
+    for (size_t f = begin; f < end; f++) {
+        T x[3], y[3], z[3];
+        for (int i = 0; i < 3; i++) {
+            uint32_t v = mesh.corners[i][f];
+            x[i] = mesh.x[v];
+            y[i] = mesh.y[v];
+            z[i] = mesh.z[v];
+        }
+
+        for (size_t p = 0; p < planes; p++) {
+            T plane = zs[p];
+            bool up[3] = {z[0] >= plane, z[1] >= plane, z[2] >= plane};
+            if (up[0] == up[1] && up[1] == up[2]) continue;
+
+            Segment<T> segment{uint32_t(f), uint32_t(first + p), 0, 0, 0, 0, 0, 0};
+            for (int i = 0; i < 3; i++) {
+                int j = (i + 1) % 3;
+                if (up[i] == up[j]) continue;
+
+                int lo = up[i] ? j : i, hi = up[i] ? i : j;
+                T cx = x[hi], cy = y[hi];
+                if (z[hi] != plane) {
+                    T s = (plane - z[lo]) / (z[hi] - z[lo]);
+                    cx = x[lo] + s * (x[hi] - x[lo]);
+                    cy = y[lo] + s * (y[hi] - y[lo]);
+                }
+
+                if (up[i]) {
+                    segment.x0 = cx;
+                    segment.y0 = cy;
+                    segment.entry = i;
+                } else {
+                    segment.x1 = cx;
+                    segment.y1 = cy;
+                    segment.exit = i;
+                }
+            }
+            out.push_back(segment);
+        }
+    }
+}
+
+}
+
+template <typename T>
+void spannedPlanes(const SoaMesh<T> &mesh, size_t face, const T *zs, size_t planes, size_t &first, size_t &last) {
+    T z0 = mesh.z[mesh.corners[0][face]];
+    T z1 = mesh.z[mesh.corners[1][face]];
+    T z2 = mesh.z[mesh.corners[2][face]];
+    T zmin = std::min({z0, z1, z2}), zmax = std::max({z0, z1, z2});
+
+    // A face crosses a plane when some vertex is below it and some vertex
+    // is at or above it: zmin < plane <= zmax.
+    first = std::upper_bound(zs, zs + planes, zmin) - zs;
+    last = std::upper_bound(zs + first, zs + planes, zmax) - zs;
+}
+
+#ifdef SLICE_KERNEL_X86
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+struct F64 {
+    using T = double;
+    using V = __m256d;
+    using M = __m256d;
+    static constexpr int width = 4;
+
+    static V gather(const T *base, const uint32_t *index) {
+        return _mm256_i32gather_pd(base, _mm_loadu_si128(reinterpret_cast<const __m128i*>(index)), 8);
+    }
+    static V set1(T a) { return _mm256_set1_pd(a); }
+    static V load(const T *p) { return _mm256_loadu_pd(p); }
+    static void store(T *p, V a) { _mm256_store_pd(p, a); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static M ge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    static M eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static M land(M a, M b) { return _mm256_and_pd(a, b); }
+    static M lor(M a, M b) { return _mm256_or_pd(a, b); }
+    static M andnot(M a, M b) { return _mm256_andnot_pd(a, b); }
+    static V select(M m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+    static int bits(M m) { return _mm256_movemask_pd(m); }
+};
+
+struct F32 {
+    using T = float;
+    using V = __m256;
+    using M = __m256;
+    static constexpr int width = 8;
+
+    static V gather(const T *base, const uint32_t *index) {
+        return _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index)), 4);
+    }
+    static V set1(T a) { return _mm256_set1_ps(a); }
+    static V load(const T *p) { return _mm256_loadu_ps(p); }
+    static void store(T *p, V a) { _mm256_store_ps(p, a); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static M ge(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static M eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static M land(M a, M b) { return _mm256_and_ps(a, b); }
+    static M lor(M a, M b) { return _mm256_or_ps(a, b); }
+    static M andnot(M a, M b) { return _mm256_andnot_ps(a, b); }
+    static V select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+    static int bits(M m) { return _mm256_movemask_ps(m); }
+};
+
+#include "SliceKernelBody.h"
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+namespace avx512 {
+
+struct F64 {
+    using T = double;
+    using V = __m512d;
+    using M = __mmask8;
+    static constexpr int width = 8;
+
+    static V gather(const T *base, const uint32_t *index) {
+        return _mm512_i32gather_pd(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(index)), base, 8);
+    }
+    static V set1(T a) { return _mm512_set1_pd(a); }
+    static V load(const T *p) { return _mm512_loadu_pd(p); }
+    static void store(T *p, V a) { _mm512_store_pd(p, a); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm512_div_pd(a, b); }
+    static M ge(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+    static M eq(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static M land(M a, M b) { return a & b; }
+    static M lor(M a, M b) { return a | b; }
+    static M andnot(M a, M b) { return ~a & b; }
+    static V select(M m, V a, V b) { return _mm512_mask_blend_pd(m, b, a); }
+    static int bits(M m) { return m; }
+};
+
+struct F32 {
+    using T = float;
+    using V = __m512;
+    using M = __mmask16;
+    static constexpr int width = 16;
+
+    static V gather(const T *base, const uint32_t *index) {
+        return _mm512_i32gather_ps(_mm512_loadu_si512(index), base, 4);
+    }
+    static V set1(T a) { return _mm512_set1_ps(a); }
+    static V load(const T *p) { return _mm512_loadu_ps(p); }
+    static void store(T *p, V a) { _mm512_store_ps(p, a); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm512_div_ps(a, b); }
+    static M ge(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    static M eq(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    static M land(M a, M b) { return a & b; }
+    static M lor(M a, M b) { return a | b; }
+    static M andnot(M a, M b) { return ~a & b; }
+    static V select(M m, V a, V b) { return _mm512_mask_blend_ps(m, b, a); }
+    static int bits(M m) { return m; }
+};
+
+#include "SliceKernelBody.h"
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif /* SLICE_KERNEL_X86 */
+
+SimdLevel supportedSimd() {
+#ifdef SLICE_KERNEL_X86
+    static const SimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+template <typename T>
+void intersectTriangles(const SoaMesh<T> &mesh, size_t begin, size_t end,
+                        const T *zs, size_t planes, std::vector<Segment<T>> &out,
+                        SimdLevel level) {
+    level = std::min(level, supportedSimd());
+
+#ifdef SLICE_KERNEL_X86
+    constexpr bool single = std::is_same<T, float>::value;
+    using AVX2 = std::conditional_t<single, avx2::F32, avx2::F64>;
+    using AVX512 = std::conditional_t<single, avx512::F32, avx512::F64>;
+
+    switch (level) {
+        case SimdLevel::AVX512: return avx512::intersect<AVX512>(mesh, begin, end, zs, planes, out);
+        case SimdLevel::AVX2: return avx2::intersect<AVX2>(mesh, begin, end, zs, planes, out);
+        default: break;
+    }
+#endif
+    intersectScalar(mesh, begin, end, zs, planes, out);
+}
+
+template <typename T>
+void intersectSpans(const SoaMesh<T> &mesh, size_t begin, size_t end,
+                    const T *zs, size_t planes, std::vector<Segment<T>> &out,
+                    SimdLevel level) {
+    level = std::min(level, supportedSimd());
+
+#ifdef SLICE_KERNEL_X86
+    constexpr bool single = std::is_same<T, float>::value;
+    using AVX2 = std::conditional_t<single, avx2::F32, avx2::F64>;
+    using AVX512 = std::conditional_t<single, avx512::F32, avx512::F64>;
+
+    switch (level) {
+        case SimdLevel::AVX512: return avx512::intersectSpans<AVX512>(mesh, begin, end, zs, planes, out);
+        case SimdLevel::AVX2: return avx2::intersectSpans<AVX2>(mesh, begin, end, zs, planes, out);
+        default: break;
+    }
+#endif
+    for (size_t f = begin; f < end; f++) {
+        size_t first, last;
+        spannedPlanes(mesh, f, zs, planes, first, last);
+        intersectScalar(mesh, f, f + 1, zs + first, last - first, out, first);
+    }
+}
+
+template struct SoaMesh<float>;
+template struct SoaMesh<double>;
+template void intersectTriangles(const SoaMesh<float>&, size_t, size_t, const float*, size_t,
+                                 std::vector<Segment<float>>&, SimdLevel);
+template void intersectTriangles(const SoaMesh<double>&, size_t, size_t, const double*, size_t,
+                                 std::vector<Segment<double>>&, SimdLevel);
+template void intersectSpans(const SoaMesh<float>&, size_t, size_t, const float*, size_t,
+                             std::vector<Segment<float>>&, SimdLevel);
+template void intersectSpans(const SoaMesh<double>&, size_t, size_t, const double*, size_t,
+                             std::vector<Segment<double>>&, SimdLevel);
+template void spannedPlanes(const SoaMesh<float>&, size_t, const float*, size_t, size_t&, size_t&);
+template void spannedPlanes(const SoaMesh<double>&, size_t, const double*, size_t, size_t&, size_t&);
@@ -0,0 +1,137 @@
+/**
+ * \file SliceKernelBody.h
+ * \author Thomas Barrett
+ * \brief The vector loops of the slice kernel, written once for every ISA
+ *
+ * This file is included by SliceKernel.cpp once per instruction set, inside
+ * a namespace and a target region for that instruction set, after the
+ * definition of the vector types it is instantiated with. Each vector type S
+ * provides the element type T, the lane count, a vector type V, a lane mask
+ * type M and the operations used below.
+ */
+
+// The crossings of one layer of lanes, each a triangle against a plane.
+template <class S>
+struct Crossings {
+    alignas(64) typename S::T points[4][S::width];
+    int lanes;
+    int entry[2];
+    int exit[2];
+
+    Segment<typename S::T> segment(int lane, uint32_t face, uint32_t plane) const {
+        int bit = 1 << lane;
+        return {
+            face, plane,
+            points[0][lane], points[1][lane], points[2][lane], points[3][lane],
+            uint8_t(entry[0] & bit ? 1 : entry[1] & bit ? 2 : 0),
+            uint8_t(exit[0] & bit ? 1 : exit[1] & bit ? 2 : 0),
+        };
+    }
+};
+
+template <class S>
+void cross(const typename S::V (&x)[3], const typename S::V (&y)[3], const typename S::V (&z)[3],
+           typename S::V plane, Crossings<S> &result) {
+    using V = typename S::V;
+    using M = typename S::M;
+
+    M up[3] = {S::ge(z[0], plane), S::ge(z[1], plane), S::ge(z[2], plane)};
+    M any = S::lor(S::lor(up[0], up[1]), up[2]);
+    M all = S::land(S::land(up[0], up[1]), up[2]);
+    result.lanes = S::bits(S::andnot(all, any));
+    if (!result.lanes) return;
+
+    // Interpolate along every edge from its lower to its upper end; edges
+    // that do not cross are discarded by the selects below.
+    V cx[3], cy[3];
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        V lox = S::select(up[i], x[j], x[i]), hix = S::select(up[i], x[i], x[j]);
+        V loy = S::select(up[i], y[j], y[i]), hiy = S::select(up[i], y[i], y[j]);
+        V loz = S::select(up[i], z[j], z[i]), hiz = S::select(up[i], z[i], z[j]);
+
+        V s = S::div(S::sub(plane, loz), S::sub(hiz, loz));
+        M onPlane = S::eq(hiz, plane);
+        cx[i] = S::select(onPlane, hix, S::add(lox, S::mul(s, S::sub(hix, lox))));
+        cy[i] = S::select(onPlane, hiy, S::add(loy, S::mul(s, S::sub(hiy, loy))));
+    }
+
+    // The entry edge runs from above to below, the exit edge back.
+    M entry1 = S::andnot(up[2], up[1]), entry2 = S::andnot(up[0], up[2]);
+    M exit1 = S::andnot(up[1], up[2]), exit2 = S::andnot(up[2], up[0]);
+    result.entry[0] = S::bits(entry1);
+    result.entry[1] = S::bits(entry2);
+    result.exit[0] = S::bits(exit1);
+    result.exit[1] = S::bits(exit2);
+
+    S::store(result.points[0], S::select(entry1, cx[1], S::select(entry2, cx[2], cx[0])));
+    S::store(result.points[1], S::select(entry1, cy[1], S::select(entry2, cy[2], cy[0])));
+    S::store(result.points[2], S::select(exit1, cx[1], S::select(exit2, cx[2], cx[0])));
+    S::store(result.points[3], S::select(exit1, cy[1], S::select(exit2, cy[2], cy[0])));
+}
+
+// Vectorized across faces: each lane is a different face against the same
+// plane.
+template <class S>
+void intersect(const SoaMesh<typename S::T> &mesh, size_t begin, size_t end,
+               const typename S::T *zs, size_t planes, std::vector<Segment<typename S::T>> &out) {
+    using V = typename S::V;
+    constexpr int width = S::width;
+
+    size_t f = begin;
+    for (; f + width <= end; f += width) {
+        V x[3], y[3], z[3];
+        for (int i = 0; i < 3; i++) {
+            const uint32_t *corner = &mesh.corners[i][f];
+            x[i] = S::gather(mesh.x.data(), corner);
+            y[i] = S::gather(mesh.y.data(), corner);
+            z[i] = S::gather(mesh.z.data(), corner);
+        }
+
+        Crossings<S> result;
+        for (size_t p = 0; p < planes; p++) {
+            cross(x, y, z, S::set1(zs[p]), result);
+            for (int lanes = result.lanes; lanes; lanes &= lanes - 1) {
+                int lane = __builtin_ctz(lanes);
+                out.push_back(result.segment(lane, f + lane, p));
+            }
+        }
+    }
+
+    intersectScalar(mesh, f, end, zs, planes, out);
+}
+
+// Vectorized across planes: each lane is the same face against a different
+// plane within its z-range, so every lane crosses.
+template <class S>
+void intersectSpans(const SoaMesh<typename S::T> &mesh, size_t begin, size_t end,
+                    const typename S::T *zs, size_t planes, std::vector<Segment<typename S::T>> &out) {
+    using V = typename S::V;
+    constexpr int width = S::width;
+
+    for (size_t f = begin; f < end; f++) {
+        size_t first, last;
+        spannedPlanes(mesh, f, zs, planes, first, last);
+
+        size_t p = first;
+        if (last - first >= width) {
+            V x[3], y[3], z[3];
+            for (int i = 0; i < 3; i++) {
+                uint32_t v = mesh.corners[i][f];
+                x[i] = S::set1(mesh.x[v]);
+                y[i] = S::set1(mesh.y[v]);
+                z[i] = S::set1(mesh.z[v]);
+            }
+
+            Crossings<S> result;
+            for (; p + width <= last; p += width) {
+                cross(x, y, z, S::load(zs + p), result);
+                for (int lane = 0; lane < width; lane++) {
+                    out.push_back(result.segment(lane, f, p + lane));
+                }
+            }
+        }
+
+        intersectScalar(mesh, f, f + 1, zs + p, last - p, out, p);
+    }
+}
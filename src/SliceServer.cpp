@@ -0,0 +1,423 @@
+#include <SliceServer.h>
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <filesystem>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+// A rough count of the bytes a single-threaded session holds per face:
+// the interval tree, and the section, marks and vertex order of the sweep.
+constexpr size_t sessionBytesPerFace = 64;
+
+// The longest request read, which bounds what a client can make the
+// server hold.
+constexpr size_t maxRequest = 1 << 16;
+
+std::vector<std::string> split(const std::string &line) {
+    std::vector<std::string> fields;
+    std::string field;
+    std::istringstream in{line};
+    while (std::getline(in, field, '\t')) fields.push_back(field);
+    return fields;
+}
+
+std::string join(const std::vector<std::string> &fields) {
+    std::string line;
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i].find_first_of("\t\n") != std::string::npos) {
+            throw std::runtime_error("error: request fields cannot contain tabs or newlines");
+        }
+        if (i > 0) line += '\t';
+        line += fields[i];
+    }
+    return line + '\n';
+}
+
+// Reads up to a newline, which is dropped. Returns false if the peer closed
+// the connection or sent too much first.
+bool readLine(int fd, std::string &line) {
+    line.clear();
+    char buffer[4096];
+    while (line.size() < maxRequest) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        line.append(buffer, n);
+        size_t end = line.find('\n');
+        if (end != std::string::npos) {
+            line.resize(end);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool writeAll(int fd, const std::string &text) {
+    for (size_t sent = 0; sent < text.size();) {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Parses the whole of text as a number. Throws std::invalid_argument or
+// std::out_of_range otherwise.
+double number(const std::string &text) {
+    size_t end = 0;
+    double value = std::stod(text, &end);
+    if (end != text.size()) throw std::invalid_argument(text);
+    return value;
+}
+
+int integer(const std::string &text) {
+    size_t end = 0;
+    int value = std::stoi(text, &end);
+    if (end != text.size()) throw std::invalid_argument(text);
+    return value;
+}
+
+sockaddr_un socketAddress(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("error: socket path too long: " + path);
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+}
+
+bool SliceJob::parse(const std::vector<std::string> &args, size_t &i) {
+    const std::string &arg = args[i];
+    const bool value = i + 1 < args.size();
+    RasterSettings &raster = settings.raster;
+    LayerSettings &layers = settings.layers;
+
+    if (arg == "--resolution" && value) {
+        int end = 0;
+        const std::string &text = args[++i];
+        if (std::sscanf(text.c_str(), "%dx%d%n", &raster.width, &raster.height, &end) != 2 || end != int(text.size())) {
+            throw std::invalid_argument(text);
+        }
+    } else if (arg == "--pitch" && value) {
+        raster.pitch = number(args[++i]);
+    } else if (arg == "--bits" && value) {
+        raster.bits = integer(args[++i]);
+        if (raster.bits != 1 && raster.bits != 8) throw std::out_of_range(args[i]);
+    } else if (arg == "--antialias" && value) {
+        raster.supersample = integer(args[++i]);
+        if (raster.supersample < 1) throw std::out_of_range(args[i]);
+    } else if (arg == "--layer-height" && value) {
+        layers.height = number(args[++i]);
+    } else if (arg == "--adaptive" && value) {
+        layers.adaptive = true;
+        layers.tolerance = number(args[++i]);
+    } else if (arg == "--min-layer-height" && value) {
+        layers.minHeight = number(args[++i]);
+    } else if (arg == "--min-z" && value) {
+        settings.minZ = number(args[++i]);
+    } else if (arg == "--max-z" && value) {
+        settings.maxZ = number(args[++i]);
+    } else if (arg == "--stack" && value) {
+        stackPath = args[++i];
+    } else if (arg == "--output" && value) {
+        outputPath = args[++i];
+    } else if (arg == "--contours-only") {
+        settings.masks = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool SliceJob::valid() const {
+    const LayerSettings &layers = settings.layers;
+    return !path.empty() && layers.height > 0 && layers.minHeight > 0 && layers.tolerance > 0 &&
+           settings.raster.width > 0 && settings.raster.height > 0 && settings.raster.pitch > 0 &&
+           (!stackPath.empty() || (settings.masks && !outputPath.empty()));
+}
+
+std::unique_ptr<LayerSink> SliceJob::sink() const {
+    if (!stackPath.empty()) return std::make_unique<LayerStackSink>(stackPath);
+    return std::make_unique<PngSink>(outputPath);
+}
+
+GeometryCache::Entry::Entry(Geometry geometry):
+    geometry_{std::move(geometry)},
+    bytes_{sizeof(Geometry::Point) * geometry_.positions().size() + geometry_.mesh().memoryUsage()} {}
+
+std::unique_ptr<SliceSession> GeometryCache::Entry::acquire() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (idle_) return std::move(idle_);
+    }
+    bytes_ += sessionBytesPerFace * geometry_.mesh().faces().size();
+    return std::make_unique<SliceSession>(geometry_);
+}
+
+void GeometryCache::Entry::release(std::unique_ptr<SliceSession> session) {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (!idle_) {
+            idle_ = std::move(session);
+            return;
+        }
+    }
+    // Sessions built for jobs that overlapped are freed rather than kept.
+    bytes_ -= sessionBytesPerFace * geometry_.mesh().faces().size();
+}
+
+GeometryCache::GeometryCache(size_t budget, unsigned threads, bool useCacheFiles):
+    budget_{budget}, threads_{threads}, useCacheFiles_{useCacheFiles} {}
+
+std::shared_ptr<GeometryCache::Entry> GeometryCache::get(const std::string &path, bool *hit) {
+    SourceFingerprint source;
+    try {
+        source = SourceFingerprint::of(path);
+    } catch (const std::filesystem::filesystem_error &) {
+        throw std::runtime_error("error: cannot read " + path);
+    }
+    const Key key{source.size, source.modified, source.hash};
+
+    std::promise<std::shared_ptr<Entry>> loaded;
+    std::shared_future<std::shared_ptr<Entry>> cached;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto found = slots_.find(key);
+        if (found != slots_.end()) {
+            stats_.hits++;
+            recent_.splice(recent_.begin(), recent_, found->second.recent);
+            cached = found->second.entry;
+            evict(key);
+        } else {
+            stats_.misses++;
+            recent_.push_front(key);
+            slots_[key] = Slot{loaded.get_future().share(), recent_.begin()};
+        }
+    }
+    if (hit) *hit = cached.valid();
+    if (cached.valid()) return cached.get();
+
+    // Loading happens outside the lock, so that other meshes are served
+    // meanwhile; requests for this one wait on the future.
+    std::shared_ptr<Entry> entry;
+    try {
+        entry = std::make_shared<Entry>(loadGeometry(path, threads_, useCacheFiles_));
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            recent_.erase(slots_[key].recent);
+            slots_.erase(key);
+        }
+        loaded.set_exception(std::current_exception());
+        throw;
+    }
+    loaded.set_value(entry);
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    evict(key);
+    return entry;
+}
+
+void GeometryCache::evict(const Key &keep) {
+    const auto ready = [](const Slot &slot) {
+        return slot.entry.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+
+    size_t bytes = 0;
+    for (const auto &[key, slot]: slots_) {
+        if (ready(slot)) bytes += slot.entry.get()->bytes();
+    }
+
+    for (auto it = recent_.end(); bytes > budget_ && it != recent_.begin();) {
+        --it;
+        auto slot = slots_.find(*it);
+        if (*it == keep || !ready(slot->second)) continue;
+        bytes -= slot->second.entry.get()->bytes();
+        slots_.erase(slot);
+        it = recent_.erase(it);
+        stats_.evictions++;
+    }
+}
+
+GeometryCache::Stats GeometryCache::stats() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    Stats stats = stats_;
+    for (const auto &[key, slot]: slots_) {
+        if (slot.entry.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+        stats.entries++;
+        stats.bytes += slot.entry.get()->bytes();
+    }
+    return stats;
+}
+
+SliceServer::SliceServer(const ServerSettings &settings):
+    settings_{settings},
+    // Meshes load on the worker whose job missed, one thread each, as the
+    // other workers are busy with jobs of their own.
+    cache_{settings.cacheBytes, 1, settings.useCacheFiles},
+    pool_{settings.workers, settings.queue} {
+    sockaddr_un address = socketAddress(settings.socketPath);
+    listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener_ < 0 || pipe(wake_) != 0) {
+        throw std::runtime_error("error: cannot create socket " + settings.socketPath);
+    }
+    unlink(settings.socketPath.c_str());
+    if (bind(listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener_, 128) != 0) {
+        close(listener_);
+        close(wake_[0]);
+        close(wake_[1]);
+        throw std::runtime_error("error: cannot listen on " + settings.socketPath);
+    }
+}
+
+SliceServer::~SliceServer() {
+    pool_.wait();
+    close(listener_);
+    close(wake_[0]);
+    close(wake_[1]);
+    unlink(settings_.socketPath.c_str());
+}
+
+void SliceServer::run() {
+    pollfd fds[2] = {{listener_, POLLIN, 0}, {wake_[0], POLLIN, 0}};
+    while (!stopping_) {
+        if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN)) continue;
+        int connection = accept(listener_, nullptr, nullptr);
+        if (connection >= 0) serve(connection);
+    }
+    pool_.wait();
+}
+
+void SliceServer::stop() {
+    stopping_ = true;
+    char byte = 0;
+    (void) !write(wake_[1], &byte, 1);
+}
+
+void SliceServer::serve(int connection) {
+    // A client that connects and sends nothing cannot hold up the others
+    // for long.
+    timeval timeout{5, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string line;
+    if (!readLine(connection, line)) {
+        close(connection);
+        return;
+    }
+    std::vector<std::string> fields = split(line);
+    const std::string command = fields.empty() ? "" : fields[0];
+
+    if (command == "slice") {
+        // Blocks while the queue is full, which stops further accepts.
+        pool_.submit([this, connection, fields = std::move(fields)]() {
+            writeAll(connection, slice(fields) + "\n");
+            close(connection);
+        });
+        return;
+    }
+
+    if (command == "status") {
+        writeAll(connection, status() + "\n");
+    } else if (command == "stop") {
+        writeAll(connection, "ok\n");
+        stop();
+    } else {
+        writeAll(connection, "error: unknown request " + command + "\n");
+    }
+    close(connection);
+}
+
+std::string SliceServer::slice(const std::vector<std::string> &fields) {
+    const auto start = std::chrono::steady_clock::now();
+    jobs_++;
+    try {
+        if (fields.size() < 2) throw std::runtime_error("error: missing working directory");
+        const std::filesystem::path directory = fields[1];
+        const std::vector<std::string> args(fields.begin() + 2, fields.end());
+
+        SliceJob job;
+        for (size_t i = 0; i < args.size(); i++) {
+            bool option;
+            try {
+                option = job.parse(args, i);
+            } catch (const std::logic_error &) {
+                throw std::runtime_error("error: invalid job");
+            }
+            if (option) continue;
+            if (!job.path.empty()) throw std::runtime_error("error: unexpected argument " + args[i]);
+            job.path = args[i];
+        }
+        job.settings.layers.minHeight = std::min(job.settings.layers.minHeight, job.settings.layers.height);
+        if (!job.valid()) throw std::runtime_error("error: invalid job");
+
+        // Jobs run side by side, one on each worker.
+        job.settings.threads = 1;
+        job.path = directory / job.path;
+        if (!job.stackPath.empty()) job.stackPath = directory / job.stackPath;
+        if (!job.outputPath.empty()) job.outputPath = directory / job.outputPath;
+
+        bool hit = false;
+        auto entry = cache_.get(job.path, &hit);
+        auto session = entry->acquire();
+        auto sink = job.sink();
+        const size_t layers = session->layers(job.settings).size();
+        Slicer::Diagnostics diagnostics;
+        try {
+            diagnostics = session->slice(job.settings, *sink);
+        } catch (...) {
+            entry->release(std::move(session));
+            throw;
+        }
+        entry->release(std::move(session));
+
+        size_t open = std::count_if(diagnostics.begin(), diagnostics.end(), [](auto &d) {
+            return d.kind == Slicer::Diagnostic::OpenContour;
+        });
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::ostringstream reply;
+        reply << "ok layers=" << layers << " open=" << open << " collapsed=" << diagnostics.size() - open
+              << " cached=" << hit << " ms=" << std::fixed << std::setprecision(3) << ms;
+        return reply.str();
+    } catch (const std::exception &e) {
+        failures_++;
+        std::string message = e.what();
+        return message.rfind("error: ", 0) == 0 ? message : "error: " + message;
+    }
+}
+
+std::string SliceServer::status() const {
+    GeometryCache::Stats stats = cache_.stats();
+    std::ostringstream reply;
+    reply << "ok meshes=" << stats.entries << " bytes=" << stats.bytes << " hits=" << stats.hits
+          << " misses=" << stats.misses << " evictions=" << stats.evictions
+          << " jobs=" << jobs_ << " failed=" << failures_ << " workers=" << pool_.threads();
+    return reply.str();
+}
+
+std::string serverRequest(const std::string &socketPath, const std::vector<std::string> &fields) {
+    sockaddr_un address = socketAddress(socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("error: cannot connect to " + socketPath);
+    }
+
+    std::string reply;
+    bool ok = writeAll(fd, join(fields)) && readLine(fd, reply);
+    close(fd);
+    if (!ok) throw std::runtime_error("error: no reply from " + socketPath);
+    return reply;
+}
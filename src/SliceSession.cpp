@@ -0,0 +1,141 @@
+#include <SliceSession.h>
+#include <algorithm>
+#include <stdexcept>
+#include <Parallel.h>
+#include <Progress.h>
+#include <Trace.h>
+
+void MemorySink::begin(const SliceSettings &/*settings*/, size_t layers) {
+    layers_.clear();
+    layers_.reserve(layers);
+}
+
+void MemorySink::layer(const SliceLayer &layer) {
+    layers_.push_back({layer.z, layer.polygons, layer.mask ? std::move(*layer.mask) : Mask{}});
+}
+
+void PngSink::begin(const SliceSettings &settings, size_t /*layers*/) {
+    if (!settings.masks) {
+        throw std::runtime_error("error: PNG output needs masks");
+    }
+}
+
+void PngSink::layer(const SliceLayer &layer) {
+    writer_.write(std::move(*layer.mask), directory_ + "/slice" + std::to_string(layer.index) + ".png");
+}
+
+void PngSink::finish() {
+    writer_.finish();
+}
+
+void LayerStackSink::begin(const SliceSettings &settings, size_t layers) {
+    writer_ = std::make_unique<LayerStackWriter>(path_, LayerStackSettings{1e5, settings.masks, settings.raster});
+    records_.assign(layers, LayerRecord{});
+}
+
+void LayerStackSink::process(const SliceLayer &layer) {
+    records_[layer.index] = writer_->encode(layer.z, layer.polygons, layer.mask);
+}
+
+void LayerStackSink::layer(const SliceLayer &layer) {
+    writer_->append(records_[layer.index]);
+    records_[layer.index] = LayerRecord{};
+}
+
+void LayerStackSink::finish() {
+    writer_->finish();
+    writer_.reset();
+    records_.clear();
+}
+
+SliceSession::SliceSession(const Geometry &geometry): geometry_{geometry}, tree_{Slicer::faceTree(geometry)} {
+    const auto &positions = geometry.positions();
+    auto [lo, hi] = std::minmax_element(positions.begin(), positions.end(), [](auto &a, auto &b) {
+        return a[2] < b[2];
+    });
+    if (lo != positions.end()) {
+        minz_ = (*lo)[2];
+        maxz_ = (*hi)[2];
+    }
+}
+
+SliceSession::~SliceSession() = default;
+
+const std::vector<double>& SliceSession::schedule(const LayerSettings &settings, unsigned threads) {
+    bool same = scheduled_ && settings.height == scheduleSettings_.height &&
+                settings.adaptive == scheduleSettings_.adaptive &&
+                (!settings.adaptive || (settings.minHeight == scheduleSettings_.minHeight &&
+                                        settings.tolerance == scheduleSettings_.tolerance));
+    if (!same) {
+        schedule_ = settings.adaptive ? Slicer::layerSchedule(geometry_, settings, threads)
+                                      : Slicer::uniformLayers(minz_, maxz_, settings.height);
+        scheduleSettings_ = settings;
+        scheduled_ = true;
+    }
+    return schedule_;
+}
+
+std::vector<double> SliceSession::layers(const SliceSettings &settings) {
+    const auto &zs = schedule(settings.layers, settings.threads);
+    return {std::lower_bound(zs.begin(), zs.end(), settings.minZ), std::upper_bound(zs.begin(), zs.end(), settings.maxZ)};
+}
+
+Slicer::Diagnostics SliceSession::slice(const SliceSettings &settings, LayerSink &sink) {
+    const unsigned threads = settings.threads == 0 ? hardwareThreads() : settings.threads;
+    const auto zs = layers(settings);
+    sink.begin(settings, zs.size());
+
+    // Masks are rasterized on the worker that sliced the layer and wait
+    // there until the layer is delivered, as the sink may keep them.
+    std::vector<Mask> masks(settings.masks ? zs.size() : 0);
+    auto process = [&](int i, double z, const Slicer::Polygons &polygons) {
+        trace::Scope scope{"export"};
+        SliceLayer layer{i, z, polygons, nullptr};
+        if (settings.masks) {
+            rasterize(polygons, settings.raster, masks[i]);
+            layer.mask = &masks[i];
+        }
+        sink.process(layer);
+    };
+
+    ProgressBar progress{"slice"};
+    auto emit = [&](int i, double z, const Slicer::Polygons &polygons) {
+        trace::count("layers");
+        {
+            trace::Scope scope{"write"};
+            sink.layer({i, z, polygons, settings.masks ? &masks[i] : nullptr});
+        }
+        if (settings.masks) masks[i] = Mask{};
+        progress.update((float) i / zs.size());
+    };
+
+    Slicer::Diagnostics diagnostics;
+    if (threads == 1) {
+        // One worker sweeps upward, carrying crossed faces between layers.
+        if (sweep_) {
+            sweep_->rewind();
+        } else {
+            sweep_ = std::make_unique<IncrementalSlicer>(geometry_);
+        }
+        for (size_t i = 0; i < zs.size(); i++) {
+            const Slicer::Polygons &polygons = sweep_->advance(zs[i]);
+            for (Slicer::Diagnostic d: sweep_->diagnostics()) {
+                d.layer = i;
+                diagnostics.push_back(d);
+            }
+            process(i, zs[i], polygons);
+            emit(i, zs[i], polygons);
+        }
+    } else {
+        Slicer::sliceLayers(geometry_, tree_, sections_, zs, emit, threads, process, &diagnostics);
+    }
+    sink.finish();
+    progress.finish();
+    return diagnostics;
+}
+
+const Slicer::Polygons& SliceSession::sliceAt(double z) {
+    if (sections_.empty()) sections_.resize(1);
+    if (!sections_[0]) sections_[0] = std::make_unique<Slicer::Section>(geometry_);
+    return Slicer::sliceLayer(geometry_, tree_, z, *sections_[0]);
+}
@@ -3,162 +3,662 @@
 #include <vector>
 #include <array>
 #include <cassert>
-#include <map>
 #include <cmath>
-#include <set>
 #include <algorithm>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <memory>
 #include <Mesh.h>
 #include <Slicer.h>
 #include <Progress.h>
-#include <cairo/cairo.h>
+#include <Parallel.h>
+#include <SliceKernel.h>
+#include <StreamSlicer.h>
+#include <SliceSession.h>
+#include <Trace.h>
 
-void Slicer::sliceGeometry(const Geometry &geometry /*, SliceJobSettings */) {
-        assert(geometry.mesh().closed());
+// Computes the z-extent of every face, indexed by face index.
+static void faceRanges(const Geometry &geometry, std::vector<double> &zmin, std::vector<double> &zmax) {
+    const auto &faces = geometry.mesh().faces();
+    zmin.resize(faces.size());
+    zmax.resize(faces.size());
 
-        auto compare_z = [](auto &a, auto &b) {
-            return a[2] < b[2];
-        };
+    for (const Face &face: faces) {
+        double lo = std::numeric_limits<double>::infinity();
+        double hi = -std::numeric_limits<double>::infinity();
+        for (const Vertex *v: face.vertices()) {
+            double z = geometry.positions()[v->index][2];
+            lo = std::min(lo, z);
+            hi = std::max(hi, z);
+        }
+        zmin[face.index] = lo;
+        zmax[face.index] = hi;
+    }
+}
 
-        auto [min, max] = std::minmax_element(
-            geometry.positions().begin(),
-            geometry.positions().end(),
-            compare_z
-        );
+FaceSweep::FaceSweep(const Geometry &geometry) {
+    faceRanges(geometry, zmin_, zmax_);
+
+    order_.reserve(geometry.mesh().faces().size());
+    for (const Face &face: geometry.mesh().faces()) {
+        order_.push_back(&face);
+    }
 
-        float minz = (*min)[2];
-        float maxz = (*max)[2];
+    std::sort(order_.begin(), order_.end(), [&](const Face *a, const Face *b) {
+        return zmin_[a->index] < zmin_[b->index];
+    });
+}
 
-        std::cout << "info: start slicing" << std::endl;
+const std::vector<const Face*>& FaceSweep::advance(double z) {
+    // Retire faces that lie entirely below the plane. Faces are only ever
+    // removed once, so the cost of this pass is bounded by the number of
+    // faces that were active at the previous height.
+    active_.erase(std::remove_if(active_.begin(), active_.end(), [&](const Face *f) {
+        return zmax_[f->index] < z;
+    }), active_.end());
 
-        int slice_width = 0.1;
-        int n_slices = (maxz - minz) / slice_width;
+    // Admit faces whose lowest vertex has been reached by the plane.
+    while (next_ < order_.size() && zmin_[order_[next_]->index] <= z) {
+        const Face *f = order_[next_++];
+        if (zmax_[f->index] >= z) {
+            active_.push_back(f);
+        }
+    }
 
-        ProgressBar progress;
-        int sliceCount = 0;
-        for (double z = minz; z <= maxz; z += slice_width) {
-            auto [points, edges] = sliceTriangles(geometry, z);
-            const Polygons &polygons = computeContours(geometry, points, std::move(edges));
-            const auto polygon_path = "test/img/slice" + std::to_string(sliceCount);
-            exportPolygonsToPNG(polygons, polygon_path + ".png");
-            progress.update(sliceCount / 300.0);
-            sliceCount += 1;
-        } 
-        progress.finish();
+    return active_;
 }
 
-std::pair<Slicer::Points, Slicer::Edges> Slicer::sliceTriangles(const Geometry &geometry, double z) {
-    Slicer::Points points;
-    Slicer::Edges edges; 
+/**
+ * Puts layers finished out of order by several workers back in order. The
+ * worker that finishes the lowest outstanding layer emits it straight from
+ * its section, then the whole ready prefix, so emit sees layers one at a
+ * time and in ascending z. Only layers that finish early are copied.
+ */
+class LayerQueue {
+public:
+    LayerQueue(const std::vector<double> &zs, const Slicer::LayerCallback &emit, Slicer::Diagnostics *diagnostics):
+        zs_{zs}, emit_{emit}, diagnostics_{diagnostics}, ready_(zs.size()) {}
 
-    for (const Face &face: geometry.mesh().faces()) {
+    void finish(size_t i, const Slicer::Polygons &polygons, const Slicer::Diagnostics &diagnostics) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (diagnostics_) {
+            for (Slicer::Diagnostic d: diagnostics) {
+                d.layer = i;
+                diagnostics_->push_back(d);
+            }
+        }
+
+        if (i != next_) {
+            ready_[i] = polygons;
+            return;
+        }
+        emit_(next_, zs_[next_], polygons);
+        next_++;
+        while (next_ < ready_.size() && ready_[next_]) {
+            emit_(next_, zs_[next_], *ready_[next_]);
+            ready_[next_].reset();
+            next_++;
+        }
+    }
+
+    // Each layer's diagnostics were appended together, so a stable sort puts
+    // them in the order a single thread would have produced.
+    void sortDiagnostics() {
+        if (!diagnostics_) return;
+        std::stable_sort(diagnostics_->begin(), diagnostics_->end(), [](auto &a, auto &b) {
+            return a.layer < b.layer;
+        });
+    }
+
+private:
+    const std::vector<double> &zs_;
+    const Slicer::LayerCallback &emit_;
+    Slicer::Diagnostics *diagnostics_;
+    std::vector<std::optional<Slicer::Polygons>> ready_;
+    std::mutex mutex_;
+    size_t next_ = 0;
+};
+
+Slicer::Diagnostics Slicer::sliceStream(const std::string &path, size_t memoryCap, const SliceSettings &settings,
+                                        LayerSink &sink) {
+    info() << "sorting triangles" << std::endl;
+    StreamSlicer slicer{path, memoryCap};
+    info() << slicer.triangles() << " triangles in " << slicer.runs() << " runs" << std::endl;
 
-        std::set<Slicer::Intersection> intersections;
-
-        for (const HalfEdge *halfedge: face.adjacentHalfEdges()) {
-            assert(!halfedge->onBoundary);
-
-            Vertex *v1 = halfedge->vertex;
-            Vertex *v2 = halfedge->next->vertex;
-
-            const Geometry::Point &p1 = geometry.positions().at(v1->index);
-            const Geometry::Point &p2 = geometry.positions().at(v2->index);
-            
-            auto [eminz, emaxz] = std::minmax(p1, p2, [](auto &a, auto &b) {
-                return a[2] < b[2];
-            });
-
-            /*
-             * There are a couple of ways that an halfedge could intersect the 
-             * plane:
-             * 
-             * 1. halfedge lies flat on plane
-             * 2. halfedge intersects at start vertex
-             * 3. halfedge intersects at end vertex 
-             * 4. halfedge intersects between vertices
-             * 
-             * We ignore the first case, since it is meaningless to consider
-             * the intersection in such a case. 
-             */
-            if (eminz[2] == z && z == emaxz[2]) {
-                continue;
-            } else if (p1[2] == z) {
-                Slicer::Point p {p1[0], p1[1]};
-                points.emplace(v1, p);
-                intersections.insert(v1);
-            } else if (p2[2] == z) {
-                Slicer::Point p {p2[0], p2[1]};
-                points.emplace(v2, p);
-                intersections.insert(v2);
-            } else if (eminz[2] < z && z < emaxz[2]) {
-                double s = (z - eminz[2]) / (emaxz[2] - eminz[2]);
-                Slicer::Point p {
-                    eminz[0] + s * (emaxz[0] - eminz[0]),
-                    eminz[1] + s * (emaxz[1] - eminz[1]),
-                };
-                points.emplace(halfedge->edge, p);
-                intersections.insert(halfedge->edge);
+    info() << "start slicing" << std::endl;
+    std::vector<double> zs;
+    for (double z: uniformLayers(slicer.minZ(), slicer.maxZ(), settings.layers.height)) {
+        if (z >= settings.minZ && z <= settings.maxZ) zs.push_back(z);
+    }
+    sink.begin(settings, zs.size());
+
+    ProgressBar progress{"slice"};
+    Diagnostics diagnostics;
+    Mask mask;
+    slicer.slice(zs, [&](int sliceCount, double z, const Polygons &polygons) {
+        trace::count("layers");
+        SliceLayer layer{sliceCount, z, polygons, nullptr};
+        {
+            trace::Scope scope{"export"};
+            if (settings.masks) {
+                rasterize(polygons, settings.raster, mask);
+                layer.mask = &mask;
             }
-            
-        }
-
-        if (intersections.size() == 2) {
-            std::vector<Slicer::Intersection> entities {intersections.begin(), intersections.end()}; 
-            edges.emplace(entities[0], entities[1]);
-            edges.emplace(entities[1], entities[0]);
-        }
-        
-    }
-    return {points, edges};
-}
-
-Slicer::Polygons Slicer::computeContours(const Geometry &g, const Points &points, Edges edges) {
-    Slicer::Polygons polygons;
-   
-    while(edges.size() > 0) {
-        Slicer::Intersection first = edges.begin()->first;
-        Slicer::Intersection e = first;
-        Slicer::Polygon polygon;
-
-        // Define a local function that connects contours through a modified
-        // algorithm used to seperate dipartite graphs. 
-        std::function<void(Slicer::Intersection e)> build_polygon;
-        build_polygon = [&](Slicer::Intersection e) {
-            
-            // Make sure there are no duplicate key value pairs
-            auto [begin, end] = edges.equal_range(e);
-            std::set<Slicer::Intersection> next_set;
-            while (begin != end) {
-                next_set.insert(begin->second);
-                begin++;
+            sink.process(layer);
+        }
+        {
+            trace::Scope scope{"write"};
+            sink.layer(layer);
+        }
+        progress.update((float) sliceCount / zs.size());
+    }, &diagnostics);
+    sink.finish();
+    progress.finish();
+    info() << "peak memory " << slicer.peakMemory() / (1 << 20) << " MiB" << std::endl;
+    return diagnostics;
+}
+
+void Slicer::reportDiagnostics(const Diagnostics &diagnostics) {
+    size_t open = std::count_if(diagnostics.begin(), diagnostics.end(), [](auto &d) {
+        return d.kind == Diagnostic::OpenContour;
+    });
+    if (open > 0) {
+        std::cout << "warning: " << open << " open contours" << std::endl;
+    }
+    if (diagnostics.size() > open) {
+        std::cout << "warning: " << diagnostics.size() - open << " collapsed contours dropped" << std::endl;
+    }
+}
+
+std::vector<double> Slicer::uniformLayers(const Geometry &geometry, double height) {
+    auto compare_z = [](auto &a, auto &b) {
+        return a[2] < b[2];
+    };
+
+    auto [min, max] = std::minmax_element(
+        geometry.positions().begin(),
+        geometry.positions().end(),
+        compare_z
+    );
+    return uniformLayers((*min)[2], (*max)[2], height);
+}
+
+std::vector<double> Slicer::uniformLayers(double minz, double maxz, double height) {
+    assert(height > 0);
+
+    // Compute each height from its index rather than by accumulation so that
+    // rounding error does not drift across thousands of layers.
+    std::vector<double> zs;
+    for (int i = 0; minz + i * height <= maxz; i++) {
+        zs.push_back(minz + i * height);
+    }
+    return zs;
+}
+
+std::vector<double> Slicer::layerSchedule(const Geometry &geometry, const LayerSettings &settings, unsigned threads) {
+    if (!settings.adaptive) return uniformLayers(geometry, settings.height);
+    trace::Scope scope{"schedule"};
+    assert(settings.minHeight > 0 && settings.minHeight <= settings.height && settings.tolerance > 0);
+    if (threads == 0) threads = hardwareThreads();
+
+    const auto &positions = geometry.positions();
+    auto [lo, hi] = std::minmax_element(positions.begin(), positions.end(), [](auto &a, auto &b) {
+        return a[2] < b[2];
+    });
+    const double minz = (*lo)[2], maxz = (*hi)[2];
+
+    // Bins half the thinnest layer tall, so that the histogram resolves
+    // every layer, up to about a million bins.
+    const double width = std::max(settings.minHeight / 2, (maxz - minz) / (1 << 20));
+    const size_t bins = size_t((maxz - minz) / width) + 1;
+
+    // Each worker lowers the limits of its own histogram, and the
+    // histograms are merged by taking the smallest limit in each bin.
+    const auto &faces = geometry.mesh().faces();
+    std::vector<std::vector<double>> limits(threads);
+    parallelFor(faces.size(), threads, 4096, [&](size_t begin, size_t end, unsigned worker) {
+        auto &limit = limits[worker];
+        if (limit.empty()) limit.assign(bins, settings.height);
+        for (size_t i = begin; i < end; i++) {
+            auto v = faces[i].vertices();
+            const auto &a = positions[v[0]->index], &b = positions[v[1]->index], &c = positions[v[2]->index];
+            std::array<double, 3> u{b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            std::array<double, 3> w{c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            std::array<double, 3> n{u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0]};
+            double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0) continue;
+
+            // Walls that allow the thickest layer leave the bins alone,
+            // which skips most of the faces that span many bins.
+            double cusp = std::abs(n[2]) / length;
+            if (cusp * settings.height <= settings.tolerance) continue;
+            double height = std::max(settings.minHeight, settings.tolerance / cusp);
+
+            double zlo = std::min({a[2], b[2], c[2]}), zhi = std::max({a[2], b[2], c[2]});
+            size_t first = size_t((zlo - minz) / width), last = std::min(bins - 1, size_t((zhi - minz) / width));
+            for (size_t bin = first; bin <= last; bin++) limit[bin] = std::min(limit[bin], height);
+        }
+    });
+    std::vector<double> limit(bins, settings.height);
+    for (const auto &worker: limits) {
+        for (size_t bin = 0; bin < worker.size(); bin++) limit[bin] = std::min(limit[bin], worker[bin]);
+    }
+
+    // Each layer is as thick as the tightest limit among the bins it
+    // reaches into allows.
+    std::vector<double> zs;
+    for (double z = minz; z <= maxz;) {
+        zs.push_back(z);
+        double height = settings.height;
+        for (size_t bin = size_t((z - minz) / width); bin < bins && minz + bin * width < z + height; bin++) {
+            height = std::min(height, limit[bin]);
+        }
+        z += height;
+    }
+    return zs;
+}
+
+void Slicer::sliceLayers(const Geometry &geometry, const std::vector<double> &zs, const LayerCallback &emit,
+                         Diagnostics *diagnostics) {
+    IncrementalSlicer slicer{geometry};
+
+    for (size_t i = 0; i < zs.size(); i++) {
+        emit(i, zs[i], slicer.advance(zs[i]));
+
+        if (diagnostics) {
+            for (Diagnostic d: slicer.diagnostics()) {
+                d.layer = i;
+                diagnostics->push_back(d);
             }
-       
-            std::vector<Slicer::Intersection> next{next_set.begin(), next_set.end()};
-            if (next.size() != 2) {
-                std::cout << "warning: ambiguous case: " << next.size() << std::endl;
+        }
+    }
+}
+
+void Slicer::sliceLayers(const Geometry &geometry, const std::vector<double> &zs, const LayerCallback &emit,
+                         unsigned threads, const LayerCallback &process, Diagnostics *diagnostics) {
+    if (threads == 0) threads = hardwareThreads();
+
+    if (threads == 1) {
+        sliceLayers(geometry, zs, [&](int i, double z, const Polygons &polygons) {
+            if (process) process(i, z, polygons);
+            emit(i, z, polygons);
+        }, diagnostics);
+        return;
+    }
+
+    // Workers reach layers out of order, so a single sweep cannot be shared
+    // between them. Each layer instead queries the interval tree, which costs
+    // the same O(log n + k) per layer without any ordering constraint.
+    std::vector<std::unique_ptr<Section>> sections;
+    sliceLayers(geometry, faceTree(geometry), sections, zs, emit, threads, process, diagnostics);
+}
+
+void Slicer::sliceLayers(const Geometry &geometry, const IntervalTree &tree,
+                         std::vector<std::unique_ptr<Section>> &sections, const std::vector<double> &zs,
+                         const LayerCallback &emit, unsigned threads, const LayerCallback &process,
+                         Diagnostics *diagnostics) {
+    if (threads == 0) threads = hardwareThreads();
+    if (sections.size() < threads) sections.resize(threads);
+    LayerQueue queue{zs, emit, diagnostics};
+
+    parallelFor(zs.size(), threads, 1, [&](size_t begin, size_t end, unsigned worker) {
+        if (!sections[worker]) {
+            sections[worker] = std::make_unique<Section>(geometry);
+        }
+        Section &section = *sections[worker];
+
+        for (size_t i = begin; i < end; i++) {
+            const Polygons &polygons = sliceLayer(geometry, tree, zs[i], section);
+            if (process) process(i, zs[i], polygons);
+            queue.finish(i, polygons, section.diagnostics());
+        }
+    });
+    queue.sortDiagnostics();
+}
+
+void Slicer::sliceBatch(const Geometry &geometry, const std::vector<double> &zs, const LayerCallback &emit,
+                        unsigned threads, Diagnostics *diagnostics) {
+    if (threads == 0) threads = hardwareThreads();
+
+    SoaMesh<double> mesh{geometry};
+    const size_t layers = zs.size();
+
+    // The faces are split into one contiguous block per worker. Each block
+    // counts the segments it will put in every layer first, so that all
+    // layers share one flat array and each block writes its own disjoint
+    // slots of each bucket, in ascending face order, without locking. A face
+    // adds one to each layer in a contiguous range, which a difference array
+    // records in O(1).
+    const size_t blockSize = (mesh.faceCount() + threads - 1) / threads;
+    std::vector<std::vector<long>> counts(threads, std::vector<long>(layers + 1));
+    parallelFor(threads, threads, 1, [&](size_t block, size_t, unsigned) {
+        size_t end = std::min(mesh.faceCount(), (block + 1) * blockSize);
+        for (size_t f = block * blockSize; f < end; f++) {
+            size_t first, last;
+            spannedPlanes(mesh, f, zs.data(), layers, first, last);
+            counts[block][first]++;
+            counts[block][last]--;
+        }
+    });
+
+    std::vector<size_t> offsets(layers + 1);
+    std::vector<std::vector<size_t>> cursors(threads, std::vector<size_t>(layers));
+    std::vector<long> count(threads);
+    for (size_t i = 0; i < layers; i++) {
+        offsets[i + 1] = offsets[i];
+        for (unsigned block = 0; block < threads; block++) {
+            count[block] += counts[block][i];
+            cursors[block][i] = offsets[i + 1];
+            offsets[i + 1] += count[block];
+        }
+    }
+
+    // Each block runs the kernel over short runs of faces, whose segments
+    // stay in cache, and scatters them into the buckets. Only what chaining
+    // needs is kept: the entry point is only needed where a contour starts
+    // and is cheap to recompute there.
+    struct Crossed {
+        uint32_t face;
+        uint8_t entry, exit;
+        Point point;
+    };
+    std::unique_ptr<Crossed[]> segments{new Crossed[offsets[layers]]};
+    parallelFor(threads, threads, 1, [&](size_t block, size_t, unsigned) {
+        trace::Scope scope{"intersect"};
+        std::vector<Segment<double>> found;
+        auto &cursor = cursors[block];
+        size_t end = std::min(mesh.faceCount(), (block + 1) * blockSize);
+        for (size_t f = block * blockSize; f < end; f += 256) {
+            found.clear();
+            intersectSpans(mesh, f, std::min(end, f + 256), zs.data(), layers, found);
+            for (const auto &segment: found) {
+                segments[cursor[segment.plane]++] = {segment.face, segment.entry, segment.exit, {segment.x1, segment.y1}};
             }
-            auto n1 = next[0];
-            auto n2 = next[1];
-            edges.erase(e);
-
-            if (edges.find(n1) != edges.end()) {
-                polygon.push_back(points.find(n1)->second);
-                build_polygon(n1);
-            } else if (edges.find(n2) != edges.end()) {
-                polygon.push_back(points.find(n2)->second);
-                build_polygon(n2);
-            } else if (n1 != first && n2 != first) {
-                assert ("error: unconnected loop");
+        }
+    });
+
+    const auto &faces = geometry.mesh().faces();
+    std::vector<std::unique_ptr<Section>> sections(threads);
+    LayerQueue queue{zs, emit, diagnostics};
+
+    parallelFor(layers, threads, 1, [&](size_t begin, size_t end, unsigned worker) {
+        if (!sections[worker]) {
+            sections[worker] = std::make_unique<Section>(geometry);
+            sections[worker]->exitPoints_.resize(faces.size());
+        }
+        Section &section = *sections[worker];
+
+        for (size_t i = begin; i < end; i++) {
+            section.begin(zs[i]);
+            section.cached_ = true;
+            for (size_t k = offsets[i]; k < offsets[i + 1]; k++) {
+                const Crossed &segment = segments[k];
+                auto halfedges = faces[segment.face].halfedges();
+                section.entries_[segment.face] = halfedges[segment.entry];
+                section.exits_[segment.face] = halfedges[segment.exit];
+                section.exitPoints_[segment.face] = segment.point;
+                section.crossed_.push_back(segment.face);
             }
-        };
 
-        polygon.push_back(points.find(first)->second);
-        build_polygon(e);
-        polygon.push_back(points.find(first)->second);
+            queue.finish(i, computeContours(section), section.diagnostics());
+        }
+    });
+    queue.sortDiagnostics();
+}
+
+IntervalTree Slicer::faceTree(const Geometry &geometry) {
+    std::vector<double> zmin, zmax;
+    faceRanges(geometry, zmin, zmax);
+    return IntervalTree{zmin, zmax};
+}
+
+const Slicer::Polygons& Slicer::sliceLayer(const Geometry &geometry, const IntervalTree &tree, double z, Section &section) {
+    const auto &faces = geometry.mesh().faces();
+    section.faces_.clear();
+    tree.stab(z, [&](int i) {
+        section.faces_.push_back(&faces[i]);
+    });
+
+    sliceTriangles(geometry, z, section.faces_, section);
+    return computeContours(section);
+}
+
+Slicer::Polygons Slicer::sliceLayer(const Geometry &geometry, const IntervalTree &tree, double z) {
+    Section section{geometry};
+    return sliceLayer(geometry, tree, z, section);
+}
 
-        polygons.push_back(polygon);
+void Slicer::sliceTriangles(const Geometry &geometry, double z, Section &section) {
+    trace::Scope scope{"intersect"};
+    section.begin(z);
+    for (const Face &face: geometry.mesh().faces()) {
+        if (section.classify(face)) section.crossed_.push_back(face.index);
     }
+}
 
-    return polygons;
+void Slicer::sliceTriangles([[maybe_unused]] const Geometry &geometry, double z, const std::vector<const Face*> &faces,
+                            Section &section) {
+    trace::Scope scope{"intersect"};
+    section.begin(z);
+    for (const Face *face: faces) {
+        if (section.classify(*face)) section.crossed_.push_back(face->index);
+    }
+}
+
+const Slicer::Polygons& Slicer::computeContours(Section &section) {
+    trace::Scope scope{"contour"};
+    trace::count("segments", section.crossed_.size());
+    // Last layer's polygons go back on the spare stack in reverse, so each
+    // contour reuses the buffer of the contour in the same position below
+    // it, which is usually about the same length.
+    for (auto it = section.polygons_.rbegin(); it != section.polygons_.rend(); it++) {
+        section.spare_.push_back(std::move(*it));
+    }
+    section.polygons_.clear();
+    section.diagnostics_.clear();
+
+    // Contours start from their lowest-indexed face, so they come out in the
+    // same order however the faces of the layer were enumerated.
+    if (!std::is_sorted(section.crossed_.begin(), section.crossed_.end())) {
+        std::sort(section.crossed_.begin(), section.crossed_.end());
+    }
+
+    const auto &faces = section.geometry_->mesh().faces();
+    for (int index: section.crossed_) {
+        if (section.visited_[index] == section.stamp_) continue;
+        const Face &first = faces[index];
+
+        Polygon &polygon = section.addPolygon();
+        polygon.push_back(section.crossing(*section.entries_[index]->edge));
+        bool closed = section.walk(&first, true, polygon);
+
+        // A contour that runs into the boundary is only half found; the rest
+        // lies behind the face it started from.
+        if (!closed) {
+            std::reverse(polygon.begin(), polygon.end());
+            section.walk(&first, false, polygon);
+            std::reverse(polygon.begin(), polygon.end());
+        }
+
+        size_t distinct = closed ? polygon.size() - 1 : polygon.size();
+        if (distinct < 3) {
+            section.diagnostics_.push_back({Diagnostic::CollapsedContour, -1, index, distinct});
+            section.spare_.push_back(std::move(polygon));
+            section.polygons_.pop_back();
+        } else if (!closed) {
+            section.diagnostics_.push_back({Diagnostic::OpenContour, -1, index, distinct});
+        }
+    }
+
+    trace::count("contours", section.polygons_.size());
+    return section.polygons_;
+}
+
+Slicer::Section::Section(const Geometry &geometry):
+    geometry_{&geometry},
+    visited_(geometry.mesh().faces().size()),
+    entries_(geometry.mesh().faces().size()),
+    exits_(geometry.mesh().faces().size()) {}
+
+void Slicer::Section::begin(double z) {
+    // Stamps only wrap after 2^32 layers, at which point every face is
+    // cleared explicitly once.
+    if (++stamp_ == 0) {
+        std::fill(visited_.begin(), visited_.end(), 0);
+        stamp_ = 1;
+    }
+    z_ = z;
+    cached_ = false;
+    crossed_.clear();
+}
+
+bool Slicer::Section::classify(const Face &face) {
+    // A crossed face has one half-edge running down through the plane, its
+    // entry, and one running up, its exit.
+    auto halfedges = face.halfedges();
+    bool up[3] = {above(halfedges[0]->vertex), above(halfedges[1]->vertex), above(halfedges[2]->vertex)};
+
+    const HalfEdge *entry = nullptr, *exit = nullptr;
+    for (int i = 0; i < 3; i++) {
+        if (up[i] && !up[(i + 1) % 3]) entry = halfedges[i];
+        if (!up[i] && up[(i + 1) % 3]) exit = halfedges[i];
+    }
+    entries_[face.index] = entry;
+    exits_[face.index] = exit;
+    return entry != nullptr;
+}
+
+Slicer::Point Slicer::Section::crossing(const Edge &edge) const {
+    const auto &positions = geometry_->positions();
+    const Geometry::Point *lo = &positions[edge.halfedge->vertex->index];
+    const Geometry::Point *hi = &positions[edge.halfedge->next->vertex->index];
+    if ((*lo)[2] >= z_) std::swap(lo, hi);
+
+    // A vertex on the plane is returned exactly, so that the crossings of
+    // all the edges around it coincide.
+    if ((*hi)[2] == z_) return {(*hi)[0], (*hi)[1]};
+
+    double s = (z_ - (*lo)[2]) / ((*hi)[2] - (*lo)[2]);
+    return {
+        (*lo)[0] + s * ((*hi)[0] - (*lo)[0]),
+        (*lo)[1] + s * ((*hi)[1] - (*lo)[1]),
+    };
+}
+
+Slicer::Point Slicer::Section::exitPoint(int face) const {
+    return cached_ ? exitPoints_[face] : crossing(*exits_[face]->edge);
+}
+
+bool Slicer::Section::walk(const Face *face, bool forward, Polygon &polygon) {
+    // Each step leaves a face through one crossed edge and enters the face
+    // across it, whose other crossed edge is the next step. Coincident
+    // points, where the contour passes through a vertex, are merged.
+    while (true) {
+        visited_[face->index] = stamp_;
+        const HalfEdge *h = forward ? exits_[face->index] : entries_[face->index];
+        Point p = forward ? exitPoint(face->index) : crossing(*h->edge);
+        if (polygon.back() != p) polygon.push_back(p);
+
+        if (h->onBoundary) return false;
+        face = h->twin->face;
+        if (visited_[face->index] == stamp_) return true;
+    }
+}
+
+Slicer::Polygon& Slicer::Section::addPolygon() {
+    if (spare_.empty()) {
+        polygons_.emplace_back();
+    } else {
+        polygons_.push_back(std::move(spare_.back()));
+        spare_.pop_back();
+        polygons_.back().clear();
+    }
+    return polygons_.back();
+}
+
+IncrementalSlicer::IncrementalSlicer(const Geometry &geometry):
+    geometry_{geometry},
+    section_{geometry},
+    order_(geometry.positions().size()),
+    marks_(geometry.mesh().faces().size()),
+    crossed_(geometry.mesh().faces().size()) {
+    const auto &positions = geometry.positions();
+    for (size_t i = 0; i < order_.size(); i++) order_[i] = i;
+    std::sort(order_.begin(), order_.end(), [&](int a, int b) {
+        return positions[a][2] < positions[b][2];
+    });
+
+    // Nothing is crossed below the mesh, where every vertex is above.
+    section_.z_ = -std::numeric_limits<double>::infinity();
+}
+
+const Slicer::Polygons& IncrementalSlicer::advance(double z) {
+    update(z);
+    return Slicer::computeContours(section_);
+}
+
+void IncrementalSlicer::rewind() {
+    for (int f: section_.crossed_) crossed_[f] = 0;
+    section_.crossed_.clear();
+    section_.z_ = -std::numeric_limits<double>::infinity();
+    next_ = 0;
+}
+
+void IncrementalSlicer::update(double z) {
+    trace::Scope scope{"intersect"};
+    assert(z >= section_.z_);
+    Slicer::Section &section = section_;
+    const auto &positions = geometry_.positions();
+    const auto &vertices = geometry_.mesh().vertices();
+    const auto &faces = geometry_.mesh().faces();
+
+    if (++section.stamp_ == 0) {
+        std::fill(section.visited_.begin(), section.visited_.end(), 0);
+        section.stamp_ = 1;
+    }
+    if (++stamp_ == 0) {
+        std::fill(marks_.begin(), marks_.end(), 0);
+        stamp_ = 1;
+    }
+    section.z_ = z;
+
+    // The vertices that have dropped below the plane since the last layer
+    // are the only ones whose side changed, so only their faces can have
+    // started or stopped crossing it, or crossed it through other edges.
+    touched_.clear();
+    for (; next_ < order_.size() && positions[order_[next_]][2] < z; next_++) {
+        const Vertex &v = vertices[order_[next_]];
+        if (!v.halfedge) continue;
+        for (const Face *f: v.faces()) {
+            if (marks_[f->index] != stamp_) {
+                marks_[f->index] = stamp_;
+                touched_.push_back(f->index);
+            }
+        }
+    }
+
+    added_.clear();
+    bool removed = false;
+    for (int f: touched_) {
+        bool crossed = section.classify(faces[f]);
+        if (crossed && !crossed_[f]) added_.push_back(f);
+        if (!crossed && crossed_[f]) removed = true;
+        crossed_[f] = crossed;
+    }
+
+    // The crossed faces are kept sorted, which is the order computeContours
+    // wants, by merging in the few that changed rather than sorting them all.
+    auto &list = section.crossed_;
+    if (removed) {
+        list.erase(std::remove_if(list.begin(), list.end(), [&](int f) { return !crossed_[f]; }), list.end());
+    }
+    if (!added_.empty()) {
+        std::sort(added_.begin(), added_.end());
+        merged_.resize(list.size() + added_.size());
+        std::merge(list.begin(), list.end(), added_.begin(), added_.end(), merged_.begin());
+        list.swap(merged_);
+    }
 }
 
 void Slicer::exportPolygons(const Polygons &polygons, const std::string &path) {
@@ -174,36 +674,3 @@ void Slicer::exportPolygons(const Polygons &polygons, const std::string &path) {
         polygon_index += 1;
     }
 }
-
-
-void Slicer::exportPolygonsToPNG(const Polygons &polygons, const std::string &path) {
-    cairo_surface_t *surface; // Declarations
-    cairo_t *cr;
-
-    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,1920,1080);
-    cr = cairo_create(surface);
-    cairo_save(cr);
-    cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_paint(cr);
-    cairo_restore(cr);
-    cairo_translate(cr, 960, 540);
-    cairo_scale(cr, 20, 20);
-    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
-    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
-
-    for (const auto &polygon: polygons) {
-        cairo_set_source_rgb(cr, 1, 1, 1);
-        cairo_set_line_width(cr, 0.05);
-        cairo_move_to (cr, polygon[0][0], polygon[0][1]);
-        for (const auto &point: polygon) {
-            cairo_line_to (cr, point[0], point[1]);
-        }
-    }
-
-    cairo_stroke_preserve(cr);
-    cairo_fill(cr);
-
-    cairo_surface_write_to_png(surface, path.c_str());
-    cairo_surface_destroy(surface);
-    cairo_destroy(cr);
-}
@@ -0,0 +1,281 @@
+#include <StlFile.h>
+#include <Trace.h>
+#include <fstream>
+#include <stdexcept>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <filesystem>
+
+namespace {
+
+using Point = Geometry::Point;
+
+/**
+ * Welds vertices through a spatial hash. Space is divided into cubic cells
+ * four times the welding tolerance wide, and each vertex is stored in the
+ * cell that contains it. A vertex can only lie within tolerance of vertices
+ * in its own cell and in neighbouring cells it is within tolerance of, so a
+ * lookup probes one cell in the common case and at most eight.
+ */
+class VertexWelder {
+public:
+    VertexWelder(double epsilon, std::vector<Point> &positions):
+        epsilon_{epsilon}, cell_{4 * epsilon}, positions_{positions}, slots_(1024) {}
+
+    // Returns the index of a vertex within tolerance of p, adding p as a new
+    // vertex if there is none.
+    int insert(const Point &p) {
+        int64_t base[3];
+        int64_t offsets[3][2];
+        int counts[3];
+        for (int i = 0; i < 3; i++) {
+            if (cell_ == 0) {
+                std::memcpy(&base[i], &p[i], sizeof(double));
+                counts[i] = 1;
+                offsets[i][0] = 0;
+                continue;
+            }
+            double scaled = p[i] / cell_;
+            base[i] = std::floor(scaled);
+            double fraction = scaled - base[i];
+            counts[i] = 1;
+            offsets[i][0] = 0;
+            if (fraction < 0.25) offsets[i][counts[i]++] = -1;
+            else if (fraction > 0.75) offsets[i][counts[i]++] = 1;
+        }
+
+        for (int x = 0; x < counts[0]; x++) {
+            for (int y = 0; y < counts[1]; y++) {
+                for (int z = 0; z < counts[2]; z++) {
+                    uint64_t h = hash(base[0] + offsets[0][x], base[1] + offsets[1][y], base[2] + offsets[2][z]);
+                    for (size_t i = h & (slots_.size() - 1); slots_[i].index != -1; i = (i + 1) & (slots_.size() - 1)) {
+                        if (slots_[i].hash == h && near(positions_[slots_[i].index], p)) {
+                            return slots_[i].index;
+                        }
+                    }
+                }
+            }
+        }
+
+        int index = positions_.size();
+        positions_.push_back(p);
+        if (2 * (positions_.size() + 1) > slots_.size()) grow();
+        place({hash(base[0], base[1], base[2]), index});
+        return index;
+    }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        int index = -1;
+    };
+
+    double epsilon_;
+    double cell_;
+    std::vector<Point> &positions_;
+    std::vector<Slot> slots_;
+
+    static uint64_t hash(int64_t x, int64_t y, int64_t z) {
+        uint64_t h = x * 0x9E3779B97F4A7C15ull ^ y * 0xC2B2AE3D27D4EB4Full ^ z * 0x165667B19E3779F9ull;
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return h ^ (h >> 29);
+    }
+
+    bool near(const Point &a, const Point &b) const {
+        return std::abs(a[0] - b[0]) <= epsilon_
+            && std::abs(a[1] - b[1]) <= epsilon_
+            && std::abs(a[2] - b[2]) <= epsilon_;
+    }
+
+    void place(const Slot &slot) {
+        size_t i = slot.hash & (slots_.size() - 1);
+        while (slots_[i].index != -1) i = (i + 1) & (slots_.size() - 1);
+        slots_[i] = slot;
+    }
+
+    void grow() {
+        std::vector<Slot> old(2 * slots_.size());
+        old.swap(slots_);
+        for (auto &slot: old) {
+            if (slot.index != -1) place(slot);
+        }
+    }
+};
+
+class TriangleSink {
+public:
+    TriangleSink(double epsilon, MeshData &data): welder_{epsilon, data.positions}, faces_{data.faces} {}
+
+    void add(const Point &a, const Point &b, const Point &c) {
+        std::array<int, 3> face{welder_.insert(a), welder_.insert(b), welder_.insert(c)};
+        if (face[0] != face[1] && face[1] != face[2] && face[2] != face[0]) {
+            faces_.push_back(face);
+        }
+    }
+
+private:
+    VertexWelder welder_;
+    std::vector<std::array<int, 3>> &faces_;
+};
+
+[[noreturn]] void invalid() {
+    throw std::runtime_error("error: invalid stl file");
+}
+
+void readBinary(std::ifstream &file, uint32_t count, const TriangleCallback &sink) {
+    // Triangles are read in blocks of fixed size, so the file is never
+    // resident in memory.
+    constexpr size_t record = 50;
+    constexpr size_t block = 4096;
+    std::vector<char> buffer(record * block);
+
+    for (uint32_t done = 0; done < count;) {
+        size_t n = std::min<size_t>(block, count - done);
+        if (!file.read(buffer.data(), record * n)) invalid();
+
+        for (size_t t = 0; t < n; t++) {
+            // Each record is a normal, three vertices as little-endian
+            // floats, and a two byte attribute count.
+            float v[9];
+            std::memcpy(v, buffer.data() + t * record + 12, sizeof(v));
+            sink({v[0], v[1], v[2]}, {v[3], v[4], v[5]}, {v[6], v[7], v[8]});
+        }
+        done += n;
+    }
+}
+
+const char* parseNumber(const char *p, const char *end, double &value) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p == '+') p++;
+    auto [next, error] = std::from_chars(p, end, value);
+    if (error != std::errc{}) invalid();
+    return next;
+}
+
+void readASCII(std::ifstream &file, const TriangleCallback &sink) {
+    constexpr size_t block = 1 << 20;
+    std::vector<char> buffer(block);
+    size_t carried = 0;
+
+    Point corners[3];
+    int corner = 0;
+
+    auto parseLine = [&](const char *p, const char *end) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (end - p < 6 || std::memcmp(p, "vertex", 6) != 0) return;
+        p += 6;
+        for (int i = 0; i < 3; i++) p = parseNumber(p, end, corners[corner][i]);
+        if (++corner == 3) {
+            sink(corners[0], corners[1], corners[2]);
+            corner = 0;
+        }
+    };
+
+    while (true) {
+        file.read(buffer.data() + carried, buffer.size() - carried);
+        size_t size = carried + file.gcount();
+        bool last = size < buffer.size();
+
+        // Parse every complete line and carry the remainder into the next
+        // block. A single line longer than the block is malformed.
+        const char *p = buffer.data();
+        const char *end = buffer.data() + size;
+        while (true) {
+            const char *newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!newline) break;
+            parseLine(p, newline);
+            p = newline + 1;
+        }
+        if (last) {
+            parseLine(p, end);
+            break;
+        }
+        carried = end - p;
+        if (carried == buffer.size()) invalid();
+        std::memmove(buffer.data(), p, carried);
+    }
+
+    if (corner != 0) invalid();
+}
+
+// Opens the STL file at path and returns whether it is binary, and if so
+// its triangle count, leaving file positioned at the first triangle.
+bool openSTL(const std::string &path, std::ifstream &file, uint32_t &count) {
+    file.open(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("error: cannot open " + path);
+    }
+    uintmax_t size = std::filesystem::file_size(path);
+
+    // ASCII files begin with "solid", but so do some binary files, so a
+    // file is only taken as binary if its size matches its triangle count.
+    char header[84] = {};
+    file.read(header, sizeof(header));
+    std::memcpy(&count, header + 80, sizeof(count));
+    if (size >= 84 && size == 84 + 50 * uintmax_t{count}) return true;
+
+    if (std::strncmp(header, "solid", 5) != 0) invalid();
+    file.clear();
+    file.seekg(0);
+    return false;
+}
+
+}
+
+MeshData readSTL(const std::string &path, double epsilon) {
+    trace::Scope scope{"parse"};
+    std::ifstream file;
+    uint32_t count;
+    bool binary = openSTL(path, file, count);
+
+    MeshData data;
+    TriangleSink sink{epsilon, data};
+    auto add = [&](const Point &a, const Point &b, const Point &c) { sink.add(a, b, c); };
+    if (binary) {
+        data.positions.reserve(count / 2);
+        data.faces.reserve(count);
+        readBinary(file, count, add);
+    } else {
+        readASCII(file, add);
+    }
+    if (data.faces.empty()) {
+        throw std::runtime_error("error: no triangles in " + path);
+    }
+    return data;
+}
+
+void readSTLTriangles(const std::string &path, const TriangleCallback &fn) {
+    std::ifstream file;
+    uint32_t count;
+    if (openSTL(path, file, count)) {
+        readBinary(file, count, fn);
+    } else {
+        readASCII(file, fn);
+    }
+}
+
+void writeSTL(const std::string &path, const Geometry &geometry) {
+    std::ofstream file{path, std::ios::binary};
+    if (!file) {
+        throw std::runtime_error("error: cannot write " + path);
+    }
+
+    char header[80] = "binary stl";
+    uint32_t count = geometry.mesh().faces().size();
+    file.write(header, sizeof(header));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    for (const Face &face: geometry.mesh().faces()) {
+        char record[50] = {};
+        float v[9];
+        int i = 0;
+        for (const Vertex *vertex: face.vertices()) {
+            for (double x: geometry.positions()[vertex->index]) v[i++] = x;
+        }
+        std::memcpy(record + 12, v, sizeof(v));
+        file.write(record, sizeof(record));
+    }
+}
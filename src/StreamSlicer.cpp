@@ -0,0 +1,304 @@
+#include <StreamSlicer.h>
+#include <Trace.h>
+#include <StlFile.h>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+uint64_t bits(double x) {
+    uint64_t b;
+    std::memcpy(&b, &x, sizeof(b));
+    return b;
+}
+
+}
+
+double StreamSlicer::Triangle::zmin() const {
+    return std::min({v[2], v[5], v[8]});
+}
+
+double StreamSlicer::Triangle::zmax() const {
+    return std::max({v[2], v[5], v[8]});
+}
+
+bool StreamSlicer::before(const Triangle &a, const Triangle &b) {
+    double za = a.zmin(), zb = b.zmin();
+    return za < zb || (za == zb && a.index < b.index);
+}
+
+StreamSlicer::StreamSlicer(const std::string &path, size_t memoryCap):
+    memoryCap_{memoryCap},
+    minz_{std::numeric_limits<double>::infinity()},
+    maxz_{-std::numeric_limits<double>::infinity()} {
+    // Half of the budget holds the run being sorted. While slicing, a
+    // quarter holds the read-ahead windows of all runs and the rest the
+    // triangles spanning the plane and the contours built from them.
+    size_t runCapacity = memoryCap / 2 / sizeof(Triangle);
+    if (runCapacity == 0) {
+        throw std::runtime_error("error: a memory cap of " + std::to_string(memoryCap) + " bytes is too small");
+    }
+
+    file_ = std::tmpfile();
+    if (!file_) {
+        throw std::runtime_error("error: cannot create a spill file");
+    }
+
+    std::vector<Triangle> buffer;
+    buffer.reserve(runCapacity);
+    try {
+        readSTLTriangles(path, [&](const Geometry::Point &a, const Geometry::Point &b, const Geometry::Point &c) {
+            // Triangles with coincident corners cross no edge of their
+            // neighbours; welding drops them from a Geometry too.
+            if (a == b || b == c || c == a) return;
+
+            Triangle t{uint32_t(triangles_++), {a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2]}};
+            minz_ = std::min(minz_, t.zmin());
+            maxz_ = std::max(maxz_, t.zmax());
+            buffer.push_back(t);
+            if (buffer.size() == runCapacity) {
+                track(buffer.capacity() * sizeof(Triangle));
+                spill(buffer);
+            }
+        });
+        if (!buffer.empty()) spill(buffer);
+        if (triangles_ == 0) {
+            throw std::runtime_error("error: no triangles in " + path);
+        }
+    } catch (...) {
+        std::fclose(file_);
+        throw;
+    }
+    track(buffer.capacity() * sizeof(Triangle));
+}
+
+StreamSlicer::~StreamSlicer() {
+    std::fclose(file_);
+}
+
+void StreamSlicer::spill(std::vector<Triangle> &buffer) {
+    std::sort(buffer.begin(), buffer.end(), before);
+
+    Run run{std::ftell(file_), buffer.size(), 0, {}, 0};
+    if (std::fwrite(buffer.data(), sizeof(Triangle), buffer.size(), file_) != buffer.size()) {
+        throw std::runtime_error("error: cannot write the spill file");
+    }
+    runs_.push_back(std::move(run));
+    buffer.clear();
+}
+
+bool StreamSlicer::refill(Run &run) {
+    if (run.next == run.count) return false;
+
+    size_t n = std::min(window_, run.count - run.next);
+    run.buffer.resize(n);
+    if (std::fseek(file_, run.offset + long(run.next * sizeof(Triangle)), SEEK_SET) != 0
+        || std::fread(run.buffer.data(), sizeof(Triangle), n, file_) != n) {
+        throw std::runtime_error("error: cannot read the spill file");
+    }
+    run.next += n;
+    run.cursor = 0;
+    return true;
+}
+
+const StreamSlicer::Triangle* StreamSlicer::peek() {
+    if (heap_.empty()) return nullptr;
+    const Run &run = runs_[heap_.front()];
+    return &run.buffer[run.cursor];
+}
+
+void StreamSlicer::pop() {
+    // The heap keeps the run with the lowest next triangle at the front.
+    auto later = [&](int a, int b) {
+        return before(runs_[b].buffer[runs_[b].cursor], runs_[a].buffer[runs_[a].cursor]);
+    };
+
+    std::pop_heap(heap_.begin(), heap_.end(), later);
+    Run &run = runs_[heap_.back()];
+    if (++run.cursor == run.buffer.size() && !refill(run)) {
+        heap_.pop_back();
+    } else {
+        std::push_heap(heap_.begin(), heap_.end(), later);
+    }
+}
+
+void StreamSlicer::slice(const std::vector<double> &zs, const Slicer::LayerCallback &emit,
+                         Slicer::Diagnostics *diagnostics) {
+    window_ = std::max<size_t>(1, memoryCap_ / 4 / std::max<size_t>(1, runs_.size()) / sizeof(Triangle));
+
+    heap_.clear();
+    active_.clear();
+    for (size_t r = 0; r < runs_.size(); r++) {
+        runs_[r].next = 0;
+        std::vector<Triangle>().swap(runs_[r].buffer);
+        if (refill(runs_[r])) heap_.push_back(r);
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [&](int a, int b) {
+        return before(runs_[b].buffer[runs_[b].cursor], runs_[a].buffer[runs_[a].cursor]);
+    });
+
+    for (size_t i = 0; i < zs.size(); i++) {
+        double z = zs[i];
+
+        // A triangle crosses the plane when zmin < z <= zmax. Triangles
+        // arrive in order of zmin, so once the next one starts at or above
+        // the plane, every triangle that can cross it is resident.
+        for (const Triangle *t = peek(); t && t->zmin() < z; t = peek()) {
+            active_.push_back(*t);
+            pop();
+        }
+        active_.erase(std::remove_if(active_.begin(), active_.end(), [&](const Triangle &t) {
+            return t.zmax() < z;
+        }), active_.end());
+
+        sliceLayer(z);
+        if (track() > memoryCap_) {
+            throw std::runtime_error("error: the " + std::to_string(active_.size())
+                + " triangles spanning z = " + std::to_string(z) + " do not fit in the memory cap");
+        }
+
+        emit(i, z, polygons_);
+        if (diagnostics) {
+            for (Slicer::Diagnostic d: diagnostics_) {
+                d.layer = i;
+                diagnostics->push_back(d);
+            }
+        }
+    }
+}
+
+void StreamSlicer::sliceLayer(double z) {
+    trace::Scope scope{"contour"};
+    crossings_.clear();
+    for (size_t n = 0; n < active_.size(); n++) {
+        const Triangle &t = active_[n];
+        bool up[3] = {t.v[2] >= z, t.v[5] >= z, t.v[8] >= z};
+        if (up[0] == up[1] && up[1] == up[2]) continue;
+
+        // As in Slicer::Section, the entry edge runs from above the plane
+        // to below it and the exit edge back, and a crossing at a vertex on
+        // the plane is that vertex exactly.
+        Crossing c{t.index, uint32_t(n), 0, 0, {}, {}};
+        for (int i = 0; i < 3; i++) {
+            int j = (i + 1) % 3;
+            if (up[i] == up[j]) continue;
+
+            const double *lo = &t.v[3 * (up[i] ? j : i)];
+            const double *hi = &t.v[3 * (up[i] ? i : j)];
+            Slicer::Point p{hi[0], hi[1]};
+            if (hi[2] != z) {
+                double s = (z - lo[2]) / (hi[2] - lo[2]);
+                p = {lo[0] + s * (hi[0] - lo[0]), lo[1] + s * (hi[1] - lo[1])};
+            }
+            if (up[i]) {
+                c.entry = i;
+                c.entryPoint = p;
+            } else {
+                c.exit = i;
+                c.exitPoint = p;
+            }
+        }
+        crossings_.push_back(c);
+    }
+
+    // Contours start from their lowest-indexed triangle, as in Slicer.
+    std::sort(crossings_.begin(), crossings_.end(), [](auto &a, auto &b) { return a.index < b.index; });
+
+    // Each crossed edge is the exit of one triangle and the entry of the
+    // next, so two open-addressed tables, one keyed by entry edge and one
+    // by exit edge, link every segment to its neighbours.
+    size_t size = 16;
+    while (size < 2 * crossings_.size()) size *= 2;
+    byEntry_.assign(size, -1);
+    byExit_.assign(size, -1);
+    for (size_t k = 0; k < crossings_.size(); k++) {
+        for (bool entry: {true, false}) {
+            auto &table = entry ? byEntry_ : byExit_;
+            EdgeKey edge = key(crossings_[k], entry);
+            if (find(table, edge, entry) != -1) continue;
+
+            size_t slot = hash(edge) & (size - 1);
+            while (table[slot] != -1) slot = (slot + 1) & (size - 1);
+            table[slot] = k;
+        }
+    }
+
+    polygons_.clear();
+    diagnostics_.clear();
+    visited_.assign(crossings_.size(), 0);
+    for (size_t k = 0; k < crossings_.size(); k++) {
+        if (visited_[k]) continue;
+
+        Slicer::Polygon polygon{crossings_[k].entryPoint};
+        bool closed = walk(k, true, polygon);
+        if (!closed) {
+            std::reverse(polygon.begin(), polygon.end());
+            walk(k, false, polygon);
+            std::reverse(polygon.begin(), polygon.end());
+        }
+
+        int face = crossings_[k].index;
+        size_t distinct = closed ? polygon.size() - 1 : polygon.size();
+        if (distinct < 3) {
+            diagnostics_.push_back({Slicer::Diagnostic::CollapsedContour, -1, face, distinct});
+            continue;
+        } else if (!closed) {
+            diagnostics_.push_back({Slicer::Diagnostic::OpenContour, -1, face, distinct});
+        }
+        polygons_.push_back(std::move(polygon));
+    }
+}
+
+StreamSlicer::EdgeKey StreamSlicer::key(const Crossing &c, bool entry) const {
+    // The entry edge starts above the plane and the exit edge below it.
+    const double *v = active_[c.triangle].v;
+    int i = entry ? c.entry : c.exit;
+    const double *lo = &v[3 * (entry ? (i + 1) % 3 : i)];
+    const double *hi = &v[3 * (entry ? i : (i + 1) % 3)];
+    return {bits(lo[0]), bits(lo[1]), bits(lo[2]), bits(hi[0]), bits(hi[1]), bits(hi[2])};
+}
+
+size_t StreamSlicer::hash(const EdgeKey &key) {
+    uint64_t h = 0;
+    for (uint64_t k: key) h = (h ^ k) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 32);
+}
+
+int StreamSlicer::find(const std::vector<int> &table, const EdgeKey &edge, bool entry) const {
+    size_t size = table.size();
+    for (size_t slot = hash(edge) & (size - 1); table[slot] != -1; slot = (slot + 1) & (size - 1)) {
+        if (key(crossings_[table[slot]], entry) == edge) return table[slot];
+    }
+    return -1;
+}
+
+bool StreamSlicer::walk(int k, bool forward, Slicer::Polygon &polygon) {
+    while (true) {
+        visited_[k] = 1;
+        const Crossing &c = crossings_[k];
+        const Slicer::Point &p = forward ? c.exitPoint : c.entryPoint;
+        if (polygon.back() != p) polygon.push_back(p);
+
+        k = forward ? find(byEntry_, key(c, false), true) : find(byExit_, key(c, true), false);
+        if (k == -1) return false;
+        if (visited_[k]) return true;
+    }
+}
+
+size_t StreamSlicer::track(size_t extra) {
+    size_t bytes = extra;
+    for (const Run &run: runs_) bytes += sizeof(Run) + run.buffer.capacity() * sizeof(Triangle);
+    bytes += heap_.capacity() * sizeof(int);
+    bytes += active_.capacity() * sizeof(Triangle);
+    bytes += crossings_.capacity() * sizeof(Crossing);
+    bytes += (byEntry_.capacity() + byExit_.capacity()) * sizeof(int);
+    bytes += visited_.capacity();
+    bytes += polygons_.capacity() * sizeof(Slicer::Polygon);
+    for (const auto &polygon: polygons_) bytes += polygon.capacity() * sizeof(Slicer::Point);
+    bytes += diagnostics_.capacity() * sizeof(Slicer::Diagnostic);
+
+    peak_ = std::max(peak_, bytes);
+    return bytes;
+}
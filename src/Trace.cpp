@@ -0,0 +1,229 @@
+#include <Trace.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> recording{false};
+const Clock::time_point epoch = Clock::now();
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+struct Event {
+    const char *name;
+    int64_t start;
+    int64_t duration;
+};
+
+// The events and counters of one thread at a time. The mutex is only ever
+// contended while the log is being read.
+struct Log {
+    std::mutex mutex;
+    uint32_t thread = 0;
+    std::vector<Event> events;
+    std::vector<std::pair<const char*, int64_t>> counters;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Log>> logs;
+    std::vector<Log*> idle;
+};
+
+Registry& registry() {
+    static Registry registry;
+    return registry;
+}
+
+// Holds the log of the current thread, returning it for reuse when the
+// thread exits.
+struct Claim {
+    Log *log = nullptr;
+
+    ~Claim() {
+        if (!log) return;
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock{r.mutex};
+        r.idle.push_back(log);
+    }
+};
+
+Log& threadLog() {
+    thread_local Claim claim;
+    if (!claim.log) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock{r.mutex};
+        if (r.idle.empty()) {
+            r.logs.push_back(std::make_unique<Log>());
+            r.logs.back()->thread = r.logs.size();
+            claim.log = r.logs.back().get();
+        } else {
+            claim.log = r.idle.back();
+            r.idle.pop_back();
+        }
+    }
+    return *claim.log;
+}
+
+// Calls fn on every log in turn while holding its lock.
+template <typename F>
+void eachLog(F &&fn) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock{r.mutex};
+    for (auto &log: r.logs) {
+        std::lock_guard<std::mutex> logLock{log->mutex};
+        fn(*log);
+    }
+}
+
+// Switches a stream to fixed-point numbers for as long as it lives.
+class FixedPoint {
+public:
+    explicit FixedPoint(std::ostream &out): out_{out}, flags_{out.flags()}, precision_{out.precision()} {
+        out << std::fixed << std::setprecision(3);
+    }
+    ~FixedPoint() {
+        out_.flags(flags_);
+        out_.precision(precision_);
+    }
+
+private:
+    std::ostream &out_;
+    std::ios::fmtflags flags_;
+    std::streamsize precision_;
+};
+
+void writeString(std::ostream &out, const std::string &s) {
+    out << '"';
+    for (char c: s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+}
+
+namespace trace {
+
+void enable(bool enabled) {
+    recording.store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return recording.load(std::memory_order_relaxed);
+}
+
+void reset() {
+    eachLog([](Log &log) {
+        log.events.clear();
+        log.counters.clear();
+    });
+}
+
+void count(const char *name, int64_t delta) {
+    if (!enabled()) return;
+    Log &log = threadLog();
+    std::lock_guard<std::mutex> lock{log.mutex};
+    for (auto &counter: log.counters) {
+        if (counter.first == name || std::strcmp(counter.first, name) == 0) {
+            counter.second += delta;
+            return;
+        }
+    }
+    log.counters.emplace_back(name, delta);
+}
+
+Scope::Scope(const char *name): name_{name}, start_{enabled() ? now() : -1} {}
+
+Scope::~Scope() {
+    if (start_ < 0) return;
+    int64_t end = now();
+    Log &log = threadLog();
+    std::lock_guard<std::mutex> lock{log.mutex};
+    log.events.push_back({name_, start_, end - start_});
+}
+
+Summary summarize() {
+    std::map<std::string, StageSummary> stages;
+    std::map<std::string, int64_t> counters;
+    eachLog([&](Log &log) {
+        for (const Event &event: log.events) {
+            StageSummary &stage = stages[event.name];
+            double ms = event.duration / 1e6;
+            stage.calls++;
+            stage.totalMs += ms;
+            stage.maxMs = std::max(stage.maxMs, ms);
+        }
+        for (const auto &counter: log.counters) counters[counter.first] += counter.second;
+    });
+
+    Summary summary;
+    for (auto &[name, stage]: stages) {
+        stage.name = name;
+        summary.stages.push_back(stage);
+    }
+    summary.counters.assign(counters.begin(), counters.end());
+    return summary;
+}
+
+void writeJSON(std::ostream &out) {
+    Summary summary = summarize();
+    FixedPoint fixed{out};
+    out << "{\n  \"stages\": {";
+    for (size_t i = 0; i < summary.stages.size(); i++) {
+        const StageSummary &stage = summary.stages[i];
+        out << (i ? ",\n    " : "\n    ");
+        writeString(out, stage.name);
+        out << ": {\"calls\": " << stage.calls << ", \"total_ms\": " << stage.totalMs
+            << ", \"max_ms\": " << stage.maxMs << "}";
+    }
+    out << "\n  },\n  \"counters\": {";
+    for (size_t i = 0; i < summary.counters.size(); i++) {
+        out << (i ? ",\n    " : "\n    ");
+        writeString(out, summary.counters[i].first);
+        out << ": " << summary.counters[i].second;
+    }
+    out << "\n  }\n}\n";
+}
+
+void writeChromeTrace(std::ostream &out) {
+    bool first = true;
+    int64_t last = 0;
+    FixedPoint fixed{out};
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    eachLog([&](Log &log) {
+        for (const Event &event: log.events) {
+            out << (first ? "\n" : ",\n") << "{\"name\": ";
+            writeString(out, event.name);
+            out << ", \"cat\": \"stage\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << log.thread
+                << ", \"ts\": " << event.start / 1e3 << ", \"dur\": " << event.duration / 1e3 << "}";
+            first = false;
+            last = std::max(last, event.start + event.duration);
+        }
+    });
+    for (const auto &[name, value]: summarize().counters) {
+        out << (first ? "\n" : ",\n") << "{\"name\": ";
+        writeString(out, name);
+        out << ", \"ph\": \"C\", \"pid\": 1, \"ts\": " << last / 1e3 << ", \"args\": {\"value\": " << value << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+}
+
+}
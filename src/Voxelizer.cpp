@@ -0,0 +1,239 @@
+#include <Voxelizer.h>
+#include <Slicer.h>
+#include <Parallel.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+using Point = Geometry::Point;
+
+Point subtract(const Point &a, const Point &b) {
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+Point cross(const Point &a, const Point &b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+double dot(const Point &a, const Point &b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// The projections of a triangle onto the separating axes that are not box
+// normals, computed once per triangle. Against a box with center c, the
+// triangle projects onto axis a as [lo - a.c, hi - a.c] and the box as
+// [-r, r], where r is the dot product of |a| with the box's half extents.
+class TriangleAxes {
+public:
+    TriangleAxes(const std::array<Point, 3> &t, const Point &halfSize) {
+        const Point edges[3] = {subtract(t[1], t[0]), subtract(t[2], t[1]), subtract(t[0], t[2])};
+        add(cross(edges[0], edges[1]), t, halfSize);
+        for (const Point &e: edges) {
+            add({0, -e[2], e[1]}, t, halfSize);
+            add({e[2], 0, -e[0]}, t, halfSize);
+            add({-e[1], e[0], 0}, t, halfSize);
+        }
+    }
+
+    // The normal comes first: for a triangle much larger than a voxel it
+    // rejects most of the voxels in its bounds.
+    bool overlaps(const Point &center) const {
+        for (int i = 0; i < 10; i++) {
+            double d = dot(axes_[i], center);
+            if (lo_[i] - d > r_[i] || hi_[i] - d < -r_[i]) return false;
+        }
+        return true;
+    }
+
+private:
+    // A zero axis, from an edge parallel to a box normal or a degenerate
+    // triangle, projects everything to 0 and separates nothing.
+    void add(const Point &axis, const std::array<Point, 3> &t, const Point &halfSize) {
+        double p0 = dot(axis, t[0]), p1 = dot(axis, t[1]), p2 = dot(axis, t[2]);
+        axes_[n_] = axis;
+        lo_[n_] = std::min({p0, p1, p2});
+        hi_[n_] = std::max({p0, p1, p2});
+        r_[n_] = halfSize[0] * std::abs(axis[0]) + halfSize[1] * std::abs(axis[1]) + halfSize[2] * std::abs(axis[2]);
+        n_++;
+    }
+
+    Point axes_[10];
+    double lo_[10], hi_[10], r_[10];
+    int n_ = 0;
+};
+
+}
+
+size_t VoxelLayout::bytes() const {
+    return size_t(nz) * ny * ((nx + 7) / 8);
+}
+
+VoxelLayout voxelLayout(const Geometry &geometry, const VoxelSettings &settings) {
+    assert(!geometry.positions().empty());
+    Point lo = geometry.positions().front(), hi = lo;
+    for (const Point &p: geometry.positions()) {
+        for (int axis = 0; axis < 3; axis++) {
+            lo[axis] = std::min(lo[axis], p[axis]);
+            hi[axis] = std::max(hi[axis], p[axis]);
+        }
+    }
+
+    VoxelLayout layout;
+    layout.origin = lo;
+    double longest = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+    if (settings.size > 0) {
+        layout.size = settings.size;
+    } else if (longest > 0) {
+        assert(settings.resolution > 0);
+        layout.size = longest / settings.resolution;
+    }
+
+    int *counts[3] = {&layout.nx, &layout.ny, &layout.nz};
+    for (int axis = 0; axis < 3; axis++) {
+        *counts[axis] = std::max(1, int(std::ceil((hi[axis] - lo[axis]) / layout.size)));
+    }
+    return layout;
+}
+
+VoxelGrid::VoxelGrid(const VoxelLayout &layout): layout_{layout}, layers_(layout.nz) {
+    for (Mask &layer: layers_) {
+        layer.width = layout.nx;
+        layer.height = layout.ny;
+        layer.bits = 1;
+        layer.stride = (layout.nx + 7) / 8;
+        layer.data.assign(layer.stride * layer.height, 0);
+    }
+}
+
+void VoxelGrid::set(int x, int y, int z) {
+    Mask &layer = layers_[z];
+    layer.data[y * layer.stride + (x >> 3)] |= 0x80 >> (x & 7);
+}
+
+Geometry::Point VoxelGrid::center(int x, int y, int z) const {
+    const double s = layout_.size;
+    return {
+        layout_.origin[0] + (x + 0.5) * s,
+        layout_.origin[1] + (y + 0.5) * s,
+        layout_.origin[2] + (z + 0.5) * s,
+    };
+}
+
+size_t VoxelGrid::count() const {
+    // Bits past the end of a row are never set, so whole bytes are counted.
+    size_t count = 0;
+    for (const Mask &layer: layers_) {
+        const uint8_t *data = layer.data.data();
+        size_t size = layer.data.size(), i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            count += __builtin_popcountll(word);
+        }
+        for (; i < size; i++) count += __builtin_popcount(data[i]);
+    }
+    return count;
+}
+
+double VoxelGrid::volume() const {
+    const double s = layout_.size;
+    return count() * s * s * s;
+}
+
+bool triangleOverlapsBox(const Geometry::Point &center, const Geometry::Point &halfSize,
+                         const std::array<Geometry::Point, 3> &triangle) {
+    // The box normals reduce to comparing bounds.
+    for (int axis = 0; axis < 3; axis++) {
+        double lo = std::min({triangle[0][axis], triangle[1][axis], triangle[2][axis]});
+        double hi = std::max({triangle[0][axis], triangle[1][axis], triangle[2][axis]});
+        if (lo - center[axis] > halfSize[axis] || hi - center[axis] < -halfSize[axis]) return false;
+    }
+    return TriangleAxes{triangle, halfSize}.overlaps(center);
+}
+
+bool triangleOverlapsBox(const Geometry::Point &center, double halfSize,
+                         const std::array<Geometry::Point, 3> &triangle) {
+    return triangleOverlapsBox(center, {halfSize, halfSize, halfSize}, triangle);
+}
+
+VoxelGrid voxelize(const Geometry &geometry, const VoxelSettings &settings) {
+    const VoxelLayout layout = voxelLayout(geometry, settings);
+    VoxelGrid grid{layout};
+    const double size = layout.size;
+
+    // Layer k is the mask of the slice through the voxel centers at height
+    // k + 0.5, rasterized with one pixel per voxel.
+    if (settings.solid) {
+        RasterSettings raster;
+        raster.width = layout.nx;
+        raster.height = layout.ny;
+        raster.pitch = size;
+        raster.centerX = layout.origin[0] + layout.nx * size / 2;
+        raster.centerY = layout.origin[1] + layout.ny * size / 2;
+        raster.bits = 1;
+
+        std::vector<double> zs(layout.nz);
+        for (int k = 0; k < layout.nz; k++) zs[k] = layout.origin[2] + (k + 0.5) * size;
+        Slicer::sliceLayers(geometry, zs, [](int, double, const Slicer::Polygons &) {}, settings.threads,
+                            [&](int k, double, const Slicer::Polygons &polygons) {
+            rasterize(polygons, raster, grid.layer(k));
+        });
+    }
+
+    if (!settings.shell) return grid;
+
+    auto index = [&](double v, int axis, int n) {
+        return std::clamp(int(std::floor((v - layout.origin[axis]) / size)), 0, n - 1);
+    };
+
+    // Bucket the faces by the layers their z-extent spans, so that each
+    // layer is tested only against the faces that can reach it.
+    const auto &faces = geometry.mesh().faces();
+    std::vector<std::array<Point, 3>> triangles(faces.size());
+    std::vector<std::array<int, 2>> spans(faces.size());
+    std::vector<size_t> offsets(layout.nz + 1, 0);
+    for (const Face &face: faces) {
+        int c = 0;
+        for (const Vertex *vertex: face.vertices()) {
+            triangles[face.index][c++] = geometry.positions()[vertex->index];
+        }
+        const auto &t = triangles[face.index];
+        int k0 = index(std::min({t[0][2], t[1][2], t[2][2]}), 2, layout.nz);
+        int k1 = index(std::max({t[0][2], t[1][2], t[2][2]}), 2, layout.nz);
+        spans[face.index] = {k0, k1};
+        for (int k = k0; k <= k1; k++) offsets[k + 1]++;
+    }
+    for (int k = 0; k < layout.nz; k++) offsets[k + 1] += offsets[k];
+    std::vector<uint32_t> buckets(offsets.back());
+    std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+    for (size_t f = 0; f < faces.size(); f++) {
+        for (int k = spans[f][0]; k <= spans[f][1]; k++) buckets[cursors[k]++] = f;
+    }
+
+    parallelFor(layout.nz, settings.threads, 1, [&](size_t begin, size_t end, unsigned) {
+        for (size_t k = begin; k < end; k++) {
+            for (size_t b = offsets[k]; b < offsets[k + 1]; b++) {
+                const auto &t = triangles[buckets[b]];
+                int i0 = index(std::min({t[0][0], t[1][0], t[2][0]}), 0, layout.nx);
+                int i1 = index(std::max({t[0][0], t[1][0], t[2][0]}), 0, layout.nx);
+                int j0 = index(std::min({t[0][1], t[1][1], t[2][1]}), 1, layout.ny);
+                int j1 = index(std::max({t[0][1], t[1][1], t[2][1]}), 1, layout.ny);
+
+                // Every voxel in these ranges meets the bounds of the
+                // triangle, so the box normals cannot separate them.
+                TriangleAxes axes{t, {size / 2, size / 2, size / 2}};
+                for (int j = j0; j <= j1; j++) {
+                    for (int i = i0; i <= i1; i++) {
+                        if (!grid.at(i, j, k) && axes.overlaps(grid.center(i, j, k))) {
+                            grid.set(i, j, k);
+                        }
+                    }
+                }
+            }
+        }
+    });
+    return grid;
+}
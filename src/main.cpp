@@ -6,39 +6,198 @@
 #include <algorithm>
 #include <Mesh.h>
 #include <Slicer.h>
+#include <SliceSession.h>
+#include <SliceServer.h>
+#include <MeshCache.h>
 #include <locale>
-#include <MarchingCubes.h>
+#include <cstdio>
+#include <stdexcept>
+#include <filesystem>
+#include <Voxelizer.h>
+#include <Progress.h>
+#include <Trace.h>
 
-bool isFileOBJ(std::string path) {
-    std::string fileExtension = path.substr(path.find("."));
-    
-    if(fileExtension == ".obj") return true;
-    if(fileExtension == ".Obj") return true;
-    if(fileExtension == ".OBJ") return true;
-
-    return false;
+// Parses a count from 1 to limit. Throws std::invalid_argument or
+// std::out_of_range otherwise.
+static unsigned long long positive(const std::string &text, unsigned long long limit) {
+    size_t end = 0;
+    long long value = std::stoll(text, &end);
+    if (end != text.size() || value <= 0 || (unsigned long long) value > limit) throw std::out_of_range(text);
+    return value;
 }
 
 int main(int argc, char const *argv[]) {
-    if (argc != 2) {
-        std::cout << "usage: slicer [file.obj]" << std::endl;
-        return 1;
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    unsigned threads = 1;
+    bool useCache = true;
+    size_t memoryCap = 0;
+    SliceJob job;
+    int voxels = 0;
+    std::string tracePath, statsPath;
+    ServerSettings server;
+    std::string serverPath, request;
+    bool usage = false;
+    // The arguments a client passes on to the server.
+    std::vector<std::string> jobArgs;
+
+    // A malformed number anywhere makes the arguments unusable.
+    for (size_t i = 0; i < args.size() && !usage; i++) {
+        try {
+            const std::string &arg = args[i];
+            size_t first = i;
+            if (job.parse(args, i)) {
+                jobArgs.insert(jobArgs.end(), args.begin() + first, args.begin() + i + 1);
+            } else if (arg == "--threads" && i + 1 < args.size()) {
+                threads = positive(args[++i], 1 << 12);
+            } else if (arg == "--memory-cap" && i + 1 < args.size()) {
+                memoryCap = positive(args[++i], 1ull << 40) << 20;
+            } else if (arg == "--voxels" && i + 1 < args.size()) {
+                voxels = positive(args[++i], 1 << 16);
+            } else if (arg == "--trace" && i + 1 < args.size()) {
+                tracePath = args[++i];
+            } else if (arg == "--stats" && i + 1 < args.size()) {
+                statsPath = args[++i];
+            } else if (arg == "--quiet") {
+                setQuiet(true);
+            } else if (arg == "--no-cache") {
+                useCache = false;
+            } else if (arg == "--serve" && i + 1 < args.size()) {
+                server.socketPath = args[++i];
+            } else if (arg == "--jobs" && i + 1 < args.size()) {
+                server.workers = positive(args[++i], 1 << 12);
+            } else if (arg == "--queue" && i + 1 < args.size()) {
+                server.queue = positive(args[++i], 1 << 20);
+            } else if (arg == "--cache-budget" && i + 1 < args.size()) {
+                server.cacheBytes = positive(args[++i], 1ull << 40) << 20;
+            } else if (arg == "--connect" && i + 1 < args.size()) {
+                serverPath = args[++i];
+            } else if ((arg == "--status" || arg == "--stop") && request.empty()) {
+                request = arg.substr(2);
+            } else if (job.path.empty()) {
+                job.path = arg;
+                jobArgs.push_back(arg);
+            } else {
+                usage = true;
+            }
+        } catch (const std::invalid_argument &) {
+            usage = true;
+        } catch (const std::out_of_range &) {
+            usage = true;
+        }
     }
 
-    if (!isFileOBJ(argv[1])) {
-        std::cout << "error: input file does not have 'obj' extension" << std::endl;
+    job.settings.layers.minHeight = std::min(job.settings.layers.minHeight, job.settings.layers.height);
+    if (!server.socketPath.empty()) {
+        usage = usage || !serverPath.empty() || !request.empty() || !job.path.empty();
+    } else if (!request.empty()) {
+        usage = usage || serverPath.empty() || !job.path.empty();
+    } else {
+        usage = usage || !job.valid();
+    }
+
+    if (usage) {
+        std::cout << "usage: slicer [--threads N] [--no-cache] [--memory-cap MiB] [--resolution WxH] [--pitch P]\n"
+                  << "              [--bits 1|8] [--antialias N] (--output dir | --stack file.hels [--contours-only])\n"
+                  << "              [--layer-height H] [--adaptive TOLERANCE [--min-layer-height H]]\n"
+                  << "              [--min-z Z] [--max-z Z] [--voxels N] [--quiet] [--trace trace.json]\n"
+                  << "              [--stats stats.json] [--connect socket] [file.obj|file.stl]\n"
+                  << "       slicer --serve socket [--jobs N] [--queue N] [--cache-budget MiB] [--no-cache]\n"
+                  << "       slicer --connect socket --status|--stop" << std::endl;
         return 1;
     }
 
-    std::ifstream file{argv[1]};
-    if (file.bad()) {
-        std::cout << "error: input file not found" << std::endl;
+    // As a server, slice jobs from clients until asked to stop. Progress
+    // bars from concurrent jobs would only garble one another.
+    if (!server.socketPath.empty()) {
+        server.useCacheFiles = useCache;
+        try {
+            SliceServer slicer{server};
+            info() << "serving on " << server.socketPath << std::endl;
+            setQuiet(true);
+            slicer.run();
+        } catch (const std::runtime_error &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // As a client, hand the job or request to a server and print its reply.
+    if (!serverPath.empty()) {
+        try {
+            std::vector<std::string> fields{request.empty() ? "slice" : request};
+            if (request.empty()) {
+                fields.push_back(std::filesystem::current_path());
+                fields.insert(fields.end(), jobArgs.begin(), jobArgs.end());
+            }
+            std::string reply = serverRequest(serverPath, fields);
+            std::cout << reply << std::endl;
+            return reply.rfind("ok", 0) == 0 ? 0 : 1;
+        } catch (const std::runtime_error &e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Stage timings are written out however the run ends.
+    trace::enable(!tracePath.empty() || !statsPath.empty());
+    auto writeTraces = [&]() {
+        if (!tracePath.empty()) {
+            std::ofstream out{tracePath};
+            trace::writeChromeTrace(out);
+            if (!out) std::cout << "warning: cannot write " << tracePath << std::endl;
+        }
+        if (!statsPath.empty()) {
+            std::ofstream out{statsPath};
+            trace::writeJSON(out);
+            if (!out) std::cout << "warning: cannot write " << statsPath << std::endl;
+        }
+    };
+
+    // Layers go to a layer stack if one is asked for, and otherwise to a
+    // PNG mask per layer.
+    std::unique_ptr<LayerSink> sink = job.sink();
+
+    // With a memory cap, STL files are sliced out of core and never loaded
+    // as a whole. Other formats have no streaming reader.
+    std::string extension = std::filesystem::path(job.path).extension();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (memoryCap > 0 && extension != ".stl") {
+        std::cout << "error: --memory-cap requires an STL input" << std::endl;
         return 1;
     }
 
-    Geometry geometry{file};
-    MarchingCubes(geometry);
-    Slicer::sliceGeometry(geometry);
+    try {
+        if (memoryCap > 0) {
+            if (job.settings.layers.adaptive) {
+                std::cout << "warning: adaptive layers need the whole mesh, slicing uniformly" << std::endl;
+            }
+            Slicer::reportDiagnostics(Slicer::sliceStream(job.path, memoryCap, job.settings, *sink));
+        } else {
+            job.settings.threads = threads;
+            Geometry geometry = loadGeometry(job.path, threads, useCache);
+            if (voxels > 0) {
+                VoxelSettings voxelSettings;
+                voxelSettings.resolution = voxels;
+                voxelSettings.threads = threads;
+                VoxelLayout layout = voxelLayout(geometry, voxelSettings);
+                info() << "voxel grid " << layout.nx << "x" << layout.ny << "x" << layout.nz << ", "
+                          << layout.bytes() / double(1 << 20) << " MiB" << std::endl;
+                VoxelGrid grid = voxelize(geometry, voxelSettings);
+                info() << grid.count() << " voxels, volume " << grid.volume() << std::endl;
+            }
+
+            info() << "start slicing" << std::endl;
+            SliceSession session{geometry};
+            info() << session.layers(job.settings).size() << " layers" << std::endl;
+            Slicer::reportDiagnostics(session.slice(job.settings, *sink));
+        }
+    } catch (const std::runtime_error &e) {
+        std::cout << e.what() << std::endl;
+        writeTraces();
+        return 1;
+    }
+    writeTraces();
 
     return 0;
     
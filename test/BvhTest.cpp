@@ -0,0 +1,187 @@
+#include <fstream>
+#include <random>
+#include <cstring>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <Bvh.h>
+#include "Helpers.h"
+
+namespace {
+
+using Point = Geometry::Point;
+
+Point sub(const Point &a, const Point &b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+Point crs(const Point &a, const Point &b) { return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]}; }
+double dt(const Point &a, const Point &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+std::array<Point, 3> triangle(const Geometry &geometry, const Face &face) {
+    auto v = face.vertices();
+    return {geometry.positions()[v[0]->index], geometry.positions()[v[1]->index], geometry.positions()[v[2]->index]};
+}
+
+// Tests the ray against every face.
+RayHit bruteIntersect(const Geometry &geometry, const Ray &ray) {
+    RayHit best;
+    for (const Face &face: geometry.mesh().faces()) {
+        auto t = triangle(geometry, face);
+        Point e1 = sub(t[1], t[0]), e2 = sub(t[2], t[0]);
+        Point p = crs(ray.direction, e2);
+        double det = dt(e1, p);
+        if (det == 0) continue;
+        double inv = 1 / det;
+        Point s = sub(ray.origin, t[0]);
+        double u = dt(s, p) * inv;
+        Point q = crs(s, e1);
+        double v = dt(ray.direction, q) * inv;
+        double d = dt(e2, q) * inv;
+        if (u < 0 || v < 0 || u + v > 1 || d < ray.tmin || d > ray.tmax) continue;
+        if (d < best.t || (d == best.t && face.index < best.face)) best = {d, face.index, u, v};
+    }
+    return best;
+}
+
+// The distance to a triangle: to its plane if p projects inside it, and to
+// the nearest edge otherwise.
+double triangleDistance(const Point &p, const std::array<Point, 3> &t) {
+    Point n = crs(sub(t[1], t[0]), sub(t[2], t[0]));
+    bool inside = true;
+    for (int i = 0; i < 3; i++) {
+        inside &= dt(crs(sub(t[(i + 1) % 3], t[i]), sub(p, t[i])), n) >= 0;
+    }
+    if (inside) return std::abs(dt(sub(p, t[0]), n)) / std::sqrt(dt(n, n));
+    return std::min({segmentDistance(p, t[0], t[1]), segmentDistance(p, t[1], t[2]), segmentDistance(p, t[2], t[0])});
+}
+
+std::vector<Ray> randomRays(const Geometry &geometry, size_t count, unsigned seed) {
+    Point lo = geometry.positions()[0], hi = lo;
+    for (const Point &p: geometry.positions()) {
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(lo[a], p[a]);
+            hi[a] = std::max(hi[a], p[a]);
+        }
+    }
+    std::mt19937 random{seed};
+    std::uniform_real_distribution<double> unit{0, 1};
+    auto inBox = [&](double margin) -> Point {
+        Point p;
+        for (int a = 0; a < 3; a++) p[a] = lo[a] - margin * (hi[a] - lo[a]) + (1 + 2 * margin) * (hi[a] - lo[a]) * unit(random);
+        return p;
+    };
+
+    // From outside towards the model, and from inside it in any direction.
+    std::vector<Ray> rays(count);
+    for (size_t i = 0; i < count; i++) {
+        rays[i].origin = inBox(i % 3 == 0 ? 0 : 1);
+        rays[i].direction = sub(inBox(0), rays[i].origin);
+    }
+    return rays;
+}
+
+}
+
+TEST_CASE("BVH nodes are the same for every thread count", "[Bvh]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    Bvh serial{geometry, 1}, parallel{geometry, 3};
+
+    REQUIRE(serial.nodes().size() == parallel.nodes().size());
+    CHECK(std::memcmp(serial.nodes().data(), parallel.nodes().data(), sizeof(BvhNode) * serial.nodes().size()) == 0);
+    CHECK(serial.faces() == geometry.mesh().faces().size());
+
+    // Every face is in exactly one leaf, and every leaf is within its
+    // parent's bounds.
+    std::vector<int> seen(serial.faces(), 0);
+    size_t leaves = 0;
+    for (const BvhNode &node: serial.nodes()) {
+        if (node.count == 0) {
+            const BvhNode *children[2] = {&node + 1, &serial.nodes()[node.index]};
+            for (const BvhNode *child: children) {
+                for (int a = 0; a < 3; a++) {
+                    REQUIRE(child->lo[a] >= node.lo[a]);
+                    REQUIRE(child->hi[a] <= node.hi[a]);
+                }
+            }
+            continue;
+        }
+        leaves++;
+        for (uint32_t i = node.index; i < node.index + node.count; i++) seen[i]++;
+    }
+    CHECK(std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; }));
+    CHECK(serial.nodes().size() == 2 * leaves - 1);
+}
+
+TEST_CASE("BVH ray casts find the nearest face", "[Bvh]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj");
+    std::ifstream file{"test/models/" + model};
+    Geometry geometry{file};
+    Bvh bvh{geometry, 2};
+
+    // 203 rays leave a partial packet at the end.
+    std::vector<Ray> rays = randomRays(geometry, 203, 11);
+    rays[5].tmax = 0.5;
+    rays[6].tmin = 0.5;
+    std::vector<RayHit> packed(rays.size());
+    bvh.intersect(rays.data(), packed.data(), rays.size(), 3);
+
+    size_t hits = 0;
+    for (size_t i = 0; i < rays.size(); i++) {
+        RayHit expected = bruteIntersect(geometry, rays[i]), hit;
+        REQUIRE(bvh.intersect(rays[i], hit) == (expected.face != -1));
+        REQUIRE(hit.face == expected.face);
+        REQUIRE(hit.t == expected.t);
+        REQUIRE(packed[i].face == expected.face);
+        REQUIRE(packed[i].t == expected.t);
+        hits += hit.face != -1;
+    }
+    CHECK(hits > rays.size() / 2);
+}
+
+TEST_CASE("BVH closest point queries match every face", "[Bvh]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    Bvh bvh{geometry};
+
+    std::vector<Ray> rays = randomRays(geometry, 100, 5);
+    for (const Ray &ray: rays) {
+        const Point &p = ray.origin;
+        double expected = std::numeric_limits<double>::infinity();
+        for (const Face &face: geometry.mesh().faces()) {
+            expected = std::min(expected, triangleDistance(p, triangle(geometry, face)));
+        }
+
+        ClosestPoint closest = bvh.closest(p);
+        REQUIRE(closest.face != -1);
+        REQUIRE(closest.distance == Approx(expected).margin(1e-12));
+        Point d = sub(closest.point, p);
+        CHECK(std::sqrt(dt(d, d)) == Approx(closest.distance));
+        CHECK(triangleDistance(closest.point, triangle(geometry, geometry.mesh().faces()[closest.face])) < 1e-12);
+
+        CHECK(bvh.closest(p, expected / 2).face == -1);
+    }
+}
+
+TEST_CASE("BVH box queries report every overlapping face", "[Bvh]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    Bvh bvh{geometry};
+
+    std::vector<Ray> rays = randomRays(geometry, 50, 3);
+    size_t reported = 0;
+    for (const Ray &ray: rays) {
+        Point a = ray.origin, b = {a[0] + 0.1 * ray.direction[0], a[1] + 0.1 * ray.direction[1], a[2] + 0.1 * ray.direction[2]};
+        BvhBox box{{std::min(a[0], b[0]), std::min(a[1], b[1]), std::min(a[2], b[2])},
+                   {std::max(a[0], b[0]), std::max(a[1], b[1]), std::max(a[2], b[2])}};
+        Point center{(box.lo[0] + box.hi[0]) / 2, (box.lo[1] + box.hi[1]) / 2, (box.lo[2] + box.hi[2]) / 2};
+        Point half = sub(box.hi, center);
+
+        std::vector<int> expected;
+        for (const Face &face: geometry.mesh().faces()) {
+            if (triangleOverlapsBox(center, half, triangle(geometry, face))) expected.push_back(face.index);
+        }
+        std::vector<int> faces = bvh.overlapping(box);
+        std::sort(faces.begin(), faces.end());
+        REQUIRE(faces == expected);
+        reported += faces.size();
+    }
+    CHECK(reported > 0);
+}
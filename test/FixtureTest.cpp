@@ -0,0 +1,99 @@
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <Slicer.h>
+#include "../bench/Generators.h"
+#include "Helpers.h"
+
+// Golden output for the layers the Pipeline benchmark slices, so that an
+// optimization that changes what the slicer produces fails here as well as
+// against the benchmark baseline.
+
+namespace {
+
+struct Fixture {
+    int euler;
+    size_t contours;
+    size_t points;
+    double area;
+};
+
+// Slices 200 layers spanning the model, as the Pipeline benchmark does.
+Fixture measure(const Geometry &geometry) {
+    auto [lo, hi] = std::minmax_element(geometry.positions().begin(), geometry.positions().end(),
+                                        [](auto &a, auto &b) { return a[2] < b[2]; });
+    const double minz = (*lo)[2], maxz = (*hi)[2];
+
+    Fixture fixture{geometry.mesh().eulerCharacteristic(), 0, 0, 0};
+    Slicer::sliceLayers(geometry, Slicer::uniformLayers(minz, maxz, (maxz - minz) / 200),
+                        [&](int, double, const Slicer::Polygons &polygons) {
+        fixture.contours += polygons.size();
+        for (const auto &polygon: polygons) fixture.points += polygon.size();
+        fixture.area += signedArea(polygons);
+    });
+    return fixture;
+}
+
+Geometry generated(const bench::TriangleMesh &mesh) {
+    return Geometry{mesh.positions, mesh.faces, 1};
+}
+
+}
+
+TEST_CASE("Bundled models slice to their golden layers", "[Fixture]") {
+    auto [name, expected] = GENERATE(values<std::pair<const char*, Fixture>>({
+        {"torus.obj", {0, 400, 5182, 3117.6909791175372}},
+        {"bunny.obj", {-2, 421, 33745, 1.2720103962730078}},
+        {"sphere.obj", {2, 199, 58111, 418.6430308856996}},
+    }));
+    INFO(name);
+    std::ifstream file{std::string{"test/models/"} + name};
+    Geometry geometry{file};
+
+    Fixture fixture = measure(geometry);
+    CHECK(fixture.euler == expected.euler);
+    CHECK(fixture.contours == expected.contours);
+    CHECK(fixture.points == expected.points);
+    CHECK(fixture.area == Approx(expected.area).epsilon(1e-9));
+}
+
+TEST_CASE("Generated meshes are closed with the expected topology", "[Fixture]") {
+    for (int subdivisions: {0, 1, 3}) {
+        Geometry sphere = generated(bench::sphere(subdivisions));
+        CHECK(sphere.mesh().faces().size() == 20 * std::pow(4, subdivisions));
+        CHECK(sphere.mesh().closed());
+        CHECK(sphere.mesh().eulerCharacteristic() == 2);
+    }
+
+    Geometry torus = generated(bench::torus(64, 32));
+    CHECK(torus.mesh().faces().size() == 2 * 64 * 32);
+    CHECK(torus.mesh().closed());
+    CHECK(torus.mesh().eulerCharacteristic() == 0);
+}
+
+TEST_CASE("Generated meshes slice to their analytic sections", "[Fixture]") {
+    // Through the equator of a unit sphere: one counter-clockwise contour
+    // of area pi, less what the tessellation cuts off.
+    Geometry sphere = generated(bench::sphere(5));
+    Slicer::Polygons equator = Slicer::sliceLayer(sphere, Slicer::faceTree(sphere), 1e-6);
+    REQUIRE(equator.size() == 1);
+    CHECK(signedArea(equator) == Approx(M_PI).epsilon(2e-3));
+
+    // The torus stands on its rim, so the plane through its center cuts
+    // the tube twice, into discs of radius 1.
+    Geometry torus = generated(bench::torus(256, 128));
+    Slicer::Polygons tube = Slicer::sliceLayer(torus, Slicer::faceTree(torus), 1e-6);
+    REQUIRE(tube.size() == 2);
+    for (const auto &polygon: tube) CHECK(signedArea({polygon}) == Approx(M_PI).epsilon(2e-3));
+
+    // Near the top of the rim, the plane cuts the tube once.
+    CHECK(Slicer::sliceLayer(torus, Slicer::faceTree(torus), 2.5).size() == 1);
+
+    Fixture fixture = measure(sphere);
+    CHECK(fixture.euler == 2);
+    CHECK(fixture.contours == 199);
+    // The sections of a unit sphere at 200 evenly spaced heights average
+    // 2/3 of the area of the equator.
+    CHECK(fixture.area == Approx(200 * 2 * M_PI / 3).epsilon(1e-2));
+}
@@ -0,0 +1,52 @@
+/**
+ * \file Helpers.h
+ * \brief Geometric measures shared by the tests
+ */
+
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <Slicer.h>
+
+// The area enclosed by a polygon, positive if it winds counter-clockwise.
+// Closed contours repeat their first point; an open contour is measured
+// along its points only, as the golden fixtures were.
+inline double signedArea(const Slicer::Polygon &polygon) {
+    double area = 0;
+    for (size_t i = 0; i + 1 < polygon.size(); i++) {
+        area += polygon[i][0] * polygon[i + 1][1] - polygon[i + 1][0] * polygon[i][1];
+    }
+    return area / 2;
+}
+
+// The net area of a set of polygons, in which holes wind clockwise.
+inline double signedArea(const Slicer::Polygons &polygons) {
+    double area = 0;
+    for (const Slicer::Polygon &polygon: polygons) area += signedArea(polygon);
+    return area;
+}
+
+// The distance from p to the segment from a to b, in any dimension.
+template <typename P, typename Q>
+double segmentDistance(const P &p, const Q &a, const Q &b) {
+    constexpr size_t n = std::tuple_size<Q>::value;
+    std::array<double, n> ab, ap;
+    for (size_t k = 0; k < n; k++) {
+        ab[k] = double(b[k]) - double(a[k]);
+        ap[k] = double(p[k]) - double(a[k]);
+    }
+    double dot = 0, length = 0;
+    for (size_t k = 0; k < n; k++) {
+        dot += ap[k] * ab[k];
+        length += ab[k] * ab[k];
+    }
+    const double t = std::clamp(dot / length, 0.0, 1.0);
+    double distance = 0;
+    for (size_t k = 0; k < n; k++) distance += (ap[k] - t * ab[k]) * (ap[k] - t * ab[k]);
+    return std::sqrt(distance);
+}
+
+#endif /* TEST_HELPERS_H */
@@ -0,0 +1,148 @@
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <Infill.h>
+#include "Helpers.h"
+
+namespace {
+
+Slicer::Polygon square(double x0, double y0, double x1, double y1, bool hole = false) {
+    Slicer::Polygon polygon{{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}, {x0, y0}};
+    if (hole) std::reverse(polygon.begin(), polygon.end());
+    return polygon;
+}
+
+double length(const InfillSegment &segment) {
+    return std::hypot(segment.b[0] - segment.a[0], segment.b[1] - segment.a[1]);
+}
+
+double totalLength(const InfillPath &path) {
+    double sum = 0;
+    for (const InfillSegment &segment: path) sum += length(segment);
+    return sum;
+}
+
+bool inside(const Slicer::Polygons &polygons, double x, double y) {
+    bool in = false;
+    for (const Slicer::Polygon &polygon: polygons) {
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const auto &a = polygon[j], &b = polygon[i];
+            if ((a[1] <= y) == (b[1] <= y)) continue;
+            if (a[0] + (y - a[1]) * (b[0] - a[0]) / (b[1] - a[1]) > x) in = !in;
+        }
+    }
+    return in;
+}
+
+}
+
+TEST_CASE("Lines fill a square at the requested spacing", "[Infill]") {
+    InfillSettings settings;
+    settings.density = 0.5;
+    settings.lineWidth = 0.5;
+    settings.angle = 0;
+    InfillGenerator generator{settings};
+    REQUIRE(infillSpacing(settings) == 1);
+
+    // Lines at y = 0, 1, ..., 9: the bottom edge is inclusive and the top
+    // edge exclusive.
+    InfillPath path;
+    generator.generate({square(0, 0, 10, 10)}, 0, path);
+    REQUIRE(path.size() == 10);
+    for (size_t i = 0; i < path.size(); i++) {
+        REQUIRE(path[i].a[1] == Approx(i));
+        REQUIRE(path[i].b[1] == Approx(i));
+        REQUIRE(length(path[i]) == Approx(10));
+        // Alternate lines run in opposite directions.
+        REQUIRE((path[i].b[0] > path[i].a[0]) == (i % 2 == 0));
+    }
+
+    // Odd layers turn by 90 degrees.
+    generator.generate({square(0, 0, 10, 10)}, 1, path);
+    REQUIRE(path.size() == 10);
+    for (const InfillSegment &segment: path) REQUIRE(segment.a[0] == Approx(segment.b[0]));
+
+    settings.density = 0;
+    InfillGenerator{settings}.generate({square(0, 0, 10, 10)}, 0, path);
+    REQUIRE(path.empty());
+}
+
+TEST_CASE("Infill stays inside regions with holes", "[Infill]") {
+    // Off the lattice of lines, so that no line runs along an edge.
+    const Slicer::Polygons region{square(0.013, 0.013, 20.013, 20.013), square(5.013, 5.013, 12.013, 15.013, true),
+                                  square(14.013, 2.013, 18.013, 6.013, true)};
+    const double area = signedArea(region);
+    for (InfillPattern pattern: {InfillPattern::Lines, InfillPattern::Grid, InfillPattern::Triangles}) {
+        for (double angle: {0.0, 30.0, 45.0, 73.0}) {
+            InfillSettings settings;
+            settings.pattern = pattern;
+            settings.angle = angle;
+            settings.density = 0.25;
+            settings.lineWidth = 0.1;
+            InfillPath path;
+            InfillGenerator{settings}.generate(region, 0, path);
+            REQUIRE(!path.empty());
+
+            // Every segment lies inside and runs from boundary to boundary.
+            for (const InfillSegment &segment: path) {
+                for (double t: {0.01, 0.5, 0.99}) {
+                    double x = segment.a[0] + t * (segment.b[0] - segment.a[0]);
+                    double y = segment.a[1] + t * (segment.b[1] - segment.a[1]);
+                    REQUIRE(inside(region, x, y));
+                }
+                double step = 1e-6 / length(segment);
+                double dx = (segment.b[0] - segment.a[0]) * step, dy = (segment.b[1] - segment.a[1]) * step;
+                REQUIRE(!inside(region, segment.a[0] - dx, segment.a[1] - dy));
+                REQUIRE(!inside(region, segment.b[0] + dx, segment.b[1] + dy));
+            }
+
+            // Each family covers the area at its spacing.
+            int families = pattern == InfillPattern::Grid ? 2 : pattern == InfillPattern::Triangles ? 3 : 1;
+            REQUIRE(totalLength(path) == Approx(families * area / infillSpacing(settings)).epsilon(0.05));
+        }
+    }
+}
+
+TEST_CASE("Triangle infill families meet at common points", "[Infill]") {
+    InfillSettings settings;
+    settings.pattern = InfillPattern::Triangles;
+    settings.angle = 0;
+    settings.density = 0.3;
+    settings.lineWidth = 0.1;
+    InfillPath path;
+    InfillGenerator{settings}.generate({square(-3, -3, 3, 3)}, 0, path);
+
+    // The origin lies on a line of every family.
+    int through = 0;
+    for (const InfillSegment &segment: path) {
+        double cross = segment.a[0] * segment.b[1] - segment.a[1] * segment.b[0];
+        if (std::abs(cross) < 1e-9 * length(segment)) through++;
+    }
+    REQUIRE(through == 3);
+}
+
+TEST_CASE("Infill of layers does not depend on the thread count", "[Infill]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    std::vector<Slicer::Polygons> layers;
+    Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.005), [&](int, double, const Slicer::Polygons &polygons) {
+        layers.push_back(polygons);
+    });
+
+    InfillSettings settings;
+    settings.pattern = InfillPattern::Grid;
+    settings.lineWidth = 0.0005;
+    std::vector<InfillPath> one = infillLayers(layers, settings, 1);
+    std::vector<InfillPath> three = infillLayers(layers, settings, 3);
+    REQUIRE(one.size() == layers.size());
+    for (size_t i = 0; i < layers.size(); i++) {
+        REQUIRE(one[i].size() == three[i].size());
+        for (size_t j = 0; j < one[i].size(); j++) {
+            REQUIRE(one[i][j].a == three[i][j].a);
+            REQUIRE(one[i][j].b == three[i][j].b);
+        }
+        double expected = 2 * signedArea(layers[i]) / infillSpacing(settings);
+        REQUIRE(totalLength(one[i]) == Approx(expected).epsilon(0.1).margin(20 * infillSpacing(settings)));
+    }
+}
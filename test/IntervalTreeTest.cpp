@@ -0,0 +1,60 @@
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <IntervalTree.h>
+#include <Mesh.h>
+#include <Slicer.h>
+
+TEST_CASE("Stabbing and overlap queries match a linear scan", "[IntervalTree]") {
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<double> position{0, 100};
+    std::uniform_real_distribution<double> length{0, 5};
+
+    std::vector<double> min, max;
+    for (int i = 0; i < 2000; i++) {
+        double lo = position(rng);
+        min.push_back(lo);
+        max.push_back(lo + (i % 10 == 0 ? 0 : length(rng)));
+    }
+    IntervalTree tree{min, max};
+    REQUIRE(tree.size() == min.size());
+
+    for (int q = 0; q < 200; q++) {
+        // Query exactly at some endpoints to exercise closed boundaries.
+        double z0 = q % 7 == 0 ? min[q] : position(rng);
+        double z1 = z0 + length(rng);
+
+        std::vector<int> stabbed, overlapping;
+        for (int i = 0; i < min.size(); i++) {
+            if (min[i] <= z0 && z0 <= max[i]) stabbed.push_back(i);
+            if (min[i] <= z1 && z0 <= max[i]) overlapping.push_back(i);
+        }
+
+        auto result = tree.stab(z0);
+        std::sort(result.begin(), result.end());
+        CHECK(result == stabbed);
+
+        result = tree.overlap(z0, z1);
+        std::sort(result.begin(), result.end());
+        CHECK(result == overlapping);
+    }
+}
+
+TEST_CASE("Empty interval tree reports nothing", "[IntervalTree]") {
+    IntervalTree tree{{}, {}};
+    CHECK(tree.stab(0.0).empty());
+    CHECK(tree.overlap(-1.0, 1.0).empty());
+}
+
+TEST_CASE("Random access layers match a full scan", "[Slicer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    IntervalTree tree = Slicer::faceTree(geometry);
+    Slicer::Section section{geometry};
+
+    for (double z: {-0.9, -0.25, 0.0, 0.33, 0.8}) {
+        Slicer::sliceTriangles(geometry, z, section);
+        CHECK(Slicer::sliceLayer(geometry, tree, z) == Slicer::computeContours(section));
+    }
+}
@@ -0,0 +1,130 @@
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <LayerStack.h>
+
+TEST_CASE("Layer stacks round-trip contours and masks", "[LayerStack]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj");
+    auto bits = GENERATE(1, 8);
+    std::ifstream file{"test/models/" + model};
+    Geometry geometry{file};
+
+    LayerStackSettings settings;
+    settings.masks = true;
+    settings.raster.width = 301;
+    settings.raster.height = 250;
+    settings.raster.pitch = model == "sphere.obj" ? 0.008 : 0.0008;
+    settings.raster.bits = bits;
+    settings.raster.supersample = bits == 8 ? 2 : 1;
+
+    const std::string path = "/tmp/halfedge-test.hels";
+    std::vector<double> zs;
+    std::vector<Slicer::Polygons> layers;
+    std::vector<Mask> masks;
+    {
+        LayerStackWriter writer{path, settings};
+        Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.01), [&](int, double z, const Slicer::Polygons &polygons) {
+            Mask mask;
+            rasterize(polygons, settings.raster, mask);
+            writer.write(z, polygons, &mask);
+            zs.push_back(z);
+            layers.push_back(polygons);
+            masks.push_back(std::move(mask));
+        });
+        writer.finish();
+    }
+
+    LayerStackReader reader{path};
+    REQUIRE(reader.layers() == layers.size());
+    CHECK(reader.settings().masks);
+    CHECK(reader.settings().raster.width == 301);
+    CHECK(reader.settings().raster.bits == bits);
+    CHECK(reader.settings().scale == settings.scale);
+
+    // Read back to front, to exercise random access through the index.
+    Mask mask;
+    for (size_t i = layers.size(); i-- > 0;) {
+        CHECK(reader.z(i) == zs[i]);
+        CHECK(reader.find(zs[i]) == i);
+
+        Slicer::Polygons polygons = reader.contours(i);
+        REQUIRE(polygons.size() == layers[i].size());
+        for (size_t j = 0; j < polygons.size(); j++) {
+            REQUIRE(polygons[j].size() == layers[i][j].size());
+            CHECK((polygons[j].front() == polygons[j].back()) == (layers[i][j].front() == layers[i][j].back()));
+            for (size_t k = 0; k < polygons[j].size(); k++) {
+                REQUIRE(std::abs(polygons[j][k][0] - layers[i][j][k][0]) <= 0.5 / settings.scale * (1 + 1e-9));
+                REQUIRE(std::abs(polygons[j][k][1] - layers[i][j][k][1]) <= 0.5 / settings.scale * (1 + 1e-9));
+            }
+        }
+
+        reader.mask(i, mask);
+        REQUIRE(mask.data == masks[i].data);
+    }
+    CHECK(reader.find(zs.back() + 1) == layers.size());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Layer stacks keep open contours open", "[LayerStack]") {
+    const std::string path = "/tmp/halfedge-test-open.hels";
+    Slicer::Polygons polygons{
+        {{0, 0}, {1, 0}, {1, 1}},
+        {{-2, -2}, {-1, -2}, {-1, -1}, {-2, -2}},
+        {{3, 3}},
+    };
+    {
+        LayerStackWriter writer{path, LayerStackSettings{}};
+        writer.write(0.5, polygons);
+        writer.write(1.5, {});
+        writer.finish();
+    }
+
+    LayerStackReader reader{path};
+    CHECK(reader.layers() == 2);
+    CHECK(reader.contours(0) == polygons);
+    CHECK(reader.contours(1).empty());
+    CHECK(reader.find(1.0) == 1);
+    Mask mask;
+    CHECK_THROWS_AS(reader.mask(0, mask), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Incomplete or damaged layer stacks are rejected", "[LayerStack]") {
+    const std::string path = "/tmp/halfedge-test-damaged.hels";
+    {
+        // A writer that never finishes leaves nothing behind.
+        LayerStackWriter writer{path, LayerStackSettings{}};
+        writer.write(0, {{{0, 0}, {1, 0}, {1, 1}, {0, 0}}});
+    }
+    CHECK_THROWS_AS(LayerStackReader{path}, std::runtime_error);
+
+    {
+        LayerStackWriter writer{path, LayerStackSettings{}};
+        writer.write(0, {{{0, 0}, {1, 0}, {1, 1}, {0, 0}}});
+        writer.finish();
+    }
+    std::string bytes;
+    {
+        std::ifstream in{path, std::ios::binary};
+        bytes.assign(std::istreambuf_iterator<char>{in}, {});
+    }
+
+    // Truncated by one byte, the footer no longer matches.
+    {
+        std::ofstream out{path, std::ios::binary};
+        out.write(bytes.data(), bytes.size() - 1);
+    }
+    CHECK_THROWS_AS(LayerStackReader{path}, std::runtime_error);
+
+    // A record whose point count overruns its bytes fails when decoded.
+    {
+        std::string damaged = bytes;
+        damaged[73] = char(0x7F);
+        std::ofstream out{path, std::ios::binary};
+        out.write(damaged.data(), damaged.size());
+    }
+    LayerStackReader reader{path};
+    CHECK_THROWS_AS(reader.contours(0), std::runtime_error);
+    std::remove(path.c_str());
+}
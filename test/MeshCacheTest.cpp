@@ -0,0 +1,83 @@
+#include <fstream>
+#include <cstdio>
+#include <filesystem>
+#include <catch2/catch.hpp>
+#include <MeshCache.h>
+#include <ObjReader.h>
+
+namespace {
+
+// Copies a bundled model to /tmp so that tests can modify it and its cache.
+std::string copyModel(const std::string &name) {
+    std::string path = "/tmp/halfedge-test-" + name;
+    std::filesystem::copy_file("test/models/" + name, path, std::filesystem::copy_options::overwrite_existing);
+    std::remove((path + ".hemc").c_str());
+    return path;
+}
+
+}
+
+TEST_CASE("Cache round trip preserves geometry and connectivity", "[MeshCache]") {
+    std::string path = copyModel("bunny.obj");
+    Geometry original = loadGeometry(path, 1, false);
+    writeMeshCache(path + ".hemc", original, path);
+
+    std::optional<Geometry> cached = readMeshCache(path + ".hemc", path, 1);
+    REQUIRE(cached);
+    CHECK(cached->positions() == original.positions());
+    CHECK(cached->mesh().halfedges().size() == original.mesh().halfedges().size());
+    CHECK(cached->mesh().edges().size() == original.mesh().edges().size());
+    CHECK(cached->mesh().eulerCharacteristic() == original.mesh().eulerCharacteristic());
+
+    Connectivity a = original.mesh().connectivity();
+    Connectivity b = cached->mesh().connectivity();
+    CHECK(a.twins == b.twins);
+    CHECK(a.edges == b.edges);
+    CHECK(a.edgeHalfedges == b.edgeHalfedges);
+
+    std::remove(path.c_str());
+    std::remove((path + ".hemc").c_str());
+}
+
+TEST_CASE("Stale and damaged caches are rejected", "[MeshCache]") {
+    std::string path = copyModel("sphere.obj");
+    std::string cache = path + ".hemc";
+
+    Geometry geometry = loadGeometry(path, 1);
+    REQUIRE(std::filesystem::exists(cache));
+    REQUIRE(readMeshCache(cache, path, 1));
+
+    SECTION("a modified source invalidates the cache") {
+        std::ofstream{path, std::ios::app} << "\n# edited\n";
+        CHECK_FALSE(readMeshCache(cache, path, 1));
+
+        // Loading again rebuilds it.
+        loadGeometry(path, 1);
+        CHECK(readMeshCache(cache, path, 1));
+    }
+
+    SECTION("a flipped byte fails the checksum") {
+        std::fstream file{cache, std::ios::in | std::ios::out | std::ios::binary};
+        file.seekg(std::filesystem::file_size(cache) / 2);
+        char c = file.get();
+        file.seekp(std::filesystem::file_size(cache) / 2);
+        file.put(c ^ 0x10);
+        file.close();
+        CHECK_FALSE(readMeshCache(cache, path, 1));
+    }
+
+    SECTION("a truncated file is rejected") {
+        std::filesystem::resize_file(cache, std::filesystem::file_size(cache) - 4);
+        CHECK_FALSE(readMeshCache(cache, path, 1));
+    }
+
+    SECTION("an unreadable cache is rebuilt") {
+        std::filesystem::remove(cache);
+        std::filesystem::create_directory(cache);
+        CHECK_FALSE(readMeshCache(cache, path, 1));
+        CHECK(loadGeometry(path, 1).mesh().faces().size() == geometry.mesh().faces().size());
+    }
+
+    std::remove(path.c_str());
+    std::remove(cache.c_str());
+}
@@ -0,0 +1,139 @@
+#include <fstream>
+#include <catch2/catch.hpp>
+#include <Mesh.h>
+#include <IndexedMesh.h>
+#include <Connectivity.h>
+#include <map>
+#include <algorithm>
+
+static std::vector<std::array<int, 3>> faceVertices(const Mesh &mesh) {
+    std::vector<std::array<int, 3>> faces;
+    for (auto &face: mesh.faces()) {
+        auto h = face.halfedge;
+        faces.push_back({h->vertex->index, h->next->vertex->index, h->next->next->vertex->index});
+    }
+    return faces;
+}
+
+TEST_CASE("Indexed mesh matches pointer mesh connectivity", "[IndexedMesh]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj", "torus.obj");
+    std::ifstream file{"test/models/" + model};
+    Geometry geometry{file};
+    const Mesh &mesh = geometry.mesh();
+
+    IndexedMesh indexed{(int) mesh.vertices().size(), faceVertices(mesh)};
+    IndexedMesh copied{mesh};
+
+    for (const IndexedMesh *m: {&indexed, &copied}) {
+        REQUIRE(m->halfedgeCount() == mesh.halfedges().size());
+        CHECK(m->edgeCount() == mesh.edges().size());
+        CHECK(m->closed() == mesh.closed());
+        CHECK(m->eulerCharacteristic() == mesh.eulerCharacteristic());
+        CHECK(m->memoryUsage() < mesh.memoryUsage() / 4);
+
+        for (auto &h: mesh.halfedges()) {
+            CHECK(m->next(h.index) == h.next->index);
+            CHECK(m->prev(h.index) == h.prev->index);
+            CHECK(m->face(h.index) == h.face->index);
+            CHECK(m->corner(h.index) == h.corner->index);
+            CHECK(m->vertex(h.index) == h.vertex->index);
+            CHECK(m->edge(h.index) == h.edge->index);
+            CHECK(m->onBoundary(h.index) == h.onBoundary);
+            if (!h.onBoundary) {
+                CHECK(m->twin(h.index) == h.twin->index);
+            }
+        }
+    }
+}
+
+TEST_CASE("Indexed mesh circulates vertex fans", "[IndexedMesh]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    IndexedMesh mesh{geometry.mesh()};
+
+    for (auto &vertex: geometry.mesh().vertices()) {
+        std::vector<IndexedMesh::Index> faces;
+        mesh.vertexFaces(vertex.index, [&](auto f) { faces.push_back(f); });
+
+        std::vector<IndexedMesh::Index> expected;
+        for (Face *f: vertex.adjacentFaces()) expected.push_back(f->index);
+        CHECK(faces == expected);
+    }
+}
+
+TEST_CASE("Isolated vertices have no faces around them", "[IndexedMesh]") {
+    IndexedMesh mesh{4, {{0, 1, 2}}};
+    CHECK(mesh.vertexHalfedge(3) == IndexedMesh::invalid);
+    std::vector<IndexedMesh::Index> faces;
+    mesh.vertexFaces(3, [&](auto f) { faces.push_back(f); });
+    CHECK(faces.empty());
+    mesh.vertexFaces(0, [&](auto f) { faces.push_back(f); });
+    CHECK(faces == std::vector<IndexedMesh::Index>{0});
+}
+
+TEST_CASE("Non-allocating ranges match the adjacency vectors", "[Mesh]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj");
+    std::ifstream file{"test/models/" + model};
+    Geometry geometry{file};
+    IndexedMesh indexed{geometry.mesh()};
+
+    for (auto &face: geometry.mesh().faces()) {
+        auto halfedges = face.halfedges();
+        auto vertices = face.vertices();
+        auto edges = face.edges();
+        CHECK(std::vector<HalfEdge*>(halfedges.begin(), halfedges.end()) == face.adjacentHalfEdges());
+        CHECK(std::vector<Vertex*>(vertices.begin(), vertices.end()) == face.adjacentVertices());
+        CHECK(std::vector<Edge*>(edges.begin(), edges.end()) == face.adjacentEdges());
+    }
+
+    // The vertex fan range also handles the open boundary of bunny.obj,
+    // where it must agree with the indexed mesh.
+    for (auto &vertex: geometry.mesh().vertices()) {
+        std::vector<IndexedMesh::Index> faces, expected;
+        for (Face *f: vertex.faces()) faces.push_back(f->index);
+        indexed.vertexFaces(vertex.index, [&](auto f) { expected.push_back(f); });
+        CHECK(faces == expected);
+    }
+
+    for (auto &edge: geometry.mesh().edges()) {
+        auto faces = edge.faces();
+        CHECK(faces[0] == edge.halfedge->face);
+        CHECK((faces[1] == nullptr) == edge.halfedge->onBoundary);
+    }
+}
+
+TEST_CASE("Connectivity numbers edges by first half-edge for any thread count", "[Connectivity]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    auto faces = faceVertices(geometry.mesh());
+    int vertexCount = geometry.mesh().vertices().size();
+
+    // Reference numbering: an edge gets the next index when first seen.
+    std::map<std::pair<int, int>, uint32_t> seen;
+    std::vector<uint32_t> expected;
+    for (auto &face: faces) {
+        for (int j = 0; j < 3; j++) {
+            auto key = std::minmax(face[j], face[(j + 1) % 3]);
+            auto it = seen.emplace(key, seen.size()).first;
+            expected.push_back(it->second);
+        }
+    }
+
+    for (unsigned threads: {1, 2, 7}) {
+        Connectivity connectivity = computeConnectivity(vertexCount, faces, threads);
+        CHECK(connectivity.edges == expected);
+        CHECK(connectivity.edgeHalfedges.size() == seen.size());
+        for (uint32_t h = 0; h < connectivity.twins.size(); h++) {
+            uint32_t t = connectivity.twins[h];
+            if (t != Connectivity::invalid) {
+                CHECK(connectivity.twins[t] == h);
+            }
+        }
+    }
+}
+
+TEST_CASE("Connectivity rejects non-manifold edges", "[Connectivity]") {
+    std::vector<std::array<int, 3>> faces{{0, 1, 2}, {1, 0, 3}, {0, 1, 4}};
+    CHECK_THROWS_AS(computeConnectivity(5, faces, 1), std::runtime_error);
+    CHECK_THROWS_AS((Mesh{5, faces}), std::runtime_error);
+}
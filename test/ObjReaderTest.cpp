@@ -0,0 +1,105 @@
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <catch2/catch.hpp>
+#include <ObjReader.h>
+
+using Faces = std::vector<std::array<int, 3>>;
+
+TEST_CASE("Reads vertices and triangles", "[OBJReader]") {
+    auto data = parseOBJ(
+        "# a comment\n"
+        "v 0 0 0\n"
+        "v 1.5 -2e-1 +3\n"
+        "v 0 1 0 1.0\n"
+        "f 1 2 3\n"
+    );
+    REQUIRE(data.positions.size() == 3);
+    CHECK(data.positions[1] == Geometry::Point{1.5, -0.2, 3});
+    CHECK(data.faces == Faces{{0, 1, 2}});
+}
+
+TEST_CASE("Ignores texture and normal references", "[OBJReader]") {
+    auto data = parseOBJ(
+        "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+        "vt 0 0\nvn 0 0 1\n"
+        "f 1/1 2/1/1 3//1\r\n"
+        "f 3/1/1 2/1/1 1/1/1 # trailing comment\n"
+    );
+    CHECK(data.faces == Faces{{0, 1, 2}, {2, 1, 0}});
+}
+
+TEST_CASE("Resolves negative indices", "[OBJReader]") {
+    auto data = parseOBJ(
+        "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+        "f -3 -2 -1\n"
+        "v 1 1 0\n"
+        "f -3/-3 -1/-1 -2/-2\n"
+    );
+    CHECK(data.faces == Faces{{0, 1, 2}, {1, 3, 2}});
+}
+
+TEST_CASE("Triangulates polygons as fans", "[OBJReader]") {
+    auto data = parseOBJ(
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 0 0\n"
+        "f 1 2 3 4\n"
+        "f 1 2 3 4 5\n"
+    );
+    CHECK(data.faces == Faces{{0, 1, 2}, {0, 2, 3}, {0, 1, 2}, {0, 2, 3}, {0, 3, 4}});
+}
+
+TEST_CASE("Reads indices with leading zeros", "[OBJReader]") {
+    auto data = parseOBJ("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 000000000003\n");
+    CHECK(data.faces == Faces{{0, 1, 2}});
+}
+
+TEST_CASE("Rejects malformed documents", "[OBJReader]") {
+    CHECK_THROWS_AS(parseOBJ("v 0 0\n"), std::runtime_error);
+    CHECK_THROWS_AS(parseOBJ("v 0 0 0\nf 1 2\n"), std::runtime_error);
+    CHECK_THROWS_AS(parseOBJ("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n"), std::runtime_error);
+    CHECK_THROWS_AS(parseOBJ("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 0 1 2\n"), std::runtime_error);
+    CHECK_THROWS_AS(parseOBJ("l 1 2\n"), std::runtime_error);
+    CHECK_THROWS_AS(parseOBJ("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 2147483648\n"), std::runtime_error);
+    CHECK_THROWS_AS(parseOBJ("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 99999999999999999999\n"), std::runtime_error);
+}
+
+TEST_CASE("Rejects files without faces", "[OBJReader]") {
+    std::string path = "/tmp/halfedge-test-empty.obj";
+    std::ofstream{path} << "v 0 0 0\n";
+    CHECK_THROWS_AS(readOBJ(path), std::runtime_error);
+    std::remove(path.c_str());
+
+    std::istringstream text{"# nothing\n"};
+    CHECK_THROWS_AS(Geometry{text}, std::runtime_error);
+}
+
+TEST_CASE("Chunked parsing matches a single pass", "[OBJReader]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str() + "\nf -1 -2 -3\n";
+
+    auto expected = parseOBJ(text, 1);
+    CHECK(expected.positions.size() == 2503);
+    CHECK(expected.faces.size() == 4969);
+
+    for (unsigned chunks: {2, 7, 64}) {
+        auto data = parseOBJ(text, 4, chunks);
+        CHECK(data.positions == expected.positions);
+        CHECK(data.faces == expected.faces);
+    }
+
+    auto mapped = readOBJ("test/models/bunny.obj", 1);
+    CHECK(mapped.positions == expected.positions);
+}
+
+TEST_CASE("Parses numbers to the nearest double", "[OBJReader]") {
+    std::vector<std::string> numbers{
+        "1.3031957e-001", "-8.1719160e-002", "0.1", "-0", "123456789012345",
+        "1234567890123456789", "1e-300", "2.5E+10", ".5", "5.", "0.000000000000000000000001"
+    };
+    for (auto &number: numbers) {
+        auto data = parseOBJ("v " + number + " 0 0\n");
+        CHECK(data.positions[0][0] == std::strtod(number.c_str(), nullptr));
+    }
+}
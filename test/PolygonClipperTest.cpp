@@ -0,0 +1,265 @@
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <PolygonClipper.h>
+#include "Helpers.h"
+
+namespace {
+
+IntPolygon rectangle(int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+    return {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+}
+
+double totalArea(const IntPolygons &polygons) {
+    double sum = 0;
+    for (const IntPolygon &polygon: polygons) sum += area(polygon);
+    return sum;
+}
+
+double totalArea(const Slicer::Polygons &polygons) {
+    return signedArea(polygons);
+}
+
+int winding(const IntPolygons &polygons, double x, double y) {
+    int w = 0;
+    for (const IntPolygon &polygon: polygons) {
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const IntPoint &a = polygon[j], &b = polygon[i];
+            if ((a[1] <= y) == (b[1] <= y)) continue;
+            double cx = a[0] + (y - a[1]) * (b[0] - a[0]) / double(b[1] - a[1]);
+            if (cx > x) w += b[1] > a[1] ? 1 : -1;
+        }
+    }
+    return w;
+}
+
+double boundaryDistance(const IntPolygons &polygons, double x, double y) {
+    double d = INFINITY;
+    for (const IntPolygon &polygon: polygons) {
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            d = std::min(d, segmentDistance(std::array<double, 2>{x, y}, polygon[j], polygon[i]));
+        }
+    }
+    return d;
+}
+
+// Whether any two edges of the polygons cross other than at shared
+// vertices.
+bool hasCrossings(const IntPolygons &polygons) {
+    std::vector<std::array<IntPoint, 2>> edges;
+    for (const IntPolygon &polygon: polygons) {
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) edges.push_back({polygon[j], polygon[i]});
+    }
+    auto orient = [](const IntPoint &a, const IntPoint &b, const IntPoint &c) {
+        __int128 v = __int128(b[0] - a[0]) * (c[1] - a[1]) - __int128(b[1] - a[1]) * (c[0] - a[0]);
+        return (v > 0) - (v < 0);
+    };
+    for (size_t i = 0; i < edges.size(); i++) {
+        for (size_t j = i + 1; j < edges.size(); j++) {
+            auto [a, b] = edges[i];
+            auto [c, d] = edges[j];
+            if (orient(a, b, c) * orient(a, b, d) < 0 && orient(c, d, a) * orient(c, d, b) < 0) return true;
+        }
+    }
+    return false;
+}
+
+// A polygon through random points of a coarse lattice, which crosses itself
+// many times.
+IntPolygon randomPolygon(std::mt19937 &random, int vertices) {
+    std::uniform_int_distribution<int64_t> coordinate{-40, 40};
+    IntPolygon polygon;
+    for (int i = 0; i < vertices; i++) polygon.push_back({coordinate(random) * 997, coordinate(random) * 991});
+    return polygon;
+}
+
+}
+
+TEST_CASE("Booleans of overlapping squares", "[PolygonClipper]") {
+    PolygonClipper clipper;
+    IntPolygons a{rectangle(0, 0, 10, 10)}, b{rectangle(5, 5, 15, 15)}, result;
+
+    clipper.execute(ClipType::Union, a, b, FillRule::NonZero, result);
+    REQUIRE(result.size() == 1);
+    CHECK(result[0].size() == 8);
+    CHECK(area(result[0]) == 175);
+
+    clipper.execute(ClipType::Intersection, a, b, FillRule::NonZero, result);
+    REQUIRE(result.size() == 1);
+    CHECK(result[0] == IntPolygon{{5, 5}, {10, 5}, {10, 10}, {5, 10}});
+
+    clipper.execute(ClipType::Difference, a, b, FillRule::NonZero, result);
+    REQUIRE(result.size() == 1);
+    CHECK(area(result[0]) == 75);
+
+    clipper.execute(ClipType::Xor, a, b, FillRule::NonZero, result);
+    REQUIRE(result.size() == 2);
+    CHECK(totalArea(result) == 150);
+
+    // A hole runs clockwise.
+    clipper.execute(ClipType::Difference, {rectangle(0, 0, 10, 10)}, {rectangle(2, 2, 8, 8)}, FillRule::NonZero, result);
+    REQUIRE(result.size() == 2);
+    CHECK(std::max(area(result[0]), area(result[1])) == 100);
+    CHECK(std::min(area(result[0]), area(result[1])) == -36);
+
+    // Squares that touch at a corner stay apart, and so do squares that
+    // share an edge once merged.
+    clipper.execute(ClipType::Union, {rectangle(0, 0, 10, 10), rectangle(10, 10, 20, 20)}, {}, FillRule::NonZero, result);
+    CHECK(result.size() == 2);
+    clipper.execute(ClipType::Union, {rectangle(0, 0, 10, 10), rectangle(10, 0, 20, 10)}, {}, FillRule::NonZero, result);
+    REQUIRE(result.size() == 1);
+    CHECK(result[0] == rectangle(0, 0, 20, 10));
+
+    // Reversed input is normalized to counter-clockwise under even-odd.
+    IntPolygon reversed = rectangle(0, 0, 10, 10);
+    std::reverse(reversed.begin(), reversed.end());
+    clipper.execute(ClipType::Union, {reversed}, {}, FillRule::EvenOdd, result);
+    REQUIRE(result.size() == 1);
+    CHECK(area(result[0]) == 100);
+    clipper.execute(ClipType::Union, {reversed}, {}, FillRule::Positive, result);
+    CHECK(result.empty());
+}
+
+TEST_CASE("Booleans of random self-intersecting polygons match point sampling", "[PolygonClipper]") {
+    std::mt19937 random{3};
+    PolygonClipper clipper;
+    auto rule = GENERATE(FillRule::EvenOdd, FillRule::NonZero, FillRule::Positive);
+    auto op = GENERATE(ClipType::Union, ClipType::Intersection, ClipType::Difference, ClipType::Xor);
+
+    for (int trial = 0; trial < 8; trial++) {
+        IntPolygons subject{randomPolygon(random, 12), randomPolygon(random, 7)};
+        IntPolygons clip{randomPolygon(random, 10)};
+        IntPolygons result;
+        clipper.execute(op, subject, clip, rule, result);
+        REQUIRE_FALSE(hasCrossings(result));
+
+        auto filled = [&](int w) {
+            return rule == FillRule::EvenOdd ? (w & 1) != 0 : rule == FillRule::NonZero ? w != 0 : w > 0;
+        };
+        std::uniform_real_distribution<double> unit{-40000, 40000};
+        int tested = 0;
+        for (int k = 0; k < 400; k++) {
+            double x = unit(random), y = unit(random);
+            // Snapping moves edges by under a unit.
+            if (boundaryDistance(subject, x, y) < 2 || boundaryDistance(clip, x, y) < 2) continue;
+            bool s = filled(winding(subject, x, y)), c = filled(winding(clip, x, y));
+            bool expected = op == ClipType::Union ? s || c : op == ClipType::Intersection ? s && c
+                          : op == ClipType::Difference ? s && !c : s != c;
+            // The result is simple, with holes reversed, so any point inside
+            // has winding 1.
+            int w = winding(result, x, y);
+            REQUIRE((w == 0 || w == 1));
+            REQUIRE(w == int(expected));
+            tested++;
+        }
+        CHECK(tested > 300);
+    }
+}
+
+TEST_CASE("Booleans of nearly coincident edges stay simple", "[PolygonClipper]") {
+    // Long edges a unit apart cross many short ones, so crossings round onto
+    // the pixels of other edges.
+    std::mt19937 random{9};
+    std::uniform_int_distribution<int64_t> coordinate{0, 200};
+    PolygonClipper clipper;
+    for (int trial = 0; trial < 20; trial++) {
+        IntPolygons subject, clip;
+        for (int i = 0; i < 6; i++) {
+            subject.push_back({{coordinate(random), coordinate(random)}, {coordinate(random), coordinate(random)},
+                               {coordinate(random), coordinate(random)}});
+            clip.push_back({{0, i}, {200, i + 1}, {200, 200 - i}});
+        }
+        IntPolygons result;
+        clipper.execute(ClipType::Union, subject, clip, FillRule::NonZero, result);
+        REQUIRE_FALSE(hasCrossings(result));
+        for (const IntPolygon &polygon: result) CHECK(polygon.size() >= 3);
+    }
+}
+
+TEST_CASE("Offsetting a square with each join", "[PolygonClipper]") {
+    const Slicer::Polygons square{{{0, 0}, {10, 0}, {10, 10}, {0, 10}, {0, 0}}};
+
+    OffsetSettings settings;
+    auto grown = offsetPolygons(square, 1, settings);
+    REQUIRE(grown.size() == 1);
+    CHECK(totalArea(grown) == Approx(144));
+
+    settings.join = JoinType::Square;
+    // Each corner loses a triangle beyond the bisector at distance 1.
+    const double cut = (2 - std::sqrt(2)) * (2 - std::sqrt(2)) / 2;
+    CHECK(totalArea(offsetPolygons(square, 1, settings)) == Approx(140 + 4 * (1 - cut)));
+
+    settings.join = JoinType::Round;
+    settings.arcTolerance = 1e-4;
+    CHECK(totalArea(offsetPolygons(square, 1, settings)) == Approx(140 + M_PI).epsilon(1e-4));
+
+    // Shrinking leaves sharp corners whatever the join, which only applies
+    // at the inner corner of an L.
+    const Slicer::Polygons ell{{{0, 0}, {10, 0}, {10, 4}, {4, 4}, {4, 10}, {0, 10}, {0, 0}}};
+    const std::pair<JoinType, double> joins[] = {
+        {JoinType::Miter, 28}, {JoinType::Square, 28 + cut}, {JoinType::Round, 29 - M_PI / 4},
+    };
+    for (auto [join, expected]: joins) {
+        settings.join = join;
+        auto shrunk = offsetPolygons(square, -1, settings);
+        REQUIRE(shrunk.size() == 1);
+        CHECK(totalArea(shrunk) == Approx(64));
+        CHECK(offsetPolygons(square, -5.5, settings).empty());
+        CHECK(totalArea(offsetPolygons(ell, -1, settings)) == Approx(expected).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Offsetting a ring shrinks the material from both sides", "[PolygonClipper]") {
+    Slicer::Polygons ring{{{0, 0}, {20, 0}, {20, 20}, {0, 20}, {0, 0}}, {{5, 5}, {15, 5}, {15, 15}, {5, 15}, {5, 5}}};
+    // The hole runs the same way as the outer boundary here; the offset
+    // normalizes it first.
+    auto shrunk = offsetPolygons(ring, -1);
+    REQUIRE(shrunk.size() == 2);
+    CHECK(totalArea(shrunk) == Approx(18 * 18 - 12 * 12));
+    CHECK(offsetPolygons(ring, -2.6).empty());
+    auto grown = offsetPolygons(ring, 1);
+    CHECK(totalArea(grown) == Approx(22 * 22 - 8 * 8));
+}
+
+TEST_CASE("Perimeters of a disc are concentric", "[PolygonClipper]") {
+    Slicer::Polygon circle;
+    for (int i = 0; i <= 360; i++) {
+        circle.push_back({10 * std::cos(i * M_PI / 180), 10 * std::sin(i * M_PI / 180)});
+    }
+    OffsetSettings settings;
+    settings.join = JoinType::Round;
+    auto shells = perimeters({circle}, 3, 0.4, settings);
+    REQUIRE(shells.size() == 3);
+    const double polygonArea = totalArea(Slicer::Polygons{circle});
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(shells[i].size() == 1);
+        double r = 10 - (i + 0.5) * 0.4;
+        CHECK(totalArea(shells[i]) == Approx(polygonArea * r * r / 100).epsilon(1e-3));
+    }
+    CHECK(perimeters({circle}, 100, 0.4, settings).size() == 25);
+}
+
+TEST_CASE("Offsetting sliced layers in parallel", "[PolygonClipper]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    std::vector<Slicer::Polygons> layers;
+    Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.005), [&](int, double, const Slicer::Polygons &polygons) {
+        layers.push_back(polygons);
+    });
+
+    auto serial = offsetLayers(layers, -0.002, {}, 1);
+    auto parallel = offsetLayers(layers, -0.002, {}, 3);
+    REQUIRE(serial == parallel);
+
+    size_t nonEmpty = 0;
+    for (size_t i = 0; i < layers.size(); i++) {
+        // Inward offsets lose area to every boundary.
+        const double before = totalArea(clipPolygons(ClipType::Union, layers[i], {}));
+        CHECK(totalArea(serial[i]) <= before);
+        IntPolygons offset = toIntPolygons(serial[i], 1e5);
+        CHECK_FALSE(hasCrossings(offset));
+        nonEmpty += !serial[i].empty();
+    }
+    CHECK(nonEmpty > layers.size() / 2);
+}
@@ -0,0 +1,175 @@
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <png.h>
+#include <Rasterizer.h>
+#include <Slicer.h>
+
+namespace {
+
+// Tests every pixel center against every edge: a pixel is set when an odd
+// number of edges cross its row at or to the left of its center.
+Mask referenceMask(const Slicer::Polygons &polygons, const RasterSettings &settings) {
+    Mask mask;
+    mask.width = settings.width;
+    mask.height = settings.height;
+    mask.bits = 8;
+    mask.stride = settings.width;
+    mask.data.assign(settings.width * settings.height, 0);
+
+    auto device = [&](const Slicer::Point &p) -> Slicer::Point {
+        double scale = 1 / settings.pitch;
+        return {
+            std::nearbyint((scale * p[0] + settings.width / 2.0 - settings.centerX * scale) * 256) / 256,
+            std::nearbyint((scale * p[1] + settings.height / 2.0 - settings.centerY * scale) * 256) / 256,
+        };
+    };
+
+    std::vector<std::array<Slicer::Point, 2>> edges;
+    for (auto &polygon: polygons) {
+        for (size_t i = 0; i < polygon.size(); i++) {
+            auto a = device(polygon[i]), b = device(polygon[(i + 1) % polygon.size()]);
+            if (a[1] > b[1]) std::swap(a, b);
+            if (a[1] != b[1]) edges.push_back({a, b});
+        }
+    }
+
+    for (int y = 0; y < settings.height; y++) {
+        double yc = y + 0.5;
+        for (int x = 0; x < settings.width; x++) {
+            int crossings = 0;
+            for (auto &[a, b]: edges) {
+                if (yc < a[1] || yc >= b[1]) continue;
+                double xc = a[0] + (yc - a[1]) * (b[0] - a[0]) / (b[1] - a[1]);
+                if (xc <= x + 0.5) crossings++;
+            }
+            mask.data[y * mask.stride + x] = crossings % 2;
+        }
+    }
+    return mask;
+}
+
+Mask readPNG(const std::string &path) {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    REQUIRE(file);
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png_create_info_struct(png);
+    png_init_io(png, file);
+    png_read_info(png, info);
+
+    Mask mask;
+    mask.width = png_get_image_width(png, info);
+    mask.height = png_get_image_height(png, info);
+    mask.bits = png_get_bit_depth(png, info);
+    mask.stride = png_get_rowbytes(png, info);
+    mask.data.resize(mask.stride * mask.height);
+    for (int y = 0; y < mask.height; y++) {
+        png_read_row(png, &mask.data[y * mask.stride], nullptr);
+    }
+    png_destroy_read_struct(&png, &info, nullptr);
+    std::fclose(file);
+    return mask;
+}
+
+}
+
+TEST_CASE("Rasterized layers match a pixel-center point-in-polygon test", "[Rasterizer]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+
+    RasterSettings settings;
+    settings.width = 203;
+    settings.height = 157;
+    settings.pitch = 0.0013;
+    settings.centerX = -0.02;
+    settings.centerY = 0.11;
+    settings.bits = GENERATE(1, 8);
+
+    size_t filled = 0;
+    Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.01), [&](int, double, const Slicer::Polygons &polygons) {
+        Mask mask;
+        rasterize(polygons, settings, mask);
+        Mask expected = referenceMask(polygons, settings);
+        for (int y = 0; y < mask.height; y++) {
+            for (int x = 0; x < mask.width; x++) {
+                int value = mask.at(x, y);
+                REQUIRE(value == expected.at(x, y) * (settings.bits == 1 ? 1 : 255));
+                filled += value != 0;
+            }
+        }
+    });
+    CHECK(filled > 0);
+}
+
+TEST_CASE("Pixels are set when their centers are inside", "[Rasterizer]") {
+    // A 2 by 2 square covers 40 by 40 pixels at the default pitch, with its
+    // corner on the corner of pixel (940, 520).
+    Slicer::Polygons square{{{-1, -1}, {1, -1}, {1, 1}, {-1, 1}, {-1, -1}}};
+    Mask mask;
+    rasterize(square, RasterSettings{}, mask);
+    CHECK(mask.stride == 240);
+
+    int count = 0;
+    for (int y = 0; y < mask.height; y++) {
+        for (int x = 0; x < mask.width; x++) count += mask.at(x, y);
+    }
+    CHECK(count == 1600);
+    CHECK(mask.at(940, 520) == 1);
+    CHECK(mask.at(979, 559) == 1);
+    CHECK(mask.at(939, 520) == 0);
+    CHECK(mask.at(980, 559) == 0);
+
+    // A hole, wound either way, is cleared by the even-odd rule.
+    square.push_back({{-0.5, -0.5}, {-0.5, 0.5}, {0.5, 0.5}, {0.5, -0.5}, {-0.5, -0.5}});
+    rasterize(square, RasterSettings{}, mask);
+    CHECK(mask.at(960, 540) == 0);
+    CHECK(mask.at(945, 540) == 1);
+}
+
+TEST_CASE("Supersampling stores the covered fraction of each pixel", "[Rasterizer]") {
+    // The square covers pixel column 960 fully and half of column 961.
+    Slicer::Polygons square{{{0, 0}, {0.075, 0}, {0.075, 0.05}, {0, 0.05}, {0, 0}}};
+    RasterSettings settings;
+    settings.bits = 8;
+    settings.supersample = 4;
+
+    Mask mask;
+    rasterize(square, settings, mask);
+    CHECK(mask.at(960, 540) == 255);
+    CHECK(mask.at(961, 540) == 128);
+    CHECK(mask.at(962, 540) == 0);
+    CHECK(mask.at(960, 541) == 0);
+}
+
+TEST_CASE("The mask writer encodes PNG files in the background", "[Rasterizer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    auto bits = GENERATE(1, 8);
+
+    RasterSettings settings;
+    settings.bits = bits;
+    std::vector<Mask> masks;
+    {
+        MaskWriter writer{2};
+        Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.25), [&](int layer, double, const Slicer::Polygons &polygons) {
+            Mask mask;
+            rasterize(polygons, settings, mask);
+            masks.push_back(mask);
+            writer.write(std::move(mask), "/tmp/halfedge-test-layer" + std::to_string(layer) + ".png");
+        });
+        writer.finish();
+    }
+
+    for (size_t i = 0; i < masks.size(); i++) {
+        std::string path = "/tmp/halfedge-test-layer" + std::to_string(i) + ".png";
+        Mask decoded = readPNG(path);
+        CHECK(decoded.bits == bits);
+        CHECK(decoded.data == masks[i].data);
+        std::remove(path.c_str());
+    }
+
+    MaskWriter writer;
+    writer.write(masks[0], "/nonexistent/layer.png");
+    CHECK_THROWS_AS(writer.finish(), std::runtime_error);
+}
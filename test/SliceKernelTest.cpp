@@ -0,0 +1,114 @@
+#include <fstream>
+#include <algorithm>
+#include <tuple>
+#include <catch2/catch.hpp>
+#include <SliceKernel.h>
+#include <Slicer.h>
+
+namespace {
+
+template <typename T>
+std::vector<Segment<T>> intersectAll(const SoaMesh<T> &mesh, const std::vector<T> &zs, SimdLevel level) {
+    std::vector<Segment<T>> segments;
+    intersectTriangles(mesh, 0, mesh.faceCount(), zs.data(), zs.size(), segments, level);
+    std::sort(segments.begin(), segments.end(), [](auto &a, auto &b) {
+        return std::tie(a.plane, a.face) < std::tie(b.plane, b.face);
+    });
+    return segments;
+}
+
+}
+
+template <typename T>
+static bool operator==(const Segment<T> &a, const Segment<T> &b) {
+    return a.face == b.face && a.plane == b.plane && a.entry == b.entry && a.exit == b.exit
+        && a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
+}
+
+TEST_CASE("Every ISA produces the same segments as the scalar kernel", "[SliceKernel]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+
+    // Include planes exactly at vertex heights.
+    std::vector<double> zs = Slicer::uniformLayers(geometry, 0.01);
+    for (int i = 0; i < geometry.positions().size(); i += 301) {
+        zs.push_back(geometry.positions()[i][2]);
+    }
+    std::vector<float> zsf(zs.begin(), zs.end());
+
+    SoaMesh<double> mesh{geometry};
+    SoaMesh<float> meshf{geometry};
+    auto expected = intersectAll(mesh, zs, SimdLevel::Scalar);
+    auto expectedf = intersectAll(meshf, zsf, SimdLevel::Scalar);
+    REQUIRE(!expected.empty());
+
+    for (SimdLevel level: {SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > supportedSimd()) continue;
+        INFO(simdName(level));
+        CHECK(intersectAll(mesh, zs, level) == expected);
+        CHECK(intersectAll(meshf, zsf, level) == expectedf);
+    }
+}
+
+TEST_CASE("Spanned planes give the same segments as every plane", "[SliceKernel]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+
+    // Fine enough that many faces span more planes than a vector holds.
+    std::vector<double> zs = Slicer::uniformLayers(geometry, 0.0005);
+    std::vector<float> zsf(zs.begin(), zs.end());
+    SoaMesh<double> mesh{geometry};
+    SoaMesh<float> meshf{geometry};
+    auto expected = intersectAll(mesh, zs, SimdLevel::Scalar);
+    auto expectedf = intersectAll(meshf, zsf, SimdLevel::Scalar);
+
+    for (SimdLevel level: {SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > supportedSimd()) continue;
+        INFO(simdName(level));
+
+        std::vector<Segment<double>> segments;
+        std::vector<Segment<float>> segmentsf;
+        intersectSpans(mesh, 0, mesh.faceCount(), zs.data(), zs.size(), segments, level);
+        intersectSpans(meshf, 0, meshf.faceCount(), zsf.data(), zsf.size(), segmentsf, level);
+        CHECK(std::is_sorted(segments.begin(), segments.end(), [](auto &a, auto &b) {
+            return std::tie(a.face, a.plane) < std::tie(b.face, b.plane);
+        }));
+
+        auto byPlane = [](auto &a, auto &b) { return std::tie(a.plane, a.face) < std::tie(b.plane, b.face); };
+        std::sort(segments.begin(), segments.end(), byPlane);
+        std::sort(segmentsf.begin(), segmentsf.end(), byPlane);
+        CHECK(segments == expected);
+        CHECK(segmentsf == expectedf);
+    }
+}
+
+TEST_CASE("Kernel segments match the slicer's crossings", "[SliceKernel]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    SoaMesh<double> mesh{geometry};
+
+    for (double z: {-0.5, 0.0, 0.25, geometry.positions()[7][2]}) {
+        std::vector<Segment<double>> segments;
+        intersectTriangles(mesh, 0, mesh.faceCount(), &z, 1, segments);
+
+        Slicer::Section section{geometry};
+        Slicer::sliceTriangles(geometry, z, section);
+        CHECK(segments.size() == section.segments());
+
+        // Each closed contour visits its segments in order, so every exit
+        // point of the kernel appears as a contour point.
+        size_t points = 0;
+        for (auto &polygon: Slicer::computeContours(section)) points += polygon.size() - 1;
+        std::vector<Slicer::Point> exits;
+        for (auto &s: segments) exits.push_back({s.x1, s.y1});
+        std::sort(exits.begin(), exits.end());
+        exits.erase(std::unique(exits.begin(), exits.end()), exits.end());
+        CHECK(exits.size() == points);
+
+        for (auto &polygon: Slicer::computeContours(section)) {
+            for (auto &p: polygon) {
+                CHECK(std::binary_search(exits.begin(), exits.end(), p));
+            }
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <catch2/catch.hpp>
+#include <SliceServer.h>
+
+TEST_CASE("Thread pools run every task and hold back submitters", "[SliceServer]") {
+    std::atomic<int> done{0};
+    std::vector<int> order;
+    {
+        ThreadPool pool{1, 2};
+        for (int i = 0; i < 100; i++) {
+            pool.submit([&, i]() {
+                order.push_back(i);
+                done++;
+            });
+        }
+        pool.wait();
+        CHECK(done == 100);
+    }
+    for (int i = 0; i < 100; i++) CHECK(order[i] == i);
+
+    // Once the queue is full, submit waits for a worker to take a task.
+    std::atomic<bool> release{false};
+    ThreadPool pool{1, 1};
+    pool.submit([&]() { while (!release) std::this_thread::yield(); });
+    pool.submit([]() {});
+    std::atomic<bool> submitted{false};
+    std::thread submitter{[&]() {
+        pool.submit([]() {});
+        submitted = true;
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!submitted);
+    release = true;
+    submitter.join();
+    CHECK(submitted);
+}
+
+TEST_CASE("Geometry caches keep recent meshes within their budget", "[SliceServer]") {
+    GeometryCache cache{size_t(1) << 30, 1, false};
+    bool hit = true;
+    auto sphere = cache.get("test/models/sphere.obj", &hit);
+    CHECK(!hit);
+    CHECK(cache.get("test/models/sphere.obj", &hit) == sphere);
+    CHECK(hit);
+    CHECK_THROWS_AS(cache.get("test/models/missing.obj"), std::runtime_error);
+
+    // Sessions count against the budget and are reused once released.
+    const size_t bytes = sphere->bytes();
+    auto session = sphere->acquire();
+    const size_t withSession = sphere->bytes();
+    CHECK(withSession > bytes);
+    SliceSession *first = session.get();
+    sphere->release(std::move(session));
+    session = sphere->acquire();
+    CHECK(session.get() == first);
+
+    // Overlapping jobs build more sessions, but only one is kept.
+    auto second = sphere->acquire();
+    CHECK(sphere->bytes() > withSession);
+    sphere->release(std::move(second));
+    sphere->release(std::move(session));
+    CHECK(sphere->bytes() == withSession);
+
+    // A budget of one byte keeps only the mesh requested last, and a
+    // mesh dropped from the cache stays valid for whoever holds it.
+    GeometryCache small{1, 1, false};
+    auto bunny = small.get("test/models/bunny.obj");
+    small.get("test/models/sphere.obj");
+    small.get("test/models/torus.obj");
+    auto stats = small.stats();
+    CHECK(stats.entries == 1);
+    CHECK(stats.misses == 3);
+    CHECK(stats.evictions == 2);
+    CHECK(bunny->geometry().mesh().faces().size() > 0);
+    small.get("test/models/bunny.obj", &hit);
+    CHECK(!hit);
+}
+
+TEST_CASE("Servers slice many concurrent jobs from their cache", "[SliceServer]") {
+    ServerSettings settings;
+    settings.socketPath = "/tmp/halfedge-test.sock";
+    settings.workers = 4;
+    settings.queue = 4;
+    settings.useCacheFiles = false;
+    SliceServer server{settings};
+    std::thread serving{[&]() { server.run(); }};
+
+    const std::string cwd = std::filesystem::current_path();
+    const int clients = 16, jobs = 4;
+    std::atomic<int> ok{0};
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c]() {
+            for (int j = 0; j < jobs; j++) {
+                const std::string stack = "/tmp/halfedge-server-" + std::to_string(c) + ".hels";
+                std::string reply = serverRequest(settings.socketPath, {
+                    "slice", cwd, "--contours-only", "--layer-height", "0.05", "--stack", stack,
+                    (c + j) % 2 ? "test/models/bunny.obj" : "test/models/sphere.obj"
+                });
+                if (reply.rfind("ok layers=", 0) == 0) ok++;
+            }
+        });
+    }
+    for (auto &thread: threads) thread.join();
+    CHECK(ok == clients * jobs);
+
+    std::string status = serverRequest(settings.socketPath, {"status"});
+    CHECK(status.find("meshes=2 ") != std::string::npos);
+    CHECK(status.find("misses=2 ") != std::string::npos);
+    CHECK(status.find("hits=" + std::to_string(clients * jobs - 2) + " ") != std::string::npos);
+    CHECK(status.find("failed=0 ") != std::string::npos);
+
+    // The last stack of each client holds what a session slices.
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    SliceSession session{geometry};
+    SliceSettings job;
+    job.layers.height = 0.05;
+    job.masks = false;
+    MemorySink expected;
+    session.slice(job, expected);
+    LayerStackReader reader{"/tmp/halfedge-server-1.hels"};
+    REQUIRE(reader.layers() == expected.layers().size());
+    for (size_t i = 0; i < reader.layers(); i++) {
+        CHECK(reader.contours(i).size() == expected.layers()[i].polygons.size());
+    }
+    for (int c = 0; c < clients; c++) std::remove(("/tmp/halfedge-server-" + std::to_string(c) + ".hels").c_str());
+
+    CHECK(serverRequest(settings.socketPath, {"slice", cwd, "--output", "/tmp", "test/models/missing.obj"}).rfind("error: ", 0) == 0);
+    CHECK(serverRequest(settings.socketPath, {"slice", cwd, "test/models/sphere.obj"}) == "error: invalid job");
+    CHECK(serverRequest(settings.socketPath, {"slice", cwd, "--pitch", "x", "a.obj"}) == "error: invalid job");
+    CHECK(serverRequest(settings.socketPath, {"slice", cwd, "--pitch", "1e999", "a.obj"}) == "error: invalid job");
+    CHECK(serverRequest(settings.socketPath, {"slice", cwd, "--pitch", "2mm", "a.obj"}) == "error: invalid job");
+    CHECK(serverRequest(settings.socketPath, {"slice", cwd, "--bits", "16", "a.obj"}) == "error: invalid job");
+    CHECK(serverRequest(settings.socketPath, {"slice", cwd, "--antialias", "-3", "a.obj"}) == "error: invalid job");
+    CHECK(serverRequest(settings.socketPath, {"bogus"}).rfind("error: ", 0) == 0);
+    CHECK(serverRequest(settings.socketPath, {"stop"}) == "ok");
+    serving.join();
+    CHECK_THROWS_AS(serverRequest("/tmp/halfedge-missing.sock", {"status"}), std::runtime_error);
+}
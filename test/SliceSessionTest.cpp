@@ -0,0 +1,127 @@
+#include <fstream>
+#include <cstdio>
+#include <catch2/catch.hpp>
+#include <SliceSession.h>
+
+namespace {
+
+std::vector<Slicer::Polygons> sliceAll(const Geometry &geometry, const std::vector<double> &zs) {
+    std::vector<Slicer::Polygons> layers;
+    Slicer::sliceLayers(geometry, zs, [&](int, double, const Slicer::Polygons &polygons) {
+        layers.push_back(polygons);
+    });
+    return layers;
+}
+
+}
+
+TEST_CASE("Sessions slice repeated jobs like sliceLayers", "[SliceSession]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj");
+    std::ifstream file{"test/models/" + model};
+    Geometry geometry{file};
+    SliceSession session{geometry};
+
+    SliceSettings settings;
+    settings.layers.height = (session.maxZ() - session.minZ()) / 50;
+    settings.masks = false;
+    const auto zs = session.layers(settings);
+    CHECK(zs == Slicer::uniformLayers(geometry, settings.layers.height));
+    const auto expected = sliceAll(geometry, zs);
+
+    // Every job on the session reuses what the first one built, whatever
+    // the number of workers, and delivers the same layers.
+    for (unsigned threads: {1u, 3u, 1u, 2u}) {
+        settings.threads = threads;
+        MemorySink sink;
+        session.slice(settings, sink);
+        REQUIRE(sink.layers().size() == zs.size());
+        for (size_t i = 0; i < zs.size(); i++) {
+            CHECK(sink.layers()[i].z == zs[i]);
+            CHECK(sink.layers()[i].polygons == expected[i]);
+            CHECK(sink.layers()[i].mask.data.empty());
+        }
+    }
+
+    for (size_t i = 0; i < zs.size(); i += 7) {
+        CHECK(session.sliceAt(zs[i]) == expected[i]);
+    }
+}
+
+TEST_CASE("Session bounds select a band of the schedule", "[SliceSession]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    SliceSession session{geometry};
+
+    SliceSettings settings;
+    settings.layers.height = (session.maxZ() - session.minZ()) / 40;
+    settings.layers.adaptive = true;
+    settings.layers.minHeight = settings.layers.height / 4;
+    settings.layers.tolerance = settings.layers.height / 10;
+    const auto all = session.layers(settings);
+    CHECK(all == Slicer::layerSchedule(geometry, settings.layers));
+
+    settings.minZ = all[10];
+    settings.maxZ = (all[20] + all[21]) / 2;
+    const auto band = session.layers(settings);
+    CHECK(band == std::vector<double>(all.begin() + 10, all.begin() + 21));
+
+    settings.masks = false;
+    std::vector<double> zs;
+    CallbackSink sink{[&](const SliceLayer &layer) {
+        CHECK(layer.index == zs.size());
+        CHECK(layer.polygons == Slicer::sliceLayer(geometry, Slicer::faceTree(geometry), layer.z));
+        zs.push_back(layer.z);
+    }};
+    session.slice(settings, sink);
+    CHECK(zs == band);
+}
+
+TEST_CASE("Session sinks rasterize and write layers", "[SliceSession]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    SliceSession session{geometry};
+
+    SliceSettings settings;
+    settings.layers.height = 0.1;
+    settings.raster.width = settings.raster.height = 120;
+    settings.raster.pitch = 0.02;
+    settings.threads = 2;
+
+    MemorySink memory;
+    session.slice(settings, memory);
+    REQUIRE(memory.layers().size() == session.layers(settings).size());
+    for (const auto &layer: memory.layers()) {
+        Mask mask;
+        rasterize(layer.polygons, settings.raster, mask);
+        CHECK(layer.mask.data == mask.data);
+    }
+
+    const std::string path = "/tmp/halfedge-session.hels";
+    LayerStackSink stack{path};
+    session.slice(settings, stack);
+    {
+        LayerStackReader reader{path};
+        REQUIRE(reader.layers() == memory.layers().size());
+        CHECK(reader.settings().masks);
+        Mask mask;
+        for (size_t i = 0; i < reader.layers(); i++) {
+            CHECK(reader.z(i) == memory.layers()[i].z);
+            CHECK(reader.contours(i).size() == memory.layers()[i].polygons.size());
+            reader.mask(i, mask);
+            CHECK(mask.data == memory.layers()[i].mask.data);
+        }
+    }
+    std::remove(path.c_str());
+
+    settings.maxZ = session.minZ() + 0.25;
+    PngSink png{"/tmp"};
+    session.slice(settings, png);
+    for (int i = 0; i < 3; i++) {
+        const std::string image = "/tmp/slice" + std::to_string(i) + ".png";
+        CHECK(std::ifstream{image}.good());
+        std::remove(image.c_str());
+    }
+
+    settings.masks = false;
+    CHECK_THROWS_AS(session.slice(settings, png), std::runtime_error);
+}
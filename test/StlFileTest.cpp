@@ -0,0 +1,100 @@
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <catch2/catch.hpp>
+#include <StlFile.h>
+#include <ObjReader.h>
+
+TEST_CASE("Welds an ASCII tetrahedron", "[STLReader]") {
+    std::string path = "/tmp/halfedge-test-ascii.stl";
+    {
+        std::ofstream out{path};
+        double v[4][3] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        int f[4][3] = {{0, 2, 1}, {0, 1, 3}, {0, 3, 2}, {1, 2, 3}};
+        out << "solid tetra\n";
+        for (auto &face: f) {
+            out << "  facet normal 0 0 0\n    outer loop\n";
+            for (int i: face) {
+                // Perturb each corner within the welding tolerance.
+                out << "      vertex " << v[i][0] + 1e-8 * i << " " << v[i][1] << " " << v[i][2] - 1e-8 << "\r\n";
+            }
+            out << "    endloop\n  endfacet\n";
+        }
+        out << "endsolid tetra\n";
+    }
+
+    MeshData data = readSTL(path);
+    std::remove(path.c_str());
+    CHECK(data.positions.size() == 4);
+    CHECK(data.faces.size() == 4);
+
+    Geometry geometry{std::move(data.positions), data.faces};
+    CHECK(geometry.mesh().closed());
+    CHECK(geometry.mesh().eulerCharacteristic() == 2);
+}
+
+TEST_CASE("Binary round trip recovers shared connectivity", "[STLReader]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry sphere{file};
+
+    std::string path = "/tmp/halfedge-test-binary.stl";
+    writeSTL(path, sphere);
+
+    // The header starts with "solid" to check that binary files are not
+    // mistaken for ASCII.
+    {
+        std::fstream patch{path, std::ios::in | std::ios::out | std::ios::binary};
+        patch.write("solid", 5);
+    }
+
+    MeshData data = readSTL(path);
+    std::remove(path.c_str());
+    CHECK(data.positions.size() == sphere.positions().size());
+    CHECK(data.faces.size() == sphere.mesh().faces().size());
+
+    Geometry geometry{std::move(data.positions), data.faces};
+    CHECK(geometry.mesh().closed());
+    CHECK(geometry.mesh().eulerCharacteristic() == sphere.mesh().eulerCharacteristic());
+}
+
+TEST_CASE("Drops triangles that collapse when welded", "[STLReader]") {
+    std::string path = "/tmp/halfedge-test-degenerate.stl";
+    {
+        std::ofstream out{path};
+        out << "solid s\nfacet normal 0 0 0\nouter loop\n"
+            << "vertex 0 0 0\nvertex 1 0 0\nvertex 0 0.0000001 0\n"
+            << "endloop\nendfacet\nfacet normal 0 0 0\nouter loop\n"
+            << "vertex 0 0 0\nvertex 1 0 0\nvertex 0 1 0\n"
+            << "endloop\nendfacet\nendsolid s\n";
+    }
+    MeshData data = readSTL(path);
+    std::remove(path.c_str());
+    CHECK(data.faces == std::vector<std::array<int, 3>>{{0, 1, 2}});
+}
+
+TEST_CASE("Rejects truncated STL files", "[STLReader]") {
+    std::string path = "/tmp/halfedge-test-truncated.stl";
+    {
+        std::ofstream out{path};
+        out << "solid s\nfacet normal 0 0 0\nouter loop\nvertex 0 0 0\nvertex 1 0 0\n";
+    }
+    CHECK_THROWS_AS(readSTL(path), std::runtime_error);
+    std::remove(path.c_str());
+    CHECK_THROWS_AS(readSTL(path), std::runtime_error);
+}
+
+TEST_CASE("Rejects STL files without triangles", "[STLReader]") {
+    std::string path = "/tmp/halfedge-test-empty.stl";
+    {
+        std::ofstream out{path};
+        out << "solid x\nendsolid x\n";
+    }
+    CHECK_THROWS_AS(readSTL(path), std::runtime_error);
+    {
+        std::ofstream out{path, std::ios::binary};
+        char header[84] = {};
+        out.write(header, sizeof(header));
+    }
+    CHECK_THROWS_AS(readSTL(path), std::runtime_error);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,130 @@
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <StreamSlicer.h>
+#include <StlFile.h>
+
+namespace {
+
+// Writes a closed cylinder of radius 1 around the z axis, from z = 0 to
+// z = height, as a binary STL file one triangle at a time.
+size_t writeCylinder(const std::string &path, int rings, int segments, double height) {
+    std::ofstream file{path, std::ios::binary};
+    char header[80] = "cylinder";
+    uint32_t count = 2 * segments * rings + 2 * segments;
+    file.write(header, sizeof(header));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    auto point = [&](int ring, int segment) -> std::array<float, 3> {
+        double angle = 2 * M_PI * (segment % segments) / segments;
+        return {float(std::cos(angle)), float(std::sin(angle)), float(height * ring / rings)};
+    };
+    auto triangle = [&](std::array<float, 3> a, std::array<float, 3> b, std::array<float, 3> c) {
+        char record[50] = {};
+        std::memcpy(record + 12, a.data(), 12);
+        std::memcpy(record + 24, b.data(), 12);
+        std::memcpy(record + 36, c.data(), 12);
+        file.write(record, sizeof(record));
+    };
+
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            triangle(point(r, s), point(r, s + 1), point(r + 1, s + 1));
+            triangle(point(r, s), point(r + 1, s + 1), point(r + 1, s));
+        }
+    }
+    std::array<float, 3> bottom{0, 0, 0}, top{0, 0, float(height)};
+    for (int s = 0; s < segments; s++) {
+        triangle(bottom, point(0, s + 1), point(0, s));
+        triangle(top, point(rings, s), point(rings, s + 1));
+    }
+    return count;
+}
+
+double area(const Slicer::Polygon &polygon) {
+    double area = 0;
+    for (size_t i = 0; i + 1 < polygon.size(); i++) {
+        area += polygon[i][0] * polygon[i + 1][1] - polygon[i + 1][0] * polygon[i][1];
+    }
+    return area / 2;
+}
+
+}
+
+TEST_CASE("Streaming slices the same contours as a Geometry", "[StreamSlicer]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj");
+    auto cap = GENERATE(size_t{1} << 30, size_t{256} << 10);
+    std::ifstream file{"test/models/" + model};
+    std::string path = "/tmp/halfedge-test-stream.stl";
+    writeSTL(path, Geometry{file});
+
+    // The Geometry read back from the file has the same float coordinates
+    // and face order as the stream.
+    MeshData data = readSTL(path);
+    Geometry geometry{std::move(data.positions), data.faces};
+    auto zs = Slicer::uniformLayers(geometry, 0.01);
+    for (int i = 0; i < geometry.positions().size(); i += 97) {
+        zs.push_back(geometry.positions()[i][2]);
+    }
+    std::sort(zs.begin(), zs.end());
+
+    std::vector<Slicer::Polygons> expected;
+    Slicer::Diagnostics expectedDiagnostics;
+    Slicer::sliceLayers(geometry, zs, [&](int, double, const Slicer::Polygons &polygons) {
+        expected.push_back(polygons);
+    }, &expectedDiagnostics);
+
+    StreamSlicer slicer{path, cap};
+    CHECK(slicer.triangles() == geometry.mesh().faces().size());
+    CHECK(slicer.minZ() == zs.front());
+
+    size_t layers = 0;
+    Slicer::Diagnostics diagnostics;
+    slicer.slice(zs, [&](int layer, double z, const Slicer::Polygons &polygons) {
+        REQUIRE(layer == layers++);
+        CHECK(polygons == expected[layer]);
+    }, &diagnostics);
+    CHECK(layers == zs.size());
+    CHECK(slicer.peakMemory() <= cap);
+
+    REQUIRE(diagnostics.size() == expectedDiagnostics.size());
+    for (size_t i = 0; i < diagnostics.size(); i++) {
+        CHECK(diagnostics[i].kind == expectedDiagnostics[i].kind);
+        CHECK(diagnostics[i].layer == expectedDiagnostics[i].layer);
+        CHECK(diagnostics[i].face == expectedDiagnostics[i].face);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Streaming slices a mesh several times larger than its memory cap", "[StreamSlicer]") {
+    std::string path = "/tmp/halfedge-test-cylinder.stl";
+    const int rings = 2000, segments = 64;
+    size_t count = writeCylinder(path, rings, segments, 100.0);
+
+    // Every triangle takes 80 bytes resident, so the mesh needs about 20
+    // MiB where the cap allows 2.
+    const size_t cap = 2 << 20;
+    StreamSlicer slicer{path, cap};
+    REQUIRE(slicer.triangles() == count);
+    CHECK(slicer.runs() > 1);
+
+    auto zs = Slicer::uniformLayers(0.01, 99.99, 0.0625);
+    size_t layers = 0;
+    Slicer::Diagnostics diagnostics;
+    slicer.slice(zs, [&](int layer, double z, const Slicer::Polygons &polygons) {
+        layers++;
+        // Each quad of the wall is crossed along its side and its diagonal,
+        // whose crossing lies on the chord between the sides.
+        REQUIRE(polygons.size() == 1);
+        CHECK(polygons[0].size() == 2 * segments + 1);
+        CHECK(area(polygons[0]) == Approx(segments / 2.0 * std::sin(2 * M_PI / segments)).epsilon(1e-5));
+    }, &diagnostics);
+
+    CHECK(layers == zs.size());
+    CHECK(diagnostics.empty());
+    CHECK(slicer.peakMemory() <= cap);
+    CHECK(count * 80 > 4 * cap);
+    std::remove(path.c_str());
+}
@@ -1,9 +1,294 @@
 #define CATCH_CONFIG_MAIN
 
 #include <sstream>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
 #include <catch2/catch.hpp>
+#include <Mesh.h>
+#include <Slicer.h>
+#include "Helpers.h"
 
-TEST_CASE("Accepts faces", "[OBJReader]") {
-    CHECK(true);
+TEST_CASE("Incremental slicing produces the same contours as a full scan", "[Slicer]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj");
+    std::ifstream file{"test/models/" + model};
+    Geometry geometry{file};
+
+    auto zs = Slicer::uniformLayers(geometry, 0.005);
+    REQUIRE(zs.size() > 1);
+
+    // Include heights exactly at vertices, and repeated heights.
+    for (int i = 0; i < geometry.positions().size(); i += 97) {
+        zs.push_back(geometry.positions()[i][2]);
+    }
+    zs.push_back(zs.back());
+    std::sort(zs.begin(), zs.end());
+
+    Slicer::Section section{geometry};
+    Slicer::sliceLayers(geometry, zs, [&](int layer, double z, const Slicer::Polygons &polygons) {
+        Slicer::sliceTriangles(geometry, z, section);
+        CHECK(polygons == Slicer::computeContours(section));
+    });
+}
+
+TEST_CASE("Batch slicing produces the same layers as sliceLayers", "[Slicer]") {
+    auto model = GENERATE(as<std::string>{}, "sphere.obj", "bunny.obj");
+    auto threads = GENERATE(1u, 3u);
+    std::ifstream file{"test/models/" + model};
+    Geometry geometry{file};
+
+    auto zs = Slicer::uniformLayers(geometry, 0.002);
+    for (int i = 0; i < geometry.positions().size(); i += 89) {
+        zs.push_back(geometry.positions()[i][2]);
+    }
+    std::sort(zs.begin(), zs.end());
+
+    std::vector<Slicer::Polygons> expected;
+    Slicer::Diagnostics expectedDiagnostics;
+    Slicer::sliceLayers(geometry, zs, [&](int layer, double z, const Slicer::Polygons &polygons) {
+        expected.push_back(polygons);
+    }, &expectedDiagnostics);
+
+    size_t layers = 0;
+    Slicer::Diagnostics diagnostics;
+    Slicer::sliceBatch(geometry, zs, [&](int layer, double z, const Slicer::Polygons &polygons) {
+        REQUIRE(layer == layers++);
+        CHECK(z == zs[layer]);
+        CHECK(polygons == expected[layer]);
+    }, threads, &diagnostics);
+    CHECK(layers == zs.size());
+
+    REQUIRE(diagnostics.size() == expectedDiagnostics.size());
+    for (size_t i = 0; i < diagnostics.size(); i++) {
+        CHECK(diagnostics[i].kind == expectedDiagnostics[i].kind);
+        CHECK(diagnostics[i].layer == expectedDiagnostics[i].layer);
+        CHECK(diagnostics[i].face == expectedDiagnostics[i].face);
+    }
+}
+
+TEST_CASE("Sweep produces the same contours as a full scan", "[Slicer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+
+    const auto zs = Slicer::uniformLayers(geometry, 0.05);
+    REQUIRE(zs.size() > 1);
+
+    FaceSweep sweep{geometry};
+    Slicer::Section swept{geometry}, scanned{geometry};
+    for (double z: zs) {
+        Slicer::sliceTriangles(geometry, z, sweep.advance(z), swept);
+        Slicer::sliceTriangles(geometry, z, scanned);
+        CHECK(Slicer::computeContours(swept) == Slicer::computeContours(scanned));
+    }
+}
+
+TEST_CASE("Incremental slicing examines each face a bounded number of times", "[Slicer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+
+    // Each vertex drops below the plane once, and each face has three.
+    IncrementalSlicer slicer{geometry};
+    size_t updated = 0;
+    for (double z: Slicer::uniformLayers(geometry, 0.001)) {
+        slicer.advance(z);
+        updated += slicer.updatedFaces();
+    }
+    CHECK(updated <= 3 * geometry.mesh().faces().size());
+}
+
+TEST_CASE("Vertices on the plane join a single contour", "[Slicer]") {
+    // An octahedron sliced through its four equatorial vertices meets the
+    // plane only at vertices, each shared by four faces.
+    Geometry octahedron{
+        {{1, 0, 0}, {0, 1, 0}, {-1, 0, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}},
+        {{0, 1, 4}, {1, 2, 4}, {2, 3, 4}, {3, 0, 4}, {1, 0, 5}, {2, 1, 5}, {3, 2, 5}, {0, 3, 5}},
+    };
+
+    Slicer::Section section{octahedron};
+    Slicer::sliceTriangles(octahedron, 0.0, section);
+    CHECK(section.segments() == 4);
+
+    const auto &polygons = Slicer::computeContours(section);
+    REQUIRE(polygons.size() == 1);
+    CHECK(polygons[0].size() == 5);
+    CHECK(polygons[0].front() == polygons[0].back());
+    CHECK(section.diagnostics().empty());
+
+    // At the apex the contour collapses to a single point.
+    Slicer::sliceTriangles(octahedron, 1.0, section);
+    CHECK(Slicer::computeContours(section).empty());
+    REQUIRE(section.diagnostics().size() == 1);
+    CHECK(section.diagnostics()[0].kind == Slicer::Diagnostic::CollapsedContour);
+}
+
+TEST_CASE("Contours wind counter-clockwise around material", "[Slicer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+
+    Slicer::sliceLayers(geometry, Slicer::uniformLayers(geometry, 0.1), [&](int, double z, const Slicer::Polygons &polygons) {
+        for (auto &polygon: polygons) {
+            CHECK(polygon.front() == polygon.back());
+            CHECK(signedArea(polygon) > 0);
+        }
+    });
+}
+
+TEST_CASE("Open meshes report open contours", "[Slicer]") {
+    std::ifstream file{"test/models/bunny.obj"};
+    Geometry geometry{file};
+    REQUIRE_FALSE(geometry.mesh().closed());
+
+    Slicer::Diagnostics diagnostics;
+    std::vector<Slicer::Polygons> layers;
+    const auto zs = Slicer::uniformLayers(geometry, 0.005);
+    Slicer::sliceLayers(geometry, zs, [&](int, double, const Slicer::Polygons &polygons) {
+        layers.push_back(polygons);
+    }, &diagnostics);
+
+    REQUIRE_FALSE(diagnostics.empty());
+    for (auto &d: diagnostics) {
+        REQUIRE(d.layer >= 0);
+        REQUIRE(d.layer < zs.size());
+        if (d.kind == Slicer::Diagnostic::OpenContour) {
+            // The open contour is still emitted, as a polyline.
+            CHECK(std::any_of(layers[d.layer].begin(), layers[d.layer].end(), [](auto &polygon) {
+                return polygon.front() != polygon.back();
+            }));
+        }
+    }
+
+    Slicer::Diagnostics parallel;
+    Slicer::sliceLayers(geometry, zs, [](int, double, const Slicer::Polygons &) {}, 3, nullptr, &parallel);
+    REQUIRE(parallel.size() == diagnostics.size());
+    for (size_t i = 0; i < parallel.size(); i++) {
+        CHECK(parallel[i].layer == diagnostics[i].layer);
+        CHECK(parallel[i].face == diagnostics[i].face);
+    }
+}
+
+TEST_CASE("Long contours are chained without recursion", "[Slicer]") {
+    // A closed prism with a 500000-gon cross-section, which overflowed the
+    // stack of the recursive chain builder.
+    const int n = 500000;
+    std::vector<Geometry::Point> positions;
+    std::vector<std::array<int, 3>> faces;
+    for (int i = 0; i < n; i++) {
+        double a = 2 * M_PI * i / n;
+        positions.push_back({std::cos(a), std::sin(a), 0});
+        positions.push_back({std::cos(a), std::sin(a), 1});
+    }
+    positions.push_back({0, 0, 0});
+    positions.push_back({0, 0, 1});
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1) % n;
+        faces.push_back({2 * i, 2 * j, 2 * j + 1});
+        faces.push_back({2 * i, 2 * j + 1, 2 * i + 1});
+        faces.push_back({2 * j, 2 * i, 2 * n});
+        faces.push_back({2 * i + 1, 2 * j + 1, 2 * n + 1});
+    }
+    Geometry prism{std::move(positions), faces};
+    REQUIRE(prism.mesh().closed());
+
+    Slicer::Section section{prism};
+    Slicer::sliceTriangles(prism, 0.5, section);
+    const auto &polygons = Slicer::computeContours(section);
+    REQUIRE(polygons.size() == 1);
+    // Each side quad contributes its vertical edge and its diagonal.
+    CHECK(polygons[0].size() == 2 * n + 1);
+    CHECK(signedArea(polygons[0]) == Approx(M_PI).epsilon(1e-6));
+}
+
+TEST_CASE("Parallel slicing emits identical layers in z order", "[Slicer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    const auto zs = Slicer::uniformLayers(geometry, 0.05);
+
+    std::vector<Slicer::Polygons> expected;
+    Slicer::sliceLayers(geometry, zs, [&](int layer, double z, const Slicer::Polygons &polygons) {
+        expected.push_back(polygons);
+    });
+
+    for (unsigned threads: {2, 3, 8}) {
+        std::vector<Slicer::Polygons> layers;
+        Slicer::sliceLayers(geometry, zs, [&](int layer, double z, const Slicer::Polygons &polygons) {
+            CHECK(layer == layers.size());
+            CHECK(z == zs[layer]);
+            layers.push_back(polygons);
+        }, threads);
+        CHECK(layers == expected);
+    }
 }
 
+TEST_CASE("Adaptive layers bound the cusp height of every face", "[Slicer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    const auto uniform = Slicer::uniformLayers(geometry, 0.05);
+    const double extent = uniform.back() - uniform.front();
+
+    LayerSettings settings;
+    settings.height = extent / 20;
+    settings.adaptive = true;
+    settings.minHeight = extent / 400;
+    settings.tolerance = extent / 500;
+    const auto zs = Slicer::layerSchedule(geometry, settings);
+    REQUIRE(zs.front() == uniform.front());
+    REQUIRE(zs.back() <= uniform.front() + extent);
+    REQUIRE(zs.back() + settings.height > uniform.front() + extent);
+    CHECK(zs == Slicer::layerSchedule(geometry, settings, 3));
+
+    // Layers are thin at the poles and thick around the equator.
+    std::vector<double> gaps;
+    for (size_t i = 0; i + 1 < zs.size(); i++) {
+        gaps.push_back(zs[i + 1] - zs[i]);
+        REQUIRE(gaps.back() >= settings.minHeight * (1 - 1e-9));
+        REQUIRE(gaps.back() <= settings.height * (1 + 1e-9));
+    }
+    CHECK(gaps.front() == Approx(settings.minHeight));
+    CHECK(gaps[gaps.size() / 2] > 4 * settings.minHeight);
+    // A layer at height z on a sphere of radius R can be tolerance R / |z|
+    // thick, which integrates to extent / (4 tolerance) = 250 layers
+    // against 400 at the minimum height.
+    CHECK(zs.size() < 0.7 * extent / settings.minHeight);
+
+    for (const Face &face: geometry.mesh().faces()) {
+        auto v = face.vertices();
+        const auto &a = geometry.positions()[v[0]->index];
+        const auto &b = geometry.positions()[v[1]->index];
+        const auto &c = geometry.positions()[v[2]->index];
+        double nx = (b[1] - a[1]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[1] - a[1]);
+        double ny = (b[2] - a[2]) * (c[0] - a[0]) - (b[0] - a[0]) * (c[2] - a[2]);
+        double nz = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+        double cusp = std::abs(nz) / std::sqrt(nx * nx + ny * ny + nz * nz);
+        double lo = std::min({a[2], b[2], c[2]}), hi = std::max({a[2], b[2], c[2]});
+        for (size_t i = 0; i + 1 < zs.size(); i++) {
+            if (zs[i + 1] <= lo || zs[i] > hi) continue;
+            double gap = zs[i + 1] - zs[i];
+            REQUIRE((gap * cusp <= settings.tolerance * (1 + 1e-9) || gap <= settings.minHeight * (1 + 1e-9)));
+        }
+    }
+}
+
+TEST_CASE("Adaptive layers stay thick along vertical walls", "[Slicer]") {
+    // A 1 by 1 by 10 box: only the top and bottom are not vertical.
+    Geometry box{
+        {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {0, 0, 10}, {1, 0, 10}, {1, 1, 10}, {0, 1, 10}},
+        {{0, 2, 1}, {0, 3, 2}, {4, 5, 6}, {4, 6, 7}, {0, 1, 5}, {0, 5, 4}, {1, 2, 6}, {1, 6, 5},
+         {2, 3, 7}, {2, 7, 6}, {3, 0, 4}, {3, 4, 7}},
+    };
+    LayerSettings settings;
+    settings.height = 0.5;
+    settings.adaptive = true;
+    settings.minHeight = 0.05;
+    settings.tolerance = 0.01;
+    const auto zs = Slicer::layerSchedule(box, settings);
+
+    // The bottom face limits the first layer; the rest are full height
+    // until the top face comes within reach.
+    REQUIRE(zs.size() > 20);
+    CHECK(zs[1] == Approx(0.05));
+    CHECK(zs[2] == Approx(0.55));
+    CHECK(zs.size() < 30);
+
+    settings.adaptive = false;
+    CHECK(Slicer::layerSchedule(box, settings) == Slicer::uniformLayers(box, 0.5));
+}
@@ -0,0 +1,145 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <map>
+#include <catch2/catch.hpp>
+#include <Trace.h>
+#include <Progress.h>
+#include <Parallel.h>
+#include <Slicer.h>
+
+namespace {
+
+size_t occurrences(const std::string &text, const std::string &pattern) {
+    size_t count = 0;
+    for (size_t i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + 1)) count++;
+    return count;
+}
+
+// Enables tracing for the lifetime of a test, starting from an empty log.
+struct Tracing {
+    Tracing() {
+        trace::reset();
+        trace::enable(true);
+    }
+    ~Tracing() {
+        trace::enable(false);
+        trace::reset();
+    }
+};
+
+}
+
+TEST_CASE("Disabled tracing records nothing", "[Trace]") {
+    trace::reset();
+    {
+        trace::Scope scope{"idle"};
+        trace::count("idle", 5);
+    }
+    trace::Summary summary = trace::summarize();
+    CHECK(summary.stages.empty());
+    CHECK(summary.counters.empty());
+}
+
+TEST_CASE("Spans and counters aggregate across threads", "[Trace]") {
+    Tracing tracing;
+    // Every parallel loop starts new threads, which take over the logs of
+    // the threads of the loop before.
+    for (int round = 0; round < 20; round++) {
+        parallelFor(64, 4, 1, [](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; i++) {
+                trace::Scope scope{"work"};
+                trace::count("items");
+                trace::count("weight", i);
+            }
+        });
+    }
+    {
+        trace::Scope scope{"outer"};
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    trace::Summary summary = trace::summarize();
+    REQUIRE(summary.stages.size() == 2);
+    CHECK(summary.stages[0].name == "outer");
+    CHECK(summary.stages[0].calls == 1);
+    CHECK(summary.stages[0].totalMs >= 2);
+    CHECK(summary.stages[0].maxMs == summary.stages[0].totalMs);
+    CHECK(summary.stages[1].name == "work");
+    CHECK(summary.stages[1].calls == 20 * 64);
+    REQUIRE(summary.counters.size() == 2);
+    CHECK(summary.counters[0] == std::make_pair(std::string{"items"}, int64_t{20 * 64}));
+    CHECK(summary.counters[1] == std::make_pair(std::string{"weight"}, int64_t{20 * 63 * 64 / 2}));
+
+    std::ostringstream chrome;
+    trace::writeChromeTrace(chrome);
+    CHECK(occurrences(chrome.str(), "\"ph\": \"X\"") == 20 * 64 + 1);
+    CHECK(occurrences(chrome.str(), "\"ph\": \"C\"") == 2);
+    // At most the four workers of a loop and this thread ever held a log.
+    for (int tid = 6; tid < 100; tid++) {
+        CHECK(occurrences(chrome.str(), "\"tid\": " + std::to_string(tid) + ",") == 0);
+    }
+
+    std::ostringstream json;
+    trace::writeJSON(json);
+    CHECK(json.str().find("\"work\": {\"calls\": 1280,") != std::string::npos);
+    CHECK(json.str().find("\"items\": 1280") != std::string::npos);
+
+    trace::reset();
+    CHECK(trace::summarize().stages.empty());
+}
+
+TEST_CASE("Slicing reports its stages", "[Trace]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    const auto zs = Slicer::uniformLayers(geometry, 0.05);
+
+    Tracing tracing;
+    size_t segments = 0, contours = 0;
+    IncrementalSlicer slicer{geometry};
+    for (double z: zs) {
+        contours += slicer.advance(z).size();
+        segments += slicer.segments();
+    }
+
+    trace::Summary summary = trace::summarize();
+    std::map<std::string, uint64_t> calls;
+    for (const auto &stage: summary.stages) calls[stage.name] = stage.calls;
+    CHECK(calls["intersect"] == zs.size());
+    CHECK(calls["contour"] == zs.size());
+    std::map<std::string, int64_t> counters{summary.counters.begin(), summary.counters.end()};
+    CHECK(counters["segments"] == segments);
+    CHECK(counters["contours"] == contours);
+}
+
+TEST_CASE("Progress goes to the callback and quiet mode silences messages", "[Trace]") {
+    std::vector<std::pair<std::string, float>> reports;
+    setProgressCallback([&](const std::string &stage, float progress) {
+        reports.emplace_back(stage, progress);
+    });
+
+    std::ostringstream captured;
+    std::streambuf *previous = std::cout.rdbuf(captured.rdbuf());
+    ProgressBar progress{"stage"};
+    for (int i = 0; i < 1000; i++) progress.update(i / 1000.0f);
+    progress.finish();
+
+    // Only whole percentages are reported.
+    REQUIRE(reports.size() == 101);
+    for (size_t i = 1; i < reports.size(); i++) {
+        CHECK(reports[i].first == "stage");
+        CHECK(reports[i].second > reports[i - 1].second);
+    }
+    CHECK(reports.back().second == 1);
+    setProgressCallback(nullptr);
+
+    setQuiet(true);
+    info() << "hidden" << std::endl;
+    ProgressBar hidden;
+    hidden.update(0.5);
+    hidden.finish();
+    setQuiet(false);
+    info() << "shown" << std::endl;
+    std::cout.rdbuf(previous);
+    CHECK(captured.str() == "info: shown\n");
+}
@@ -0,0 +1,146 @@
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <catch2/catch.hpp>
+#include <Voxelizer.h>
+
+namespace {
+
+using Point = Geometry::Point;
+
+// Clips the triangle against the six planes of the box; they overlap when
+// anything is left.
+bool clippedOverlap(const Point &center, double halfSize, const std::array<Point, 3> &triangle) {
+    std::vector<Point> polygon{triangle.begin(), triangle.end()};
+    for (int axis = 0; axis < 3; axis++) {
+        for (double sign: {-1.0, 1.0}) {
+            double bound = center[axis] + sign * halfSize;
+            auto inside = [&](const Point &p) { return sign * (p[axis] - bound) <= 0; };
+            std::vector<Point> clipped;
+            for (size_t i = 0; i < polygon.size(); i++) {
+                const Point &a = polygon[i], &b = polygon[(i + 1) % polygon.size()];
+                if (inside(a)) clipped.push_back(a);
+                if (inside(a) != inside(b)) {
+                    double t = (bound - a[axis]) / (b[axis] - a[axis]);
+                    clipped.push_back({a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]), a[2] + t * (b[2] - a[2])});
+                }
+            }
+            polygon.swap(clipped);
+            if (polygon.empty()) return false;
+        }
+    }
+    return true;
+}
+
+// The volume enclosed by a closed mesh, by the divergence theorem.
+double meshVolume(const Geometry &geometry) {
+    double volume = 0;
+    for (const Face &face: geometry.mesh().faces()) {
+        auto v = face.vertices();
+        const Point &a = geometry.positions()[v[0]->index];
+        const Point &b = geometry.positions()[v[1]->index];
+        const Point &c = geometry.positions()[v[2]->index];
+        volume += a[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (b[0] * c[2] - b[2] * c[0]) + a[2] * (b[0] * c[1] - b[1] * c[0]);
+    }
+    return volume / 6;
+}
+
+Geometry cube(double lo, double hi) {
+    std::vector<Point> positions;
+    for (int i = 0; i < 8; i++) {
+        positions.push_back({i & 1 ? hi : lo, i & 2 ? hi : lo, i & 4 ? hi : lo});
+    }
+    std::vector<std::array<int, 3>> faces{
+        {0, 2, 1}, {1, 2, 3}, {4, 5, 6}, {5, 7, 6},
+        {0, 1, 4}, {1, 5, 4}, {2, 6, 3}, {3, 6, 7},
+        {0, 4, 2}, {2, 4, 6}, {1, 3, 5}, {3, 7, 5},
+    };
+    return Geometry{positions, faces};
+}
+
+}
+
+TEST_CASE("The separating axis test agrees with clipping", "[Voxelizer]") {
+    Point center{0.1, -0.2, 0.3};
+    const double halfSize = 0.5;
+
+    // The plane x + y + z = 2 passes the corner of the unit box even though
+    // the bounds of the triangle contain it.
+    CHECK_FALSE(triangleOverlapsBox({0, 0, 0}, halfSize, {{{2, 0, 0}, {0, 2, 0}, {0, 0, 2}}}));
+    CHECK(triangleOverlapsBox({0, 0, 0}, halfSize, {{{1.4, 0, 0}, {0, 1.4, 0}, {0, 0, 1.4}}}));
+
+    std::mt19937 random{7};
+    std::uniform_real_distribution<double> coordinate{-1.5, 1.5};
+    int overlapping = 0;
+    for (int i = 0; i < 20000; i++) {
+        std::array<Point, 3> triangle;
+        for (auto &p: triangle) {
+            p = {center[0] + coordinate(random), center[1] + coordinate(random), center[2] + coordinate(random)};
+        }
+        bool expected = clippedOverlap(center, halfSize, triangle);
+        REQUIRE(triangleOverlapsBox(center, halfSize, triangle) == expected);
+        overlapping += expected;
+    }
+    CHECK(overlapping > 2000);
+    CHECK(overlapping < 18000);
+}
+
+TEST_CASE("A cube aligned with the grid fills it exactly", "[Voxelizer]") {
+    Geometry geometry = cube(-1, 1);
+    VoxelSettings settings;
+    settings.resolution = 8;
+
+    VoxelLayout layout = voxelLayout(geometry, settings);
+    CHECK(layout.size == 0.25);
+    CHECK(layout.nx == 8);
+    CHECK(layout.nz == 8);
+    CHECK(layout.bytes() == 64);
+
+    settings.shell = false;
+    VoxelGrid solid = voxelize(geometry, settings);
+    CHECK(solid.count() == 512);
+    CHECK(solid.volume() == 8);
+
+    settings.shell = true;
+    settings.solid = false;
+    VoxelGrid shell = voxelize(geometry, settings);
+    CHECK(shell.count() == 512 - 6 * 6 * 6);
+    CHECK(shell.at(0, 3, 4));
+    CHECK_FALSE(shell.at(1, 3, 4));
+}
+
+TEST_CASE("Voxelized spheres approach the enclosed volume", "[Voxelizer]") {
+    std::ifstream file{"test/models/sphere.obj"};
+    Geometry geometry{file};
+    const double volume = meshVolume(geometry);
+
+    VoxelSettings settings;
+    settings.resolution = 96;
+    settings.shell = false;
+    VoxelGrid solid = voxelize(geometry, settings);
+    CHECK(solid.volume() == Approx(volume).epsilon(0.01));
+
+    // The shell covers the surface, so every vertex lies in a marked voxel,
+    // and it only adds to the solid.
+    settings.shell = true;
+    settings.threads = 3;
+    VoxelGrid full = voxelize(geometry, settings);
+    const VoxelLayout &layout = full.layout();
+    for (const Point &p: geometry.positions()) {
+        int x = std::min(layout.nx - 1, int((p[0] - layout.origin[0]) / layout.size));
+        int y = std::min(layout.ny - 1, int((p[1] - layout.origin[1]) / layout.size));
+        int z = std::min(layout.nz - 1, int((p[2] - layout.origin[2]) / layout.size));
+        REQUIRE(full.at(x, y, z));
+    }
+    CHECK(full.count() > solid.count());
+    for (int z = 0; z < layout.nz; z++) {
+        const auto &a = solid.layer(z).data, &b = full.layer(z).data;
+        for (size_t i = 0; i < a.size(); i++) REQUIRE((a[i] & ~b[i]) == 0);
+    }
+
+    settings.threads = 1;
+    VoxelGrid serial = voxelize(geometry, settings);
+    for (int z = 0; z < layout.nz; z++) {
+        REQUIRE(serial.layer(z).data == full.layer(z).data);
+    }
+}
@@ -1,45 +1,122 @@
-import matplotlib.pyplot as plt
-import numpy as np
 import glob
+import mmap
 import os
-import matplotlib.pyplot as plt
-from matplotlib.contour import ContourSet
-
-print_platform_width = 100
-print_platform_depth = 100
-fig, ax = plt.subplots(figsize=(20, 30))
-plt.margins(0, 0)
-plt.axis('off')
-
-files = glob.glob('test/img/*')
-for f in files:
-    os.remove(f)
-
-for i in range(300):
-    ax.clear()
-    ax.set_xlim(-print_platform_width/2, print_platform_width/2)
-    ax.set_ylim(-print_platform_depth/2, print_platform_depth/2)
-    ax.get_xaxis().set_visible(False)
-    ax.get_yaxis().set_visible(False)
-    
-    polygons = glob.glob(f'test/csv/slice{i}_*.csv')
-
-    if len(polygons) == 0:
-        continue
-        
-    '''
-    contours = list(map(lambda p: np.loadtxt(p).tolist(), polygons))
-    commands = [list(map(lambda i: 1 if i == 0 else 2, range(len(contour)))) for contour in contours]
-    cs = ContourSet(ax, [0, 1], [[np.concatenate(contours).tolist()]], [[np.concatenate(commands).tolist()]], filled=True)
-    '''
-    contours = list(map(lambda p: [np.loadtxt(p).tolist()], polygons))
-    commands = [[list(map(lambda i: 1 if i == 0 else 2, range(len(contour[0]))))] for contour in contours]
-    levels = list(range(len(contours)))
-    cs = ContourSet(ax, levels, contours, commands, filled=False)
-    '''
-    for polygon in polygons:
-        vertices = np.loadtxt(polygon)
-        plt.fill(vertices[:,0], vertices[:,1], 'black')
-    '''
-    plt.subplots_adjust(left=0, right=1, top=1, bottom=0)
-    plt.savefig(f'test/img/slice{i}.png')
\ No newline at end of file
+import struct
+import sys
+
+# Reads the layer stack files written by `slicer --stack`; see LayerStack.h
+# for the layout.
+HEADER = struct.Struct('<8sIIddddIiiiii')
+ENTRY = struct.Struct('<dQQQ')
+FOOTER = struct.Struct('<QQ8s')
+MAGIC = b'HELAYERS'
+
+
+def varints(data, pos, end):
+    value = shift = 0
+    while pos < end:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            yield value
+            value = shift = 0
+
+
+class LayerStack:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        (magic, version, header_size, self.scale, self.pitch, self.center_x, self.center_y,
+         masks, self.width, self.height, self.bits, _, _) = HEADER.unpack_from(self.data, 0)
+        index_offset, self.count, end_magic = FOOTER.unpack_from(self.data, len(self.data) - FOOTER.size)
+        if magic != MAGIC or end_magic != MAGIC or version != 1 or header_size != HEADER.size:
+            raise ValueError(f'{path} is not a layer stack')
+        self.masks = bool(masks)
+        self.index = [ENTRY.unpack_from(self.data, index_offset + i * ENTRY.size) for i in range(self.count)]
+
+    def z(self, layer):
+        return self.index[layer][0]
+
+    def contours(self, layer):
+        _, offset, contour_bytes, _ = self.index[layer]
+        values = varints(self.data, offset, offset + contour_bytes)
+        x = y = 0
+        polygons = []
+        for _ in range(next(values)):
+            header = next(values)
+            polygon = []
+            for _ in range(header >> 1):
+                dx, dy = next(values), next(values)
+                x += (dx >> 1) ^ -(dx & 1)
+                y += (dy >> 1) ^ -(dy & 1)
+                polygon.append((x / self.scale, y / self.scale))
+            if header & 1 and polygon:
+                polygon.append(polygon[0])
+            polygons.append(polygon)
+        return polygons
+
+    def mask(self, layer):
+        """Returns the mask as rows of pixel values, top row first."""
+        _, offset, contour_bytes, mask_bytes = self.index[layer]
+        pos, end = offset + contour_bytes, offset + contour_bytes + mask_bytes
+        pixels = bytearray()
+        value = 0
+        while pos < end:
+            run = shift = 0
+            while True:
+                byte = self.data[pos]
+                pos += 1
+                run |= (byte & 0x7F) << shift
+                shift += 7
+                if not byte & 0x80:
+                    break
+            if self.bits == 8:
+                value = self.data[pos]
+                pos += 1
+            pixels += bytes([value]) * run
+            if self.bits == 1:
+                value ^= 1
+        return [pixels[y * self.width:(y + 1) * self.width] for y in range(self.height)]
+
+
+if __name__ == '__main__':
+    import matplotlib.pyplot as plt
+    from matplotlib.path import Path
+    from matplotlib.patches import PathPatch
+
+    stack = LayerStack(sys.argv[1] if len(sys.argv) > 1 else 'slices.hels')
+    show_masks = '--masks' in sys.argv and stack.masks
+
+    print_platform_width = 100
+    print_platform_depth = 100
+    fig, ax = plt.subplots(figsize=(20, 30))
+    plt.margins(0, 0)
+    plt.axis('off')
+
+    files = glob.glob('test/img/*')
+    for f in files:
+        os.remove(f)
+
+    for i in range(stack.count):
+        ax.clear()
+        ax.get_xaxis().set_visible(False)
+        ax.get_yaxis().set_visible(False)
+
+        if show_masks:
+            ax.imshow(stack.mask(i), cmap='gray', origin='lower')
+        else:
+            ax.set_xlim(-print_platform_width/2, print_platform_width/2)
+            ax.set_ylim(-print_platform_depth/2, print_platform_depth/2)
+            polygons = [p for p in stack.contours(i) if len(p) > 1]
+            if len(polygons) == 0:
+                continue
+
+            # One compound path, filled with the even-odd rule like the masks.
+            vertices = [point for polygon in polygons for point in polygon]
+            codes = [Path.MOVETO if j == 0 else Path.LINETO for polygon in polygons for j in range(len(polygon))]
+            ax.add_patch(PathPatch(Path(vertices, codes), facecolor='black', edgecolor='black', fill=True))
+
+        plt.subplots_adjust(left=0, right=1, top=1, bottom=0)
+        plt.savefig(f'test/img/slice{i}.png')